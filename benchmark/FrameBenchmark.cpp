@@ -0,0 +1,384 @@
+import std;
+import EasyGui;
+
+// Drives canned IUpdatableLayer workloads through Window::DrawFrame on a headless window and
+// reports per phase percentiles as JSON. Needs no display, so it also runs on Linux CI machines with lavapipe:
+//   EasyGuiFrameBenchmark --frames 1000 --output frame_times.json
+
+namespace {
+    struct BenchmarkOptions {
+        size_t frames = 500;
+        size_t warmupFrames = 30;
+        int width = 1920;
+        int height = 1080;
+        std::string workload = "all";
+        std::filesystem::path output = "frame_benchmark.json";
+        bool bindless = false;
+    };
+
+    class WidgetWorkload : public EasyGui::IUpdatableLayer {
+    public:
+        WidgetWorkload() : IUpdatableLayer("Widgets") {}
+
+        void OnUpdate() override {
+            const ImGuiViewport *viewport = ImGui::GetMainViewport();
+            ImGui::SetNextWindowPos(viewport->WorkPos);
+            ImGui::SetNextWindowSize(viewport->WorkSize);
+            ImGui::Begin("Widgets");
+            for (int i = 0; i < s_WidgetCount; i++) {
+                ImGui::PushID(i);
+                switch (i % 4) {
+                    case 0:
+                        ImGui::Button("Button");
+                        break;
+                    case 1:
+                        ImGui::SliderFloat("Slider", &m_Values[i / 4], 0.0f, 1.0f);
+                        break;
+                    case 2:
+                        ImGui::Checkbox("Checkbox", &m_Flags[i / 4]);
+                        break;
+                    default:
+                        ImGui::TextFmt("Label {}", i);
+                }
+                if (i % 8 != 7) ImGui::SameLine();
+                ImGui::PopID();
+            }
+            ImGui::End();
+        }
+
+    private:
+        constexpr static int s_WidgetCount = 5000;
+
+        std::array<float, s_WidgetCount / 4 + 1> m_Values{};
+        std::array<bool, s_WidgetCount / 4 + 1> m_Flags{};
+    };
+
+    class TableWorkload : public EasyGui::IUpdatableLayer {
+    public:
+        TableWorkload() : IUpdatableLayer("Table") {}
+
+        void OnUpdate() override {
+            const ImGuiViewport *viewport = ImGui::GetMainViewport();
+            ImGui::SetNextWindowPos(viewport->WorkPos);
+            ImGui::SetNextWindowSize(viewport->WorkSize);
+            ImGui::Begin("Table");
+            constexpr ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                                              ImGuiTableFlags_Resizable | ImGuiTableFlags_Sortable |
+                                              ImGuiTableFlags_ScrollY;
+            if (ImGui::BeginTable("LargeTable", s_Columns, flags)) {
+                for (int column = 0; column < s_Columns; column++) {
+                    ImGui::TableSetupColumn(std::format("Column {}", column).c_str());
+                }
+                ImGui::TableHeadersRow();
+                // deliberately without a clipper, every row is submitted
+                for (int row = 0; row < s_Rows; row++) {
+                    ImGui::TableNextRow();
+                    for (int column = 0; column < s_Columns; column++) {
+                        ImGui::TableSetColumnIndex(column);
+                        ImGui::TextFmt("{}:{}", row, column);
+                    }
+                }
+                ImGui::EndTable();
+            }
+            ImGui::End();
+        }
+
+    private:
+        constexpr static int s_Rows = 2000;
+        constexpr static int s_Columns = 8;
+    };
+
+    class ImageWorkload : public EasyGui::IUpdatableLayer {
+    public:
+        explicit ImageWorkload(EasyGui::Window &window)
+            : IUpdatableLayer("Images"),
+              m_Sampler(EasyGui::Vulkan::CreateSimpleImageSampler(*window.GetLogicalDevice())) {
+            EasyGui::Vulkan::ImageHelper imageHelper(
+                &window.GetPhysicalDevice(), &window.GetLogicalDevice(), &window.GetCommandPool(),
+                &window.GetGraphicsQueue(), &window.GetVulkanInstance(), &window.GetAllocator(),
+                &window.GetGraphicsContext().GetDeletionQueue(), &window.GetGraphicsContext().GetStagingRing());
+
+            std::vector<std::uint8_t> pixels(s_TextureSize * s_TextureSize * 4);
+            for (size_t texture = 0; texture < s_TextureCount; texture++) {
+                for (size_t y = 0; y < s_TextureSize; y++) {
+                    for (size_t x = 0; x < s_TextureSize; x++) {
+                        auto *pixel = &pixels[(y * s_TextureSize + x) * 4];
+                        pixel[0] = static_cast<std::uint8_t>(x + texture * 16);
+                        pixel[1] = static_cast<std::uint8_t>(y + texture * 32);
+                        pixel[2] = static_cast<std::uint8_t>(((x / 16 + y / 16) % 2) * 255);
+                        pixel[3] = 255;
+                    }
+                }
+                m_PixelImages.push_back(imageHelper.CreatePixelImage(
+                    s_TextureSize, s_TextureSize, vk::Format::eR8G8B8A8Unorm, pixels.data(), true));
+                if (auto *textureTable = window.GetGraphicsContext().GetTextureTable()) {
+                    m_ImGuiImages.push_back(m_PixelImages.back().CreateImGuiImage(*textureTable, *m_Sampler));
+                } else {
+                    m_ImGuiImages.push_back(m_PixelImages.back().CreateImGuiImage(*m_Sampler));
+                }
+            }
+        }
+
+        void OnUpdate() override {
+            const ImGuiViewport *viewport = ImGui::GetMainViewport();
+            ImGui::SetNextWindowPos(viewport->WorkPos);
+            ImGui::SetNextWindowSize(viewport->WorkSize);
+            ImGui::Begin("Images");
+            for (size_t i = 0; i < s_DrawCount; i++) {
+                ImGui::Image(m_ImGuiImages[i % m_ImGuiImages.size()], ImVec2{32.0f, 32.0f});
+                if (i % 48 != 47) ImGui::SameLine();
+            }
+            ImGui::End();
+        }
+
+    private:
+        constexpr static size_t s_TextureCount = 64;
+        constexpr static size_t s_TextureSize = 256;
+        constexpr static size_t s_DrawCount = 4000;
+
+        vk::UniqueSampler m_Sampler;
+        std::vector<EasyGui::Vulkan::PixelImage> m_PixelImages;
+        std::vector<EasyGui::Vulkan::ImGuiImage> m_ImGuiImages;
+    };
+
+    class DockingWorkload : public EasyGui::IUpdatableLayer {
+    public:
+        DockingWorkload() : IUpdatableLayer("Docking") {}
+
+        void OnUpdate() override {
+            ImGuiID dockspaceId = ImGui::DockSpaceOverViewport();
+
+            if (!m_LayoutBuilt) {
+                BuildLayout(dockspaceId);
+                m_LayoutBuilt = true;
+            }
+
+            for (int i = 0; i < s_WindowCount; i++) {
+                ImGui::Begin(std::format("Docked {}", i).c_str());
+                for (int line = 0; line < 20; line++) {
+                    ImGui::TextFmt("Window {} line {}", i, line);
+                }
+                ImGui::End();
+            }
+        }
+
+    private:
+        static void BuildLayout(ImGuiID dockspaceId) {
+            ImGui::DockBuilderRemoveNode(dockspaceId);
+            ImGui::DockBuilderAddNode(dockspaceId, ImGuiDockNodeFlags_DockSpace);
+            ImGui::DockBuilderSetNodeSize(dockspaceId, ImGui::GetMainViewport()->WorkSize);
+
+            ImGuiID left, right;
+            ImGui::DockBuilderSplitNode(dockspaceId, ImGuiDir_Left, 0.5f, &left, &right);
+            ImGuiID leftTop, leftBottom, rightTop, rightBottom;
+            ImGui::DockBuilderSplitNode(left, ImGuiDir_Up, 0.5f, &leftTop, &leftBottom);
+            ImGui::DockBuilderSplitNode(right, ImGuiDir_Up, 0.5f, &rightTop, &rightBottom);
+
+            std::array nodes{leftTop, leftBottom, rightTop, rightBottom};
+            for (int i = 0; i < s_WindowCount; i++) {
+                ImGui::DockBuilderDockWindow(std::format("Docked {}", i).c_str(), nodes[i % nodes.size()]);
+            }
+            ImGui::DockBuilderFinish(dockspaceId);
+        }
+
+        constexpr static int s_WindowCount = 64;
+        bool m_LayoutBuilt = false;
+    };
+
+    struct Workload {
+        std::string_view Name;
+        std::function<std::shared_ptr<EasyGui::IUpdatableLayer>(EasyGui::Window &)> Create;
+    };
+
+    std::vector<Workload> GetWorkloads() {
+        return {
+            {"widgets", [](EasyGui::Window &) { return std::make_shared<WidgetWorkload>(); }},
+            {"table", [](EasyGui::Window &) { return std::make_shared<TableWorkload>(); }},
+            {"images", [](EasyGui::Window &window) { return std::make_shared<ImageWorkload>(window); }},
+            {"docking", [](EasyGui::Window &) { return std::make_shared<DockingWorkload>(); }},
+        };
+    }
+
+    struct PhaseStatistics {
+        double Mean = 0.0;
+        double P50 = 0.0;
+        double P95 = 0.0;
+        double P99 = 0.0;
+        double Max = 0.0;
+    };
+
+    PhaseStatistics ComputeStatistics(std::vector<double> samples) {
+        if (samples.empty()) return {};
+
+        std::ranges::sort(samples);
+        auto percentile = [&](double p) {
+            auto rank = static_cast<size_t>(std::ceil(p * static_cast<double>(samples.size())));
+            return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+        };
+
+        return {
+            .Mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size()),
+            .P50 = percentile(0.50),
+            .P95 = percentile(0.95),
+            .P99 = percentile(0.99),
+            .Max = samples.back()
+        };
+    }
+
+    struct WorkloadResult {
+        std::string_view Name;
+        std::vector<std::pair<std::string_view, PhaseStatistics>> Phases;
+    };
+
+    WorkloadResult RunWorkload(const Workload &workload, const BenchmarkOptions &options, std::string &deviceName) {
+        auto window = EasyGui::CreateWindow(EasyGui::WindowSpec{
+            .title = std::string(workload.Name),
+            .width = options.width,
+            .height = options.height,
+            .headless = true,
+            .bindlessTextures = options.bindless
+        });
+
+        deviceName = window->GetPhysicalDevice().getProperties().deviceName.data();
+
+        auto layer = workload.Create(*window);
+        window->PushLayer(layer);
+
+        std::vector<EasyGui::FrameTimings> samples;
+        samples.reserve(options.frames);
+        for (size_t frame = 0; frame < options.warmupFrames + options.frames; frame++) {
+            window->DrawFrame();
+            if (frame >= options.warmupFrames) {
+                samples.push_back(window->GetLastFrameTimings());
+            }
+        }
+
+        window->GetLogicalDevice().waitIdle();
+        window->PopLayer(layer);
+        layer.reset();
+
+        auto phase = [&](double EasyGui::FrameTimings::*member) {
+            std::vector<double> values;
+            values.reserve(samples.size());
+            for (const auto &sample: samples) values.push_back(sample.*member);
+            return ComputeStatistics(std::move(values));
+        };
+
+        return {
+            .Name = workload.Name,
+            .Phases = {
+                {"imguiBuild", phase(&EasyGui::FrameTimings::ImGuiBuildMs)},
+                {"fenceWait", phase(&EasyGui::FrameTimings::FenceWaitMs)},
+                {"acquire", phase(&EasyGui::FrameTimings::AcquireMs)},
+                {"record", phase(&EasyGui::FrameTimings::RecordMs)},
+                {"submitPresent", phase(&EasyGui::FrameTimings::SubmitPresentMs)},
+                {"total", phase(&EasyGui::FrameTimings::TotalMs)},
+            }
+        };
+    }
+
+    std::string EscapeJson(std::string_view text) {
+        std::string escaped;
+        for (char c: text) {
+            if (c == '"' || c == '\\') escaped += '\\';
+            if (static_cast<unsigned char>(c) < 0x20) continue;
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    void WriteJson(std::ostream &os, const BenchmarkOptions &options, std::string_view deviceName,
+                   const std::vector<WorkloadResult> &results) {
+        os << "{\n";
+        os << std::format("  \"device\": \"{}\",\n", EscapeJson(deviceName));
+        os << std::format("  \"frames\": {},\n  \"warmupFrames\": {},\n", options.frames, options.warmupFrames);
+        os << std::format("  \"width\": {},\n  \"height\": {},\n", options.width, options.height);
+        os << std::format("  \"bindless\": {},\n", options.bindless);
+        os << "  \"unit\": \"ms\",\n";
+        os << "  \"workloads\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const auto &result = results[i];
+            os << std::format("    {{\n      \"name\": \"{}\",\n      \"phases\": {{\n", result.Name);
+            for (size_t j = 0; j < result.Phases.size(); j++) {
+                const auto &[name, stats] = result.Phases[j];
+                os << std::format(
+                    "        \"{}\": {{\"mean\": {:.4f}, \"p50\": {:.4f}, \"p95\": {:.4f}, \"p99\": {:.4f}, \"max\": {:.4f}}}{}\n",
+                    name, stats.Mean, stats.P50, stats.P95, stats.P99, stats.Max,
+                    j + 1 < result.Phases.size() ? "," : "");
+            }
+            os << std::format("      }}\n    }}{}\n", i + 1 < results.size() ? "," : "");
+        }
+        os << "  ]\n}\n";
+    }
+
+    void PrintUsage(const char *program) {
+        std::println("usage: {} [--frames N] [--warmup N] [--width W] [--height H] "
+                     "[--workload all|widgets|table|images|docking] [--output file.json] [--bindless]",
+                     program);
+    }
+
+    std::optional<BenchmarkOptions> ParseOptions(int argc, char **argv) {
+        BenchmarkOptions options;
+        // a missing or malformed value ends up here too
+        try {
+            for (int i = 1; i < argc; i++) {
+                std::string_view arg = argv[i];
+                auto next = [&]() -> std::string_view {
+                    if (i + 1 >= argc) throw std::runtime_error(std::format("missing value for {}", arg));
+                    return argv[++i];
+                };
+
+                if (arg == "--frames") options.frames = std::stoul(std::string(next()));
+                else if (arg == "--warmup") options.warmupFrames = std::stoul(std::string(next()));
+                else if (arg == "--width") options.width = std::stoi(std::string(next()));
+                else if (arg == "--height") options.height = std::stoi(std::string(next()));
+                else if (arg == "--workload") options.workload = next();
+                else if (arg == "--output") options.output = next();
+                else if (arg == "--bindless") options.bindless = true;
+                else {
+                    PrintUsage(argv[0]);
+                    return std::nullopt;
+                }
+            }
+        } catch (const std::exception &e) {
+            std::println(std::cerr, "invalid arguments: {}", e.what());
+            PrintUsage(argv[0]);
+            return std::nullopt;
+        }
+        return options;
+    }
+}
+
+int main(int argc, char **argv) {
+    auto options = ParseOptions(argc, argv);
+    if (!options) return 1;
+
+    // no display is needed, the environment variable still wins if it is set
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen,dummy");
+    EasyGui::GlobalContext::Init();
+
+    std::string deviceName;
+    std::vector<WorkloadResult> results;
+    for (const auto &workload: GetWorkloads()) {
+        if (options->workload != "all" && options->workload != workload.Name) continue;
+
+        auto result = RunWorkload(workload, *options, deviceName);
+        const auto &total = result.Phases.back().second;
+        std::println("{:<10} p50 {:8.3f} ms  p95 {:8.3f} ms  p99 {:8.3f} ms",
+                     result.Name, total.P50, total.P95, total.P99);
+        results.push_back(std::move(result));
+    }
+
+    EasyGui::GlobalContext::Shutdown();
+
+    if (results.empty()) {
+        std::println(std::cerr, "no workload named {}", options->workload);
+        return 1;
+    }
+
+    std::ofstream file(options->output);
+    WriteJson(file, *options, deviceName, results);
+    std::println("wrote {}", options->output.string());
+
+    return 0;
+}
@@ -0,0 +1,209 @@
+import std;
+import EasyGui;
+
+// Times the parallel algorithms against their serial counterparts on GlobalThreadPool and reports the median of
+// several repetitions as JSON:
+//   EasyGuiParallelBenchmark --size 10000000 --repetitions 20 --output parallel_times.json
+
+namespace {
+    struct BenchmarkOptions {
+        size_t size = 10'000'000;
+        size_t repetitions = 15;
+        size_t threads = 0;
+        std::string workload = "all";
+        std::filesystem::path output = "parallel_benchmark.json";
+    };
+
+    struct Workload {
+        std::string_view Name;
+        // called once per repetition, before the timed part
+        std::function<void()> Reset;
+        std::function<void()> Serial;
+        std::function<void()> Parallel;
+    };
+
+    // the results are consumed so the serial loops are not optimized away
+    double s_Sink = 0.0;
+
+    std::vector<Workload> GetWorkloads(const BenchmarkOptions &options) {
+        auto input = std::make_shared<std::vector<float>>(options.size);
+        auto output = std::make_shared<std::vector<float>>(options.size);
+        auto keys = std::make_shared<std::vector<std::uint32_t>>(options.size);
+        auto unsortedKeys = std::make_shared<std::vector<std::uint32_t>>(options.size);
+
+        std::mt19937 random(42);
+        std::uniform_real_distribution<float> values(0.0f, 1000.0f);
+        for (float &value: *input) value = values(random);
+        for (std::uint32_t &key: *unsortedKeys) key = random();
+
+        auto noReset = [] {};
+        return {
+            {
+                "for", noReset,
+                [=] {
+                    for (size_t i = 0; i < input->size(); i++) {
+                        (*output)[i] = std::sqrt((*input)[i]) * std::sin((*input)[i]);
+                    }
+                    s_Sink += output->back();
+                },
+                [=] {
+                    EasyGui::ParallelFor(input->size(), [&](size_t i) {
+                        (*output)[i] = std::sqrt((*input)[i]) * std::sin((*input)[i]);
+                    });
+                    s_Sink += output->back();
+                }
+            },
+            {
+                "transform", noReset,
+                [=] {
+                    std::ranges::transform(*input, output->begin(), [](float x) { return x * 0.5f + 1.0f; });
+                    s_Sink += output->back();
+                },
+                [=] {
+                    EasyGui::ParallelTransform(*input, output->begin(), [](float x) { return x * 0.5f + 1.0f; });
+                    s_Sink += output->back();
+                }
+            },
+            {
+                "reduce", noReset,
+                [=] {
+                    s_Sink += std::accumulate(input->begin(), input->end(), 0.0, [](double sum, float x) {
+                        return sum + static_cast<double>(x) * x;
+                    });
+                },
+                [=] {
+                    s_Sink += EasyGui::ParallelReduce(*input, 0.0, std::plus<>{}, [](float x) {
+                        return static_cast<double>(x) * x;
+                    });
+                }
+            },
+            {
+                "sort", [=] { *keys = *unsortedKeys; },
+                [=] {
+                    std::ranges::sort(*keys);
+                    s_Sink += keys->front();
+                },
+                [=] {
+                    EasyGui::ParallelSort(*keys);
+                    s_Sink += keys->front();
+                }
+            },
+        };
+    }
+
+    double Median(std::vector<double> samples) {
+        std::ranges::sort(samples);
+        return samples[samples.size() / 2];
+    }
+
+    double TimeMs(const Workload &workload, const std::function<void()> &run, size_t repetitions) {
+        std::vector<double> samples;
+        samples.reserve(repetitions);
+        // one untimed run warms the caches and the pool
+        for (size_t repetition = 0; repetition <= repetitions; repetition++) {
+            workload.Reset();
+            auto start = std::chrono::steady_clock::now();
+            run();
+            auto end = std::chrono::steady_clock::now();
+            if (repetition > 0) {
+                samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+            }
+        }
+        return Median(std::move(samples));
+    }
+
+    struct WorkloadResult {
+        std::string_view Name;
+        double SerialMs = 0.0;
+        double ParallelMs = 0.0;
+    };
+
+    void WriteJson(std::ostream &os, const BenchmarkOptions &options, size_t threadCount,
+                   const std::vector<WorkloadResult> &results) {
+        os << "{\n";
+        os << std::format("  \"size\": {},\n  \"repetitions\": {},\n", options.size, options.repetitions);
+        os << std::format("  \"threads\": {},\n", threadCount);
+        os << "  \"unit\": \"ms\",\n";
+        os << "  \"workloads\": [\n";
+        for (size_t i = 0; i < results.size(); i++) {
+            const auto &result = results[i];
+            os << std::format(
+                "    {{\"name\": \"{}\", \"serial\": {:.4f}, \"parallel\": {:.4f}, \"speedup\": {:.3f}}}{}\n",
+                result.Name, result.SerialMs, result.ParallelMs, result.SerialMs / result.ParallelMs,
+                i + 1 < results.size() ? "," : "");
+        }
+        os << "  ]\n}\n";
+    }
+
+    void PrintUsage(const char *program) {
+        std::println("usage: {} [--size N] [--repetitions N] [--threads N] "
+                     "[--workload all|for|transform|reduce|sort] [--output file.json]",
+                     program);
+    }
+
+    std::optional<BenchmarkOptions> ParseOptions(int argc, char **argv) {
+        BenchmarkOptions options;
+        // a missing or malformed value ends up here too
+        try {
+            for (int i = 1; i < argc; i++) {
+                std::string_view arg = argv[i];
+                auto next = [&]() -> std::string_view {
+                    if (i + 1 >= argc) throw std::runtime_error(std::format("missing value for {}", arg));
+                    return argv[++i];
+                };
+
+                if (arg == "--size") options.size = std::stoul(std::string(next()));
+                else if (arg == "--repetitions") options.repetitions = std::stoul(std::string(next()));
+                else if (arg == "--threads") options.threads = std::stoul(std::string(next()));
+                else if (arg == "--workload") options.workload = next();
+                else if (arg == "--output") options.output = next();
+                else {
+                    PrintUsage(argv[0]);
+                    return std::nullopt;
+                }
+            }
+        } catch (const std::exception &e) {
+            std::println(std::cerr, "invalid arguments: {}", e.what());
+            PrintUsage(argv[0]);
+            return std::nullopt;
+        }
+        if (options.size == 0 || options.repetitions == 0) {
+            std::println(std::cerr, "size and repetitions must be positive");
+            return std::nullopt;
+        }
+        return options;
+    }
+}
+
+int main(int argc, char **argv) {
+    auto options = ParseOptions(argc, argv);
+    if (!options) return 1;
+
+    EasyGui::SetGlobalThreadPoolSize(options->threads);
+    size_t threadCount = EasyGui::GlobalThreadPool()->GetThreadCount();
+
+    std::vector<WorkloadResult> results;
+    for (const auto &workload: GetWorkloads(*options)) {
+        if (options->workload != "all" && options->workload != workload.Name) continue;
+
+        WorkloadResult result{
+            .Name = workload.Name,
+            .SerialMs = TimeMs(workload, workload.Serial, options->repetitions),
+            .ParallelMs = TimeMs(workload, workload.Parallel, options->repetitions)
+        };
+        std::println("{:<10} serial {:9.3f} ms  parallel {:9.3f} ms  speedup {:6.2f}x",
+                     result.Name, result.SerialMs, result.ParallelMs, result.SerialMs / result.ParallelMs);
+        results.push_back(result);
+    }
+
+    if (results.empty()) {
+        std::println(std::cerr, "no workload named {}", options->workload);
+        return 1;
+    }
+
+    std::ofstream file(options->output);
+    WriteJson(file, *options, threadCount, results);
+    std::println("wrote {} ({} workers, checksum {})", options->output.string(), threadCount, s_Sink);
+
+    return 0;
+}
@@ -2,14 +2,29 @@ export module EasyGui;
 
 export import EasyGui.Window;
 export import EasyGui.Graphics.GraphicsContext;
+export import EasyGui.Graphics.StagingRing;
+export import EasyGui.Graphics.TextureUploader;
+export import EasyGui.Graphics.BindlessTextureTable;
 export import EasyGui.Event.AllEvents;
 export import EasyGui.UI.Utils;
 export import EasyGui.Core.KeyCodes;
 export import EasyGui.Core.MouseCodes;
 export import EasyGui.Lib;
 export import EasyGui.SoLoud;
+#ifdef _WIN32
 export import EasyGui.Utils.WindowsApi;
+#endif
+export import EasyGui.Utils.MappedFile;
 export import EasyGui.Utils.Atomic;
 export import EasyGui.Utils.Image;
+export import EasyGui.Utils.TextureCache;
+export import EasyGui.Utils.ImageBatchLoader;
+export import EasyGui.Utils.PixelConversion;
+export import EasyGui.Utils.ImageResize;
+export import EasyGui.Utils.FontAtlasCache;
 export import EasyGui.Utils.AsyncProvider;
 export import EasyGui.Tools.ThreadPool;
+export import EasyGui.Tools.TaskGraph;
+export import EasyGui.Tools.Parallel;
+export import EasyGui.Tools.Profiler;
+export import EasyGui.UI.ProfilerPanel;
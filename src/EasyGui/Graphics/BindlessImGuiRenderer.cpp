@@ -0,0 +1,523 @@
+module EasyGui.Graphics.BindlessImGuiRenderer;
+
+import std;
+
+import "EasyGui/Lib/Lib.hpp";
+
+namespace EasyGui {
+    namespace {
+        // compiled from Shaders/BindlessImGui.vert and .frag at build time, see CMakeLists.txt
+        constexpr uint32_t s_VertexShaderSpirv[] = {
+#include "EasyGui/Shaders/BindlessImGui.vert.inc"
+        };
+
+        constexpr uint32_t s_FragmentShaderSpirv[] = {
+#include "EasyGui/Shaders/BindlessImGui.frag.inc"
+        };
+
+        constexpr vk::ShaderStageFlags s_PushConstantStages =
+                vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
+
+        // ImDrawVert is {ImVec2 pos; ImVec2 uv; ImU32 col;}
+        static_assert(sizeof(ImDrawVert) == 20);
+        constexpr uint32_t s_VertexPositionOffset = 0;
+        constexpr uint32_t s_VertexUVOffset = 8;
+        constexpr uint32_t s_VertexColorOffset = 16;
+
+        constexpr vk::DeviceSize s_MinGeometryBufferSize = 64 * 1024;
+    }
+
+    BindlessImGuiRenderer::BindlessImGuiRenderer(GraphicsContext &context, BindlessTextureTable &textureTable)
+        : m_Context(context), m_TextureTable(textureTable) {
+        CreatePipeline();
+
+        ImGuiIO &io = ImGui::GetIO();
+        io.BackendRendererName = "EasyGui_Bindless";
+        io.BackendRendererUserData = this;
+        io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+        io.BackendFlags |= ImGuiBackendFlags_RendererHasTextures;
+
+        auto maxDimension = static_cast<int>(m_Context.GetPhysicalDevice().getProperties().limits.maxImageDimension2D);
+        ImGuiPlatformIO &platformIO = ImGui::GetPlatformIO();
+        platformIO.Renderer_TextureMaxWidth = maxDimension;
+        platformIO.Renderer_TextureMaxHeight = maxDimension;
+    }
+
+    BindlessImGuiRenderer::~BindlessImGuiRenderer() {
+        for (ImTextureData *texture: ImGui::GetPlatformIO().Textures) {
+            if (texture->RefCount == 1) {
+                DestroyTexture(texture);
+            }
+        }
+
+        ImGuiIO &io = ImGui::GetIO();
+        io.BackendRendererName = nullptr;
+        io.BackendRendererUserData = nullptr;
+        io.BackendFlags &= ~(ImGuiBackendFlags_RendererHasVtxOffset | ImGuiBackendFlags_RendererHasTextures);
+    }
+
+    void BindlessImGuiRenderer::CreatePipeline() {
+        auto &device = m_Context.GetLogicalDevice();
+
+        vk::raii::ShaderModule vertexShader = device.createShaderModule(vk::ShaderModuleCreateInfo{
+            .codeSize = sizeof(s_VertexShaderSpirv),
+            .pCode = s_VertexShaderSpirv
+        }).value();
+
+        vk::raii::ShaderModule fragmentShader = device.createShaderModule(vk::ShaderModuleCreateInfo{
+            .codeSize = sizeof(s_FragmentShaderSpirv),
+            .pCode = s_FragmentShaderSpirv
+        }).value();
+
+        std::array shaderStages{
+            vk::PipelineShaderStageCreateInfo{
+                .stage = vk::ShaderStageFlagBits::eVertex,
+                .module = *vertexShader,
+                .pName = "main"
+            },
+            vk::PipelineShaderStageCreateInfo{
+                .stage = vk::ShaderStageFlagBits::eFragment,
+                .module = *fragmentShader,
+                .pName = "main"
+            }
+        };
+
+        vk::VertexInputBindingDescription vertexBinding{
+            .binding = 0,
+            .stride = sizeof(ImDrawVert),
+            .inputRate = vk::VertexInputRate::eVertex
+        };
+
+        std::array vertexAttributes{
+            vk::VertexInputAttributeDescription{
+                .location = 0, .binding = 0, .format = vk::Format::eR32G32Sfloat, .offset = s_VertexPositionOffset
+            },
+            vk::VertexInputAttributeDescription{
+                .location = 1, .binding = 0, .format = vk::Format::eR32G32Sfloat, .offset = s_VertexUVOffset
+            },
+            vk::VertexInputAttributeDescription{
+                .location = 2, .binding = 0, .format = vk::Format::eR8G8B8A8Unorm, .offset = s_VertexColorOffset
+            }
+        };
+
+        vk::PipelineVertexInputStateCreateInfo vertexInputState{
+            .vertexBindingDescriptionCount = 1,
+            .pVertexBindingDescriptions = &vertexBinding,
+            .vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexAttributes.size()),
+            .pVertexAttributeDescriptions = vertexAttributes.data()
+        };
+
+        vk::PipelineInputAssemblyStateCreateInfo inputAssemblyState{
+            .topology = vk::PrimitiveTopology::eTriangleList
+        };
+
+        vk::PipelineViewportStateCreateInfo viewportState{
+            .viewportCount = 1,
+            .scissorCount = 1
+        };
+
+        vk::PipelineRasterizationStateCreateInfo rasterizationState{
+            .polygonMode = vk::PolygonMode::eFill,
+            .cullMode = vk::CullModeFlagBits::eNone,
+            .frontFace = vk::FrontFace::eCounterClockwise,
+            .lineWidth = 1.0f
+        };
+
+        vk::PipelineMultisampleStateCreateInfo multisampleState{
+            .rasterizationSamples = vk::SampleCountFlagBits::e1
+        };
+
+        vk::PipelineColorBlendAttachmentState colorBlendAttachment{
+            .blendEnable = vk::True,
+            .srcColorBlendFactor = vk::BlendFactor::eSrcAlpha,
+            .dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
+            .colorBlendOp = vk::BlendOp::eAdd,
+            .srcAlphaBlendFactor = vk::BlendFactor::eOne,
+            .dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
+            .alphaBlendOp = vk::BlendOp::eAdd,
+            .colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+                              vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
+        };
+
+        vk::PipelineColorBlendStateCreateInfo colorBlendState{
+            .attachmentCount = 1,
+            .pAttachments = &colorBlendAttachment
+        };
+
+        std::array dynamicStates{vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+        vk::PipelineDynamicStateCreateInfo dynamicState{
+            .dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
+            .pDynamicStates = dynamicStates.data()
+        };
+
+        vk::PushConstantRange pushConstantRange{
+            .stageFlags = s_PushConstantStages,
+            .offset = 0,
+            .size = sizeof(PushConstants)
+        };
+
+        vk::DescriptorSetLayout setLayout = m_TextureTable.GetSetLayout();
+        m_PipelineLayout = device.createPipelineLayout(vk::PipelineLayoutCreateInfo{
+            .setLayoutCount = 1,
+            .pSetLayouts = &setLayout,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &pushConstantRange
+        }).value();
+
+        vk::GraphicsPipelineCreateInfo pipelineInfo{
+            .stageCount = static_cast<uint32_t>(shaderStages.size()),
+            .pStages = shaderStages.data(),
+            .pVertexInputState = &vertexInputState,
+            .pInputAssemblyState = &inputAssemblyState,
+            .pViewportState = &viewportState,
+            .pRasterizationState = &rasterizationState,
+            .pMultisampleState = &multisampleState,
+            .pColorBlendState = &colorBlendState,
+            .pDynamicState = &dynamicState,
+            .layout = *m_PipelineLayout,
+            .renderPass = *m_Context.GetRenderPass(),
+            .subpass = 0
+        };
+
+        m_Pipeline = device.createGraphicsPipeline(m_Context.GetPipelineCache(), pipelineInfo).value();
+    }
+
+    void BindlessImGuiRenderer::EnsureCapacity(GeometryBuffer &buffer, vk::DeviceSize size,
+                                               vk::BufferUsageFlags usage) {
+        if (buffer.Size >= size) return;
+
+        vk::DeviceSize newSize = std::max({size, buffer.Size * 2, s_MinGeometryBufferSize});
+
+        vk::BufferCreateInfo bufferInfo{
+            .size = newSize,
+            .usage = usage,
+            .sharingMode = vk::SharingMode::eExclusive
+        };
+
+        vma::AllocationCreateInfo allocInfo{
+            .flags = vma::AllocationCreateFlagBits::eHostAccessSequentialWrite |
+                     vma::AllocationCreateFlagBits::eMapped,
+            .usage = vma::MemoryUsage::eAuto
+        };
+
+        // the fence of this frame slot has been waited on, nothing reads the old buffer anymore
+        vma::AllocationInfo info;
+        auto [newBuffer, allocation] = m_Context.GetAllocator()->createBufferUnique(bufferInfo, allocInfo, &info).value;
+        buffer.Buffer = std::move(newBuffer);
+        buffer.Allocation = std::move(allocation);
+        buffer.Mapped = static_cast<std::byte *>(info.pMappedData);
+        buffer.Size = newSize;
+    }
+
+    void BindlessImGuiRenderer::SetupRenderState(ImDrawData *drawData, vk::CommandBuffer commandBuffer,
+                                                 const FrameGeometry &geometry,
+                                                 int framebufferWidth, int framebufferHeight) {
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *m_Pipeline);
+
+        // the only descriptor bind of the frame
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *m_PipelineLayout, 0,
+                                         m_TextureTable.GetDescriptorSet(), {});
+
+        if (drawData->TotalVtxCount > 0) {
+            vk::Buffer vertexBuffer = *geometry.Vertices.Buffer;
+            vk::DeviceSize vertexOffset = 0;
+            commandBuffer.bindVertexBuffers(0, vertexBuffer, vertexOffset);
+            commandBuffer.bindIndexBuffer(*geometry.Indices.Buffer, 0,
+                                          sizeof(ImDrawIdx) == 2 ? vk::IndexType::eUint16 : vk::IndexType::eUint32);
+        }
+
+        commandBuffer.setViewport(0, vk::Viewport{
+            .x = 0.0f,
+            .y = 0.0f,
+            .width = static_cast<float>(framebufferWidth),
+            .height = static_cast<float>(framebufferHeight),
+            .minDepth = 0.0f,
+            .maxDepth = 1.0f
+        });
+
+        // maps the ImGui display rectangle to clip space
+        float scaleX = 2.0f / drawData->DisplaySize.x;
+        float scaleY = 2.0f / drawData->DisplaySize.y;
+        std::array transform{
+            scaleX, scaleY,
+            -1.0f - drawData->DisplayPos.x * scaleX, -1.0f - drawData->DisplayPos.y * scaleY
+        };
+        commandBuffer.pushConstants<float>(*m_PipelineLayout, s_PushConstantStages, 0, transform);
+    }
+
+    void BindlessImGuiRenderer::RenderDrawData(ImDrawData *drawData, vk::CommandBuffer commandBuffer,
+                                               size_t currentFrame) {
+        int framebufferWidth = static_cast<int>(drawData->DisplaySize.x * drawData->FramebufferScale.x);
+        int framebufferHeight = static_cast<int>(drawData->DisplaySize.y * drawData->FramebufferScale.y);
+        if (framebufferWidth <= 0 || framebufferHeight <= 0) return;
+
+        auto &geometry = m_FrameGeometry[currentFrame];
+        if (drawData->TotalVtxCount > 0) {
+            EnsureCapacity(geometry.Vertices, drawData->TotalVtxCount * sizeof(ImDrawVert),
+                           vk::BufferUsageFlagBits::eVertexBuffer);
+            EnsureCapacity(geometry.Indices, drawData->TotalIdxCount * sizeof(ImDrawIdx),
+                           vk::BufferUsageFlagBits::eIndexBuffer);
+
+            std::byte *vertices = geometry.Vertices.Mapped;
+            std::byte *indices = geometry.Indices.Mapped;
+            for (const ImDrawList *drawList: drawData->CmdLists) {
+                size_t vertexBytes = drawList->VtxBuffer.Size * sizeof(ImDrawVert);
+                size_t indexBytes = drawList->IdxBuffer.Size * sizeof(ImDrawIdx);
+                std::memcpy(vertices, drawList->VtxBuffer.Data, vertexBytes);
+                std::memcpy(indices, drawList->IdxBuffer.Data, indexBytes);
+                vertices += vertexBytes;
+                indices += indexBytes;
+            }
+
+            vma::Allocator allocator = *m_Context.GetAllocator();
+            std::ignore = allocator.flushAllocation(*geometry.Vertices.Allocation, 0, vk::WholeSize);
+            std::ignore = allocator.flushAllocation(*geometry.Indices.Allocation, 0, vk::WholeSize);
+        }
+
+        SetupRenderState(drawData, commandBuffer, geometry, framebufferWidth, framebufferHeight);
+
+        ImVec2 clipOffset = drawData->DisplayPos;
+        ImVec2 clipScale = drawData->FramebufferScale;
+
+        // no texture is pushed yet
+        uint32_t pushedTexture = std::numeric_limits<uint32_t>::max();
+        uint32_t globalVertexOffset = 0;
+        uint32_t globalIndexOffset = 0;
+
+        for (const ImDrawList *drawList: drawData->CmdLists) {
+            for (const ImDrawCmd &drawCommand: drawList->CmdBuffer) {
+                if (drawCommand.UserCallback) {
+                    if (drawCommand.UserCallback == ImDrawCallback_ResetRenderState) {
+                        SetupRenderState(drawData, commandBuffer, geometry, framebufferWidth, framebufferHeight);
+                        pushedTexture = std::numeric_limits<uint32_t>::max();
+                    } else {
+                        drawCommand.UserCallback(drawList, &drawCommand);
+                    }
+                    continue;
+                }
+
+                ImVec2 clipMin{
+                    std::max((drawCommand.ClipRect.x - clipOffset.x) * clipScale.x, 0.0f),
+                    std::max((drawCommand.ClipRect.y - clipOffset.y) * clipScale.y, 0.0f)
+                };
+                ImVec2 clipMax{
+                    std::min((drawCommand.ClipRect.z - clipOffset.x) * clipScale.x, static_cast<float>(framebufferWidth)),
+                    std::min((drawCommand.ClipRect.w - clipOffset.y) * clipScale.y, static_cast<float>(framebufferHeight))
+                };
+                if (clipMax.x <= clipMin.x || clipMax.y <= clipMin.y) continue;
+
+                commandBuffer.setScissor(0, vk::Rect2D{
+                    .offset = {static_cast<int32_t>(clipMin.x), static_cast<int32_t>(clipMin.y)},
+                    .extent = {static_cast<uint32_t>(clipMax.x - clipMin.x), static_cast<uint32_t>(clipMax.y - clipMin.y)}
+                });
+
+                auto textureIndex = static_cast<uint32_t>(drawCommand.GetTexID());
+                if (textureIndex != pushedTexture) {
+                    commandBuffer.pushConstants<uint32_t>(*m_PipelineLayout, s_PushConstantStages,
+                                                          sizeof(float) * 4, textureIndex);
+                    pushedTexture = textureIndex;
+                }
+
+                commandBuffer.drawIndexed(drawCommand.ElemCount, 1,
+                                          drawCommand.IdxOffset + globalIndexOffset,
+                                          static_cast<int32_t>(drawCommand.VtxOffset + globalVertexOffset), 0);
+            }
+
+            globalIndexOffset += drawList->IdxBuffer.Size;
+            globalVertexOffset += drawList->VtxBuffer.Size;
+        }
+
+        // layers recording after ImGui expect the whole framebuffer
+        commandBuffer.setScissor(0, vk::Rect2D{
+            .offset = {0, 0},
+            .extent = {static_cast<uint32_t>(framebufferWidth), static_cast<uint32_t>(framebufferHeight)}
+        });
+    }
+
+    void BindlessImGuiRenderer::UpdateTextures(vk::CommandBuffer commandBuffer, ImDrawData *drawData) {
+        if (!drawData->Textures) return;
+
+        for (ImTextureData *texture: *drawData->Textures) {
+            switch (texture->Status) {
+                case ImTextureStatus_WantCreate:
+                    CreateTexture(commandBuffer, texture);
+                    break;
+                case ImTextureStatus_WantUpdates:
+                    for (const ImTextureRect &rect: texture->Updates) {
+                        UploadTextureRect(commandBuffer, texture, rect, vk::ImageLayout::eShaderReadOnlyOptimal);
+                    }
+                    texture->SetStatus(ImTextureStatus_OK);
+                    break;
+                case ImTextureStatus_WantDestroy:
+                    // frames in flight are covered by the deletion queue, the current one must not use it
+                    if (texture->UnusedFrames > 0) {
+                        DestroyTexture(texture);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    void BindlessImGuiRenderer::CreateTexture(vk::CommandBuffer commandBuffer, ImTextureData *texture) {
+        auto width = static_cast<uint32_t>(texture->Width);
+        auto height = static_cast<uint32_t>(texture->Height);
+        // alpha only atlases are expanded to white RGBA while uploading
+        constexpr vk::Format format = vk::Format::eR8G8B8A8Unorm;
+
+        vk::ImageCreateInfo imageInfo{
+            .imageType = vk::ImageType::e2D,
+            .format = format,
+            .extent = {
+                .width = width,
+                .height = height,
+                .depth = 1
+            },
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = vk::SampleCountFlagBits::e1,
+            .tiling = vk::ImageTiling::eOptimal,
+            .usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .initialLayout = vk::ImageLayout::eUndefined
+        };
+
+        vma::AllocationCreateInfo allocInfo{
+            .usage = vma::MemoryUsage::eAutoPreferDevice
+        };
+
+        auto [image, memory] = m_Context.GetAllocator()->createImageUnique(imageInfo, allocInfo).value;
+
+        vk::ImageViewCreateInfo viewInfo{
+            .image = *image,
+            .viewType = vk::ImageViewType::e2D,
+            .format = format,
+            .subresourceRange = {
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            }
+        };
+
+        vk::UniqueImageView imageView = (*m_Context.GetLogicalDevice()).createImageViewUnique(viewInfo).value;
+        uint32_t index = m_TextureTable.Register(*imageView, *m_Context.GetSampler());
+
+        auto *backendTexture = new Texture{
+            .Image = Vulkan::PixelImage(std::move(image), std::move(memory), std::move(imageView),
+                                        width, height, &m_Context.GetDeletionQueue()),
+            .Index = index
+        };
+        texture->BackendUserData = backendTexture;
+        texture->SetTexID(static_cast<ImTextureID>(index));
+
+        UploadTextureRect(commandBuffer, texture,
+                          ImTextureRect{
+                              0, 0,
+                              static_cast<unsigned short>(width), static_cast<unsigned short>(height)
+                          },
+                          vk::ImageLayout::eUndefined);
+        texture->SetStatus(ImTextureStatus_OK);
+    }
+
+    void BindlessImGuiRenderer::UploadTextureRect(vk::CommandBuffer commandBuffer, ImTextureData *texture,
+                                                  const ImTextureRect &rect, vk::ImageLayout oldLayout) {
+        auto *backendTexture = static_cast<Texture *>(texture->BackendUserData);
+        vk::Image image = backendTexture->Image.GetImage();
+
+        // written straight into the mapped ring, read by this frame's command buffer
+        size_t rowBytes = static_cast<size_t>(rect.w) * 4;
+        auto &stagingRing = m_Context.GetStagingRing();
+        StagingAllocation staging = stagingRing.Allocate(rowBytes * rect.h);
+        for (int y = 0; y < rect.h; y++) {
+            auto *source = static_cast<const std::byte *>(texture->GetPixelsAt(rect.x, rect.y + y));
+            std::byte *destination = staging.Data.data() + y * rowBytes;
+
+            if (texture->Format == ImTextureFormat_RGBA32) {
+                std::memcpy(destination, source, rowBytes);
+            } else {
+                for (int x = 0; x < rect.w; x++) {
+                    destination[x * 4 + 0] = std::byte{255};
+                    destination[x * 4 + 1] = std::byte{255};
+                    destination[x * 4 + 2] = std::byte{255};
+                    destination[x * 4 + 3] = source[x];
+                }
+            }
+        }
+        stagingRing.Flush(staging);
+        stagingRing.Release(staging, m_Context.GetFrameNumber() + 1);
+
+        vk::ImageSubresourceRange range{
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        };
+
+        bool firstUpload = oldLayout == vk::ImageLayout::eUndefined;
+        vk::ImageMemoryBarrier toTransferBarrier{
+            .srcAccessMask = firstUpload ? vk::AccessFlagBits::eNone : vk::AccessFlagBits::eShaderRead,
+            .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .oldLayout = oldLayout,
+            .newLayout = vk::ImageLayout::eTransferDstOptimal,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .image = image,
+            .subresourceRange = range
+        };
+
+        commandBuffer.pipelineBarrier(
+            firstUpload ? vk::PipelineStageFlagBits::eTopOfPipe : vk::PipelineStageFlagBits::eFragmentShader,
+            vk::PipelineStageFlagBits::eTransfer,
+            {}, {}, {}, toTransferBarrier
+        );
+
+        vk::BufferImageCopy region{
+            .bufferOffset = staging.Offset,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = {
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            },
+            .imageOffset = {rect.x, rect.y, 0},
+            .imageExtent = {rect.w, rect.h, 1}
+        };
+
+        commandBuffer.copyBufferToImage(staging.Buffer, image, vk::ImageLayout::eTransferDstOptimal, region);
+
+        vk::ImageMemoryBarrier toShaderBarrier{
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eShaderRead,
+            .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+            .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .image = image,
+            .subresourceRange = range
+        };
+
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eFragmentShader,
+            {}, {}, {}, toShaderBarrier
+        );
+    }
+
+    void BindlessImGuiRenderer::DestroyTexture(ImTextureData *texture) {
+        // the image is retired through the deletion queue together with its index
+        if (auto *backendTexture = static_cast<Texture *>(texture->BackendUserData)) {
+            m_TextureTable.Unregister(backendTexture->Index);
+            delete backendTexture;
+        }
+
+        texture->BackendUserData = nullptr;
+        texture->SetTexID(ImTextureID_Invalid);
+        texture->SetStatus(ImTextureStatus_Destroyed);
+    }
+}
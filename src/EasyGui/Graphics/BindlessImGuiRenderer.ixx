@@ -0,0 +1,78 @@
+export module EasyGui.Graphics.BindlessImGuiRenderer;
+
+import std;
+import EasyGui.Lib;
+import EasyGui.Graphics.GraphicsContext;
+import EasyGui.Graphics.BindlessTextureTable;
+import EasyGui.Utils.Image;
+
+namespace EasyGui {
+    // ImGui renderer backend drawing every texture through a BindlessTextureTable.
+    //
+    // Replaces ImGui_ImplVulkan for the main viewport: the descriptor set of the table is bound once per frame and
+    // each draw command only pushes its texture index. ImGui owned textures such as the font atlas are registered in
+    // the same table, so every ImTextureID is an index. Textures are uploaded from the staging ring with copies
+    // recorded into the frame command buffer, so UpdateTextures has to run before the render pass begins.
+    export class BindlessImGuiRenderer {
+    public:
+        BindlessImGuiRenderer(GraphicsContext &context, BindlessTextureTable &textureTable);
+
+        BindlessImGuiRenderer(const BindlessImGuiRenderer &) = delete;
+
+        BindlessImGuiRenderer &operator=(const BindlessImGuiRenderer &) = delete;
+
+        ~BindlessImGuiRenderer();
+
+        // creates, updates and destroys the textures ImGui asks for, outside of a render pass
+        void UpdateTextures(vk::CommandBuffer commandBuffer, ImDrawData *drawData);
+
+        void RenderDrawData(ImDrawData *drawData, vk::CommandBuffer commandBuffer, size_t currentFrame);
+
+    private:
+        struct PushConstants {
+            float Scale[2];
+            float Translate[2];
+            uint32_t TextureIndex;
+        };
+
+        // host visible and persistently mapped, one per frame in flight
+        struct GeometryBuffer {
+            vma::UniqueBuffer Buffer;
+            vma::UniqueAllocation Allocation;
+            std::byte *Mapped = nullptr;
+            vk::DeviceSize Size = 0;
+        };
+
+        struct FrameGeometry {
+            GeometryBuffer Vertices;
+            GeometryBuffer Indices;
+        };
+
+        struct Texture {
+            Vulkan::PixelImage Image;
+            uint32_t Index = 0;
+        };
+
+        void CreatePipeline();
+
+        void EnsureCapacity(GeometryBuffer &buffer, vk::DeviceSize size, vk::BufferUsageFlags usage);
+
+        void SetupRenderState(ImDrawData *drawData, vk::CommandBuffer commandBuffer, const FrameGeometry &geometry,
+                              int framebufferWidth, int framebufferHeight);
+
+        void CreateTexture(vk::CommandBuffer commandBuffer, ImTextureData *texture);
+
+        void UploadTextureRect(vk::CommandBuffer commandBuffer, ImTextureData *texture, const ImTextureRect &rect,
+                               vk::ImageLayout oldLayout);
+
+        void DestroyTexture(ImTextureData *texture);
+
+        GraphicsContext &m_Context;
+        BindlessTextureTable &m_TextureTable;
+
+        vk::raii::PipelineLayout m_PipelineLayout{nullptr};
+        vk::raii::Pipeline m_Pipeline{nullptr};
+
+        std::array<FrameGeometry, MAX_FRAMES_IN_FLIGHT> m_FrameGeometry;
+    };
+}
@@ -0,0 +1,138 @@
+export module EasyGui.Graphics.BindlessTextureTable;
+
+import EasyGui.Lib;
+import EasyGui.Graphics.GraphicsContext;
+import std;
+
+namespace EasyGui {
+    // One large update-after-bind array of combined image samplers, bound once per frame.
+    // Textures are addressed by their index in the array, index 0 is never handed out so it can stand for no texture.
+    // Thread safe.
+    export class BindlessTextureTable {
+    public:
+        constexpr static uint32_t s_MaxCapacity = 1 << 16;
+
+        explicit BindlessTextureTable(GraphicsContext &context)
+            : m_Device(context.GetLogicalDevice()), m_DeletionQueue(context.GetDeletionQueue()) {
+            auto properties = context.GetPhysicalDevice().getProperties2<vk::PhysicalDeviceProperties2,
+                vk::PhysicalDeviceVulkan12Properties>().get<vk::PhysicalDeviceVulkan12Properties>();
+            // combined image samplers count against both the sampled image and the sampler limits
+            m_Capacity = std::min({
+                s_MaxCapacity,
+                properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                properties.maxDescriptorSetUpdateAfterBindSampledImages,
+                properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                properties.maxDescriptorSetUpdateAfterBindSamplers
+            });
+
+            vk::DescriptorSetLayoutBinding binding{
+                .binding = 0,
+                .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                .descriptorCount = m_Capacity,
+                .stageFlags = vk::ShaderStageFlagBits::eFragment
+            };
+
+            vk::DescriptorBindingFlags bindingFlags = vk::DescriptorBindingFlagBits::ePartiallyBound |
+                                                      vk::DescriptorBindingFlagBits::eUpdateAfterBind;
+            vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{
+                .bindingCount = 1,
+                .pBindingFlags = &bindingFlags
+            };
+
+            m_SetLayout = m_Device.createDescriptorSetLayout(vk::DescriptorSetLayoutCreateInfo{
+                .pNext = &bindingFlagsInfo,
+                .flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+                .bindingCount = 1,
+                .pBindings = &binding
+            }).value();
+
+            vk::DescriptorPoolSize poolSize{
+                .type = vk::DescriptorType::eCombinedImageSampler,
+                .descriptorCount = m_Capacity
+            };
+
+            m_DescriptorPool = m_Device.createDescriptorPool(vk::DescriptorPoolCreateInfo{
+                .flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind |
+                         vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+                .maxSets = 1,
+                .poolSizeCount = 1,
+                .pPoolSizes = &poolSize
+            }).value();
+
+            m_DescriptorSet = std::move(m_Device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo{
+                .descriptorPool = *m_DescriptorPool,
+                .descriptorSetCount = 1,
+                .pSetLayouts = &*m_SetLayout
+            }).value().front());
+        }
+
+        BindlessTextureTable(const BindlessTextureTable &) = delete;
+
+        BindlessTextureTable &operator=(const BindlessTextureTable &) = delete;
+
+        // the view has to stay alive until the index is unregistered
+        uint32_t Register(vk::ImageView imageView, vk::Sampler sampler) {
+            std::lock_guard lock(m_Mutex);
+
+            uint32_t index;
+            if (!m_FreeIndices.empty()) {
+                index = m_FreeIndices.back();
+                m_FreeIndices.pop_back();
+            } else if (m_NextIndex < m_Capacity) {
+                index = m_NextIndex++;
+            } else {
+                throw std::runtime_error("bindless texture table is full!");
+            }
+
+            WriteDescriptor(index, imageView, sampler);
+            return index;
+        }
+
+        // frames in flight may still sample the old index, it is only reused once they completed
+        void Unregister(uint32_t index) {
+            if (index == 0) return;
+
+            m_DeletionQueue.Enqueue([this, index] {
+                std::lock_guard lock(m_Mutex);
+                m_FreeIndices.push_back(index);
+            });
+        }
+
+        [[nodiscard]] vk::DescriptorSetLayout GetSetLayout() const { return *m_SetLayout; }
+
+        [[nodiscard]] vk::DescriptorSet GetDescriptorSet() const { return *m_DescriptorSet; }
+
+        [[nodiscard]] uint32_t GetCapacity() const { return m_Capacity; }
+
+    private:
+        void WriteDescriptor(uint32_t index, vk::ImageView imageView, vk::Sampler sampler) {
+            vk::DescriptorImageInfo imageInfo{
+                .sampler = sampler,
+                .imageView = imageView,
+                .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal
+            };
+
+            // update after bind allows this while recorded frames reference other indices of the set
+            m_Device.updateDescriptorSets(vk::WriteDescriptorSet{
+                .dstSet = *m_DescriptorSet,
+                .dstBinding = 0,
+                .dstArrayElement = index,
+                .descriptorCount = 1,
+                .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                .pImageInfo = &imageInfo
+            }, {});
+        }
+
+        vk::raii::Device &m_Device;
+        DeferredDeletionQueue &m_DeletionQueue;
+        uint32_t m_Capacity = 0;
+
+        vk::raii::DescriptorSetLayout m_SetLayout{nullptr};
+        vk::raii::DescriptorPool m_DescriptorPool{nullptr};
+        vk::raii::DescriptorSet m_DescriptorSet{nullptr};
+
+        std::mutex m_Mutex;
+        std::vector<uint32_t> m_FreeIndices;
+        uint32_t m_NextIndex = 1;
+    };
+}
@@ -1,39 +1,128 @@
 module EasyGui.Graphics.GraphicsContext;
 
 import std;
+import EasyGui.Tools.ThreadPool;
 
 import "EasyGui/Lib/Lib.hpp";
 
 namespace EasyGui {
-    GraphicsContext::GraphicsContext(SDL_Window *window) {
-        Init(window);
+    GraphicsContext::GraphicsContext(SDL_Window *window, PresentMode presentMode)
+        : m_PreferredPresentMode(presentMode) {
+        Init([window] { return window; }, nullptr);
     }
 
-    void GraphicsContext::Init(SDL_Window *window) {
-        CreateInstance();
-        SetupDebugMessenger();
-        CreateSurface(window);
-        PickPhysicalDevice();
-        CreateLogicalDevice();
+    GraphicsContext::GraphicsContext(const std::function<SDL_Window *()> &createWindow, PresentMode presentMode,
+                                     Profiling::StartupTimeline *startupTimeline)
+        : m_PreferredPresentMode(presentMode) {
+        Init(createWindow, startupTimeline);
+    }
 
-        CreateAllocator();
+    GraphicsContext::GraphicsContext(const HeadlessSpec &headlessSpec, Profiling::StartupTimeline *startupTimeline) {
+        InitHeadless(headlessSpec, startupTimeline);
+    }
 
-        CreateSwapChain(window);
-        CreateImageViews();
+    void GraphicsContext::Init(const std::function<SDL_Window *()> &createWindow,
+                               Profiling::StartupTimeline *startupTimeline) {
+        auto step = [startupTimeline](const char *name, auto &&function) {
+            Profiling::StartupTimeline::Scope scope(startupTimeline, name);
+            function();
+        };
 
-        CreateDescriptorPool();
+        // with the loader in, the instance extensions are known before the window exists
+        if (!SDL_Vulkan_LoadLibrary(nullptr)) {
+            throw std::runtime_error("Failed to load the Vulkan library: " + std::string(SDL_GetError()));
+        }
+        auto extensions = GetRequiredExtensions(false);
+
+        // SDL windows belong to the calling thread, the instance does not
+        auto instanceReady = GlobalThreadPool()->Enqueue([&] {
+            step("CreateInstance", [&] { CreateInstance(extensions); });
+            step("SetupDebugMessenger", [&] { SetupDebugMessenger(); });
+        });
+
+        try {
+            step("CreateWindow", [&] { m_Window = createWindow(); });
+        } catch (...) {
+            instanceReady.wait();
+            SDL_Vulkan_UnloadLibrary();
+            throw;
+        }
+        // the window holds its own reference to the library
+        SDL_Vulkan_UnloadLibrary();
+        instanceReady.get();
 
-        CreateSampler();
+        step("CreateSurface", [&] { CreateSurface(m_Window); });
+        step("PickPhysicalDevice", [&] { PickPhysicalDevice(); });
+        step("CreateLogicalDevice", [&] { CreateLogicalDevice(); });
 
-        CreateRenderPass();
-        CreateFramebuffers();
+        // reading the cache file overlaps the rest of the setup, nothing below creates pipelines
+        auto pipelineCacheReady = GlobalThreadPool()->Enqueue([&] {
+            step("CreatePipelineCache", [&] { CreatePipelineCache(); });
+        });
+        // the task captures the stack, a failing step must not return before it finished
+        WaitGuard pipelineCacheGuard(pipelineCacheReady);
+
+        step("CreateAllocator", [&] { CreateAllocator(); });
+
+        step("CreateSwapChain", [&] { CreateSwapChain(m_Window); });
+        step("CreateImageViews", [&] { CreateImageViews(); });
+
+        step("CreateDescriptorPool", [&] { CreateDescriptorPool(); });
+
+        step("CreateSampler", [&] { CreateSampler(); });
+
+        step("CreateRenderPass", [&] { CreateRenderPass(); });
+        step("CreateFramebuffers", [&] { CreateFramebuffers(); });
+
+        step("CreateCommandPool", [&] { CreateCommandPool(); });
+        step("CreateSyncObjects", [&] { CreateSyncObjects(); });
+        step("CreateCommandBuffer", [&] { CreateCommandBuffer(); });
+        step("CreateTimestampQueryPools", [&] { CreateTimestampQueryPools(); });
+
+        pipelineCacheReady.get();
+    }
+
+    void GraphicsContext::InitHeadless(const HeadlessSpec &headlessSpec, Profiling::StartupTimeline *startupTimeline) {
+        auto step = [startupTimeline](const char *name, auto &&function) {
+            Profiling::StartupTimeline::Scope scope(startupTimeline, name);
+            function();
+        };
+
+        m_Headless = true;
+        m_EnableReadback = headlessSpec.enableReadback;
+
+        step("CreateInstance", [&] { CreateInstance(GetRequiredExtensions(true)); });
+        step("SetupDebugMessenger", [&] { SetupDebugMessenger(); });
+        step("PickPhysicalDevice", [&] { PickPhysicalDevice(); });
+        step("CreateLogicalDevice", [&] { CreateLogicalDevice(); });
+
+        auto pipelineCacheReady = GlobalThreadPool()->Enqueue([&] {
+            step("CreatePipelineCache", [&] { CreatePipelineCache(); });
+        });
+        WaitGuard pipelineCacheGuard(pipelineCacheReady);
+
+        step("CreateAllocator", [&] { CreateAllocator(); });
+
+        step("CreateOffscreenTargets", [&] { CreateOffscreenTargets(headlessSpec); });
+        step("CreateImageViews", [&] { CreateImageViews(); });
+        step("CreateReadbackBuffers", [&] { CreateReadbackBuffers(); });
+
+        step("CreateDescriptorPool", [&] { CreateDescriptorPool(); });
+
+        step("CreateSampler", [&] { CreateSampler(); });
+
+        step("CreateRenderPass", [&] { CreateRenderPass(); });
+        step("CreateFramebuffers", [&] { CreateFramebuffers(); });
+
+        step("CreateCommandPool", [&] { CreateCommandPool(); });
+        step("CreateSyncObjects", [&] { CreateSyncObjects(); });
+        step("CreateCommandBuffer", [&] { CreateCommandBuffer(); });
+        step("CreateTimestampQueryPools", [&] { CreateTimestampQueryPools(); });
 
-        CreateCommandPool();
-        CreateSyncObjects();
-        CreateCommandBuffer();
+        pipelineCacheReady.get();
     }
 
-    void GraphicsContext::CreateInstance() {
+    void GraphicsContext::CreateInstance(const std::vector<const char *> &extensions) {
         if (enableValidationLayers && !CheckValidationLayerSupport()) {
             throw std::runtime_error("validation layers requested, but not available!");
         }
@@ -48,8 +137,6 @@ namespace EasyGui {
             .apiVersion = vk::ApiVersion13
         };
 
-        auto extensions = GetRequiredExtensions();
-
         auto debugCreateInfo = PopulateDebugMessengerCreateInfo();
 
         // flags,
@@ -95,12 +182,14 @@ namespace EasyGui {
         m_DebugMessenger = m_Instance.createDebugUtilsMessengerEXT(PopulateDebugMessengerCreateInfo()).value();
     }
 
-    std::vector<const char *> GraphicsContext::GetRequiredExtensions() {
+    std::vector<const char *> GraphicsContext::GetRequiredExtensions(bool headless) {
         std::vector<const char *> extensions;
-        uint32_t sdl_extensions_count = 0;
-        const char *const *sdl_extensions = SDL_Vulkan_GetInstanceExtensions(&sdl_extensions_count);
-        for (uint32_t n = 0; n < sdl_extensions_count; n++)
-            extensions.push_back(sdl_extensions[n]);
+        if (!headless) {
+            uint32_t sdl_extensions_count = 0;
+            const char *const *sdl_extensions = SDL_Vulkan_GetInstanceExtensions(&sdl_extensions_count);
+            for (uint32_t n = 0; n < sdl_extensions_count; n++)
+                extensions.push_back(sdl_extensions[n]);
+        }
 
         if (enableValidationLayers) {
             extensions.push_back(vk::EXTDebugUtilsExtensionName);
@@ -166,6 +255,9 @@ namespace EasyGui {
             queueFamilies.GraphicsFamily.value(),
             queueFamilies.PresentFamily.value()
         };
+        if (queueFamilies.TransferFamily.has_value()) {
+            uniqueQueueFamilies.insert(queueFamilies.TransferFamily.value());
+        }
 
         std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
         queueCreateInfos.reserve(uniqueQueueFamilies.size());
@@ -179,23 +271,53 @@ namespace EasyGui {
             });
         }
 
-        vk::PhysicalDeviceFeatures deviceFeatures{};
+        // texture uploads signal their completion through timeline semaphores
+        vk::PhysicalDeviceVulkan12Features vulkan12Features{
+            .timelineSemaphore = vk::True
+        };
+        vk::PhysicalDeviceFeatures2 deviceFeatures{
+            .pNext = &vulkan12Features
+        };
+
+        // the bindless texture table needs a partially bound, update after bind array of unknown size
+        // indexed with a push constant, which is dynamically uniform
+        auto supportedFeatureChain = m_PhysicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2,
+            vk::PhysicalDeviceVulkan12Features>();
+        const auto &supportedFeatures = supportedFeatureChain.get<vk::PhysicalDeviceVulkan12Features>();
+        m_SupportsBindlessTextures = supportedFeatureChain.get<vk::PhysicalDeviceFeatures2>().features
+                                         .shaderSampledImageArrayDynamicIndexing &&
+                                     supportedFeatures.descriptorIndexing &&
+                                     supportedFeatures.runtimeDescriptorArray &&
+                                     supportedFeatures.descriptorBindingPartiallyBound &&
+                                     supportedFeatures.descriptorBindingSampledImageUpdateAfterBind;
+        if (m_SupportsBindlessTextures) {
+            deviceFeatures.features.shaderSampledImageArrayDynamicIndexing = vk::True;
+            vulkan12Features.descriptorIndexing = vk::True;
+            vulkan12Features.runtimeDescriptorArray = vk::True;
+            vulkan12Features.descriptorBindingPartiallyBound = vk::True;
+            vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = vk::True;
+        }
 
         vk::DeviceCreateInfo deviceCreateInfo{
-            .pNext = nullptr,
+            .pNext = &deviceFeatures,
             .flags = {},
             .queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size()),
             .pQueueCreateInfos = queueCreateInfos.data(),
             .enabledLayerCount = enableValidationLayers ? static_cast<uint32_t>(s_ValidationLayers.size()) : 0,
             .ppEnabledLayerNames = enableValidationLayers ? s_ValidationLayers.data() : nullptr,
-            .enabledExtensionCount = static_cast<uint32_t>(s_DeviceExtensions.size()),
-            .ppEnabledExtensionNames = s_DeviceExtensions.data(),
-            .pEnabledFeatures = &deviceFeatures
+            .enabledExtensionCount = static_cast<uint32_t>(GetDeviceExtensions().size()),
+            .ppEnabledExtensionNames = GetDeviceExtensions().data(),
+            // passed through the pNext chain instead
+            .pEnabledFeatures = nullptr
         };
 
         m_Device = m_PhysicalDevice.createDevice(deviceCreateInfo).value();
         m_GraphicsQueue = m_Device.getQueue(queueFamilies.GraphicsFamily.value(), 0).value();
         m_PresentQueue = m_Device.getQueue(queueFamilies.PresentFamily.value(), 0).value();
+
+        m_GraphicsQueueFamily = queueFamilies.GraphicsFamily.value();
+        m_TransferQueueFamily = queueFamilies.TransferFamily.value_or(m_GraphicsQueueFamily);
+        m_TransferQueue = m_Device.getQueue(m_TransferQueueFamily, 0).value();
     }
 
     void GraphicsContext::CreateAllocator() {
@@ -208,9 +330,135 @@ namespace EasyGui {
         };
 
         m_Allocator = vma::createAllocatorUnique(allocatorInfo).value;
+        m_StagingRing = std::make_unique<StagingRing>(*m_Allocator);
+    }
+
+    namespace {
+        // Precedes the driver's data in a pipeline cache file. The driver validates its own header as well, this one
+        // also catches driver updates that keep the cache UUID and files that were cut short.
+        struct PipelineCacheFileHeader {
+            uint32_t Magic;
+            uint32_t Version;
+            uint32_t VendorId;
+            uint32_t DeviceId;
+            uint32_t DriverVersion;
+            std::array<uint8_t, vk::UuidSize> PipelineCacheUuid;
+            std::array<uint8_t, vk::UuidSize> DriverUuid;
+            uint32_t Reserved;
+            uint64_t DataSize;
+            uint64_t DataHash;
+        };
+
+        // compared with memcmp, so it must not contain padding
+        static_assert(sizeof(PipelineCacheFileHeader) == 72);
+
+        constexpr uint32_t s_PipelineCacheMagic = 0x43504745; // "EGPC"
+        constexpr uint32_t s_PipelineCacheVersion = 1;
+
+        uint64_t HashBytes(std::span<const uint8_t> bytes) {
+            // FNV-1a
+            uint64_t hash = 0xcbf29ce484222325ull;
+            for (uint8_t byte: bytes) {
+                hash = (hash ^ byte) * 0x100000001b3ull;
+            }
+            return hash;
+        }
+
+        PipelineCacheFileHeader MakePipelineCacheHeader(const vk::raii::PhysicalDevice &physicalDevice,
+                                                        std::span<const uint8_t> data) {
+            auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2,
+                vk::PhysicalDeviceVulkan11Properties>();
+            const auto &deviceProperties = properties.get<vk::PhysicalDeviceProperties2>().properties;
+            const auto &vulkan11Properties = properties.get<vk::PhysicalDeviceVulkan11Properties>();
+
+            PipelineCacheFileHeader header{
+                .Magic = s_PipelineCacheMagic,
+                .Version = s_PipelineCacheVersion,
+                .VendorId = deviceProperties.vendorID,
+                .DeviceId = deviceProperties.deviceID,
+                .DriverVersion = deviceProperties.driverVersion,
+                .DataSize = data.size(),
+                .DataHash = HashBytes(data)
+            };
+            std::ranges::copy(deviceProperties.pipelineCacheUUID, header.PipelineCacheUuid.begin());
+            std::ranges::copy(vulkan11Properties.driverUUID, header.DriverUuid.begin());
+            return header;
+        }
+    }
+
+    void GraphicsContext::CreatePipelineCache() {
+        std::error_code error;
+        std::filesystem::path directory = s_PipelineCacheDirectory
+                                              ? *s_PipelineCacheDirectory
+                                              : std::filesystem::temp_directory_path(error) / "EasyGui";
+        if (error) directory.clear();
+
+        std::vector<uint8_t> initialData;
+        if (!directory.empty()) {
+            auto properties = m_PhysicalDevice.getProperties();
+            m_PipelineCachePath = directory / std::format("pipeline_cache_{:04x}_{:04x}.bin",
+                                                          properties.vendorID, properties.deviceID);
+
+            std::ifstream file(m_PipelineCachePath, std::ios::binary);
+            uintmax_t fileSize = std::filesystem::file_size(m_PipelineCachePath, error);
+            PipelineCacheFileHeader header{};
+            if (file && !error && file.read(reinterpret_cast<char *>(&header), sizeof(header)) &&
+                header.DataSize == fileSize - sizeof(header)) {
+                initialData.resize(header.DataSize);
+                file.read(reinterpret_cast<char *>(initialData.data()), static_cast<std::streamsize>(initialData.size()));
+
+                // anything stale or damaged starts over with an empty cache
+                auto expected = MakePipelineCacheHeader(m_PhysicalDevice, initialData);
+                if (!file || std::memcmp(&header, &expected, sizeof(header)) != 0) {
+                    initialData.clear();
+                } else {
+                    m_SavedPipelineCacheHash = header.DataHash;
+                }
+            }
+        }
+
+        m_PipelineCache = m_Device.createPipelineCache(vk::PipelineCacheCreateInfo{
+            .initialDataSize = initialData.size(),
+            .pInitialData = initialData.data()
+        }).value();
+    }
+
+    bool GraphicsContext::SavePipelineCache() {
+        if (!*m_PipelineCache || m_PipelineCachePath.empty()) return true;
+
+        // ImGui and the layers create pipelines with it too, only the data tells whether anything was added
+        std::vector<uint8_t> data = m_PipelineCache.getData();
+        auto header = MakePipelineCacheHeader(m_PhysicalDevice, data);
+        if (data.empty() || header.DataHash == m_SavedPipelineCacheHash) return true;
+
+        std::error_code error;
+        std::filesystem::create_directories(m_PipelineCachePath.parent_path(), error);
+
+        // written next to the target and renamed, a crash mid-write never leaves a truncated cache behind
+        std::filesystem::path temporaryPath = m_PipelineCachePath;
+        temporaryPath += ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+            if (!file) {
+                std::cerr << "Failed to write the pipeline cache to " << temporaryPath << std::endl;
+                return false;
+            }
+        }
+
+        std::filesystem::rename(temporaryPath, m_PipelineCachePath, error);
+        if (error) {
+            std::cerr << "Failed to save the pipeline cache: " << error.message() << std::endl;
+            return false;
+        }
+
+        m_SavedPipelineCacheHash = header.DataHash;
+        return true;
     }
 
     void GraphicsContext::CreateSurface(SDL_Window *window) {
+#ifdef VK_USE_PLATFORM_WIN32_KHR
         auto sdlWindowProperties = SDL_GetWindowProperties(window);
         // HWND hwnd = SDL_Vulkan_GetVkGetInstanceProcAddr();
         /*
@@ -228,6 +476,14 @@ namespace EasyGui {
         };
 
         m_Surface = m_Instance.createWin32SurfaceKHR(surfaceCreateInfo).value();
+#else
+        // elsewhere SDL knows which window system the window lives on
+        VkSurfaceKHR surface = VK_NULL_HANDLE;
+        if (!SDL_Vulkan_CreateSurface(window, *m_Instance, nullptr, &surface)) {
+            throw std::runtime_error("Failed to create the window surface: " + std::string(SDL_GetError()));
+        }
+        m_Surface = vk::raii::SurfaceKHR(m_Instance, surface);
+#endif
     }
 
     QueueFamilyIndices GraphicsContext::FindQueueFamilies(vk::PhysicalDevice physicalDevice) {
@@ -242,7 +498,12 @@ namespace EasyGui {
                 indices.GraphicsFamily = i;
             }
 
-            if (physicalDevice.getSurfaceSupportKHR(i, *m_Surface).value) {
+            if (m_Headless) {
+                // nothing is presented, the graphics queue stands in for the present queue
+                if (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) {
+                    indices.PresentFamily = i;
+                }
+            } else if (physicalDevice.getSurfaceSupportKHR(i, *m_Surface).value) {
                 indices.PresentFamily = i;
             }
 
@@ -251,6 +512,16 @@ namespace EasyGui {
             }
         }
 
+        for (uint32_t i = 0; i < queueFamilies.size(); i++) {
+            auto flags = queueFamilies[i].queueFlags;
+            if (!(flags & vk::QueueFlagBits::eTransfer) || (flags & vk::QueueFlagBits::eGraphics)) continue;
+
+            // transfer only families are preferred over async compute ones
+            if (!indices.TransferFamily.has_value() || !(flags & vk::QueueFlagBits::eCompute)) {
+                indices.TransferFamily = i;
+            }
+        }
+
         return indices;
     }
 
@@ -259,9 +530,9 @@ namespace EasyGui {
 
         bool extensionSupported = CheckDeviceExtensionSupport(device);
 
-        bool swapChainAdequate = false;
+        bool swapChainAdequate = m_Headless;
 
-        if (extensionSupported) {
+        if (extensionSupported && !m_Headless) {
             auto swapChainSupport = QuerySwapChainSupport(device);
             swapChainAdequate = !swapChainSupport.Formats.empty() && !swapChainSupport.PresentModes.empty();
         }
@@ -271,7 +542,8 @@ namespace EasyGui {
 
     bool GraphicsContext::CheckDeviceExtensionSupport(vk::PhysicalDevice device) const {
         auto availableExtensions = device.enumerateDeviceExtensionProperties().value;
-        std::set<std::string> requiredExtensions(s_DeviceExtensions.begin(), s_DeviceExtensions.end());
+        const auto &deviceExtensions = GetDeviceExtensions();
+        std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
         for (const auto &extension: availableExtensions) {
             requiredExtensions.erase(extension.extensionName);
         }
@@ -314,6 +586,25 @@ namespace EasyGui {
 
     vk::PresentModeKHR GraphicsContext::ChooseSwapPresentMode(
         const std::vector<vk::PresentModeKHR> &availablePresentModes) const {
+        auto fallbackChain = [this]() -> std::vector<vk::PresentModeKHR> {
+            switch (m_PreferredPresentMode) {
+                case PresentMode::Mailbox:
+                    return {vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate};
+                case PresentMode::Immediate:
+                    return {vk::PresentModeKHR::eImmediate, vk::PresentModeKHR::eMailbox};
+                case PresentMode::FifoRelaxed:
+                    return {vk::PresentModeKHR::eFifoRelaxed};
+                default:
+                    return {};
+            }
+        }();
+
+        for (auto presentMode: fallbackChain) {
+            if (std::ranges::contains(availablePresentModes, presentMode)) {
+                return presentMode;
+            }
+        }
+
         return vk::PresentModeKHR::eFifo; // FIFO is guaranteed to be supported
     }
 
@@ -342,7 +633,7 @@ namespace EasyGui {
         return actualExtent;
     }
 
-    void GraphicsContext::CreateSwapChain(SDL_Window *window) {
+    void GraphicsContext::CreateSwapChain(SDL_Window *window, vk::SwapchainKHR oldSwapChain) {
         SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(*m_PhysicalDevice);
 
         auto surfaceFormat = ChooseSwapSurfaceFormat(swapChainSupport.Formats);
@@ -359,6 +650,7 @@ namespace EasyGui {
 
         auto queueFamilies = FindQueueFamilies(*m_PhysicalDevice);
 
+        // the transfer queue only uploads textures and never touches swapchain images
         uint32_t queueFamilyIndices[] = {
             queueFamilies.GraphicsFamily.value(),
             queueFamilies.PresentFamily.value()
@@ -387,16 +679,95 @@ namespace EasyGui {
             .compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque, // Opaque is a common choice
             .presentMode = presentMode,
             .clipped = vk::True,
-            .oldSwapchain = m_SwapChain.release()
+            .oldSwapchain = oldSwapChain
         };
 
         m_SwapChain = m_Device.createSwapchainKHR(swapChainCreateInfo).value();
 
         m_SwapChainImages = m_SwapChain.getImages();
         m_SwapChainImageFormat = surfaceFormat.format;
+        m_PresentMode = presentMode;
         m_SwapChainExtent = extent;
     }
 
+    void GraphicsContext::CreateOffscreenTargets(const HeadlessSpec &headlessSpec) {
+        m_SwapChainImageFormat = headlessSpec.format;
+        m_SwapChainExtent = vk::Extent2D{
+            .width = headlessSpec.width,
+            .height = headlessSpec.height
+        };
+
+        // ImGui requires at least two images, one slot per frame in flight keeps the ring free of waits
+        m_MinImageCount = 2;
+        m_ImageCount = MAX_FRAMES_IN_FLIGHT;
+
+        vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eColorAttachment |
+                                    vk::ImageUsageFlagBits::eSampled;
+        if (m_EnableReadback) {
+            usage |= vk::ImageUsageFlagBits::eTransferSrc;
+        }
+
+        vk::ImageCreateInfo imageInfo{
+            .imageType = vk::ImageType::e2D,
+            .format = m_SwapChainImageFormat,
+            .extent = {
+                .width = m_SwapChainExtent.width,
+                .height = m_SwapChainExtent.height,
+                .depth = 1
+            },
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = vk::SampleCountFlagBits::e1,
+            .tiling = vk::ImageTiling::eOptimal,
+            .usage = usage,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .initialLayout = vk::ImageLayout::eUndefined
+        };
+
+        vma::AllocationCreateInfo allocInfo{
+            .flags = vma::AllocationCreateFlagBits::eDedicatedMemory,
+            .usage = vma::MemoryUsage::eAutoPreferDevice
+        };
+
+        for (size_t i = 0; i < m_ImageCount; i++) {
+            auto [image, allocation] = m_Allocator->createImageUnique(imageInfo, allocInfo).value;
+            m_SwapChainImages.push_back(*image);
+            m_OffscreenImages.push_back(std::move(image));
+            m_OffscreenAllocations.push_back(std::move(allocation));
+        }
+    }
+
+    namespace {
+        // tightly packed, as copyImageToBuffer writes it with a zero row length
+        vk::DeviceSize GetReadbackSize(vk::Extent2D extent, vk::Format format) {
+            return static_cast<vk::DeviceSize>(extent.width) * extent.height * vk::blockSize(format);
+        }
+    }
+
+    void GraphicsContext::CreateReadbackBuffers() {
+        m_PendingReadbacks.assign(MAX_FRAMES_IN_FLIGHT, std::nullopt);
+
+        if (!m_EnableReadback) return;
+
+        vk::BufferCreateInfo bufferInfo{
+            .size = GetReadbackSize(m_SwapChainExtent, m_SwapChainImageFormat),
+            .usage = vk::BufferUsageFlagBits::eTransferDst,
+            .sharingMode = vk::SharingMode::eExclusive
+        };
+
+        vma::AllocationCreateInfo allocInfo{
+            .flags = vma::AllocationCreateFlagBits::eHostAccessRandom |
+                     vma::AllocationCreateFlagBits::eMapped,
+            .usage = vma::MemoryUsage::eAutoPreferHost
+        };
+
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            auto [buffer, allocation] = m_Allocator->createBufferUnique(bufferInfo, allocInfo).value;
+            m_ReadbackBuffers.push_back(std::move(buffer));
+            m_ReadbackAllocations.push_back(std::move(allocation));
+        }
+    }
+
     void GraphicsContext::CreateImageViews() {
         m_SwapChainImageViews.reserve(m_SwapChainImages.size());
 
@@ -451,6 +822,8 @@ namespace EasyGui {
             .addressModeV = vk::SamplerAddressMode::eRepeat,
             .addressModeW = vk::SamplerAddressMode::eRepeat,
             .anisotropyEnable = vk::False,
+            .minLod = 0.0f,
+            .maxLod = vk::LodClampNone,
             .borderColor = vk::BorderColor::eIntOpaqueBlack,
             .unnormalizedCoordinates = vk::False,
         };
@@ -459,7 +832,6 @@ namespace EasyGui {
     }
 
     void GraphicsContext::CreateRenderPass() {
-        // disable v-sync
         vk::AttachmentDescription colorAttachment{
             .flags = {},
             .format = m_SwapChainImageFormat,
@@ -469,7 +841,11 @@ namespace EasyGui {
             .stencilLoadOp = vk::AttachmentLoadOp::eDontCare,
             .stencilStoreOp = vk::AttachmentStoreOp::eDontCare,
             .initialLayout = vk::ImageLayout::eUndefined,
-            .finalLayout = vk::ImageLayout::ePresentSrcKHR
+            .finalLayout = m_Headless
+                               ? (m_EnableReadback
+                                      ? vk::ImageLayout::eTransferSrcOptimal
+                                      : vk::ImageLayout::eShaderReadOnlyOptimal)
+                               : vk::ImageLayout::ePresentSrcKHR
         };
 
         vk::AttachmentReference colorAttachmentRef{
@@ -584,28 +960,352 @@ namespace EasyGui {
         }
 
         // m_InFlightFence = m_Device.createFence(fenceInfo).value();
+        CreateRenderFinishedSemaphores();
+    }
+
+    void GraphicsContext::CreateRenderFinishedSemaphores() {
+        vk::SemaphoreCreateInfo semaphoreInfo{
+            .pNext = nullptr,
+            .flags = {}
+        };
+
+        // one per swapchain image, a present may still wait on it after the frame fence signaled
+        m_RenderFinishedSemaphores.clear();
         for (size_t i = 0; i < m_SwapChainImages.size(); i++) {
             m_RenderFinishedSemaphores.push_back(m_Device.createSemaphore(semaphoreInfo).value());
         }
     }
 
+    void GraphicsContext::CreateTimestampQueryPools() {
+        auto properties = m_PhysicalDevice.getProperties();
+        auto queueFamilies = m_PhysicalDevice.getQueueFamilyProperties();
+        uint32_t validBits = queueFamilies[FindQueueFamilies(*m_PhysicalDevice).GraphicsFamily.value()].timestampValidBits;
+
+        if (!properties.limits.timestampComputeAndGraphics || validBits == 0) {
+            // zones become no-ops
+            return;
+        }
+
+        m_TimestampPeriod = properties.limits.timestampPeriod;
+        m_TimestampMask = validBits >= 64 ? std::numeric_limits<uint64_t>::max() : (uint64_t{1} << validBits) - 1;
+
+        vk::QueryPoolCreateInfo queryPoolInfo{
+            .pNext = nullptr,
+            .flags = {},
+            .queryType = vk::QueryType::eTimestamp,
+            .queryCount = s_MaxGpuTimestampQueries
+        };
+
+        m_GpuTimestampFrames.resize(MAX_FRAMES_IN_FLIGHT);
+        for (auto &frame: m_GpuTimestampFrames) {
+            frame.Pool = m_Device.createQueryPool(queryPoolInfo).value();
+        }
+    }
+
+    void GraphicsContext::CollectGpuTimestamps(size_t currentFrame) {
+        if (!SupportsGpuTimestamps()) return;
+
+        auto &frame = m_GpuTimestampFrames[currentFrame];
+        if (!std::exchange(frame.Pending, false) || frame.ZoneNames.empty()) return;
+
+        auto queryCount = static_cast<uint32_t>(frame.ZoneNames.size() * 2);
+        auto [result, timestamps] = frame.Pool.getResults<uint64_t>(
+            0, queryCount, queryCount * sizeof(uint64_t), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+
+        // the fence has signaled so this only fails if a zone was left open
+        if (result != vk::Result::eSuccess) return;
+
+        m_GpuTimings.resize(frame.ZoneNames.size());
+        for (size_t i = 0; i < frame.ZoneNames.size(); i++) {
+            uint64_t ticks = (timestamps[2 * i + 1] - timestamps[2 * i]) & m_TimestampMask;
+            m_GpuTimings[i].Name = frame.ZoneNames[i];
+            m_GpuTimings[i].Depth = frame.ZoneDepths[i];
+            m_GpuTimings[i].Milliseconds = static_cast<double>(ticks) * m_TimestampPeriod / 1'000'000.0;
+        }
+    }
+
+    void GraphicsContext::BeginGpuFrame(vk::CommandBuffer commandBuffer, size_t currentFrame) {
+        if (!SupportsGpuTimestamps()) return;
+
+        auto &frame = m_GpuTimestampFrames[currentFrame];
+        frame.ZoneNames.clear();
+        frame.ZoneDepths.clear();
+        frame.OpenZones.clear();
+        frame.Pending = true;
+
+        commandBuffer.resetQueryPool(*frame.Pool, 0, s_MaxGpuTimestampQueries);
+        BeginGpuZone(commandBuffer, currentFrame, "Frame");
+    }
+
+    void GraphicsContext::EndGpuFrame(vk::CommandBuffer commandBuffer, size_t currentFrame) {
+        if (!SupportsGpuTimestamps()) return;
+
+        auto &frame = m_GpuTimestampFrames[currentFrame];
+        while (!frame.OpenZones.empty()) {
+            EndGpuZone(commandBuffer, currentFrame);
+        }
+    }
+
+    void GraphicsContext::BeginGpuZone(vk::CommandBuffer commandBuffer, size_t currentFrame, std::string_view name) {
+        if (!SupportsGpuTimestamps()) return;
+
+        // out of queries the zone is dropped, but stays on the stack to keep the nesting balanced
+        uint32_t zone = ReserveGpuZone(currentFrame, name);
+        m_GpuTimestampFrames[currentFrame].OpenZones.push_back(zone);
+        WriteGpuZoneBegin(commandBuffer, currentFrame, zone);
+    }
+
+    uint32_t GraphicsContext::ReserveGpuZone(size_t currentFrame, std::string_view name) {
+        if (!SupportsGpuTimestamps()) return std::numeric_limits<uint32_t>::max();
+
+        auto &frame = m_GpuTimestampFrames[currentFrame];
+        auto zone = static_cast<uint32_t>(frame.ZoneNames.size());
+        if (2 * zone + 2 > s_MaxGpuTimestampQueries) {
+            return std::numeric_limits<uint32_t>::max();
+        }
+
+        frame.ZoneNames.emplace_back(name);
+        frame.ZoneDepths.push_back(static_cast<uint32_t>(frame.OpenZones.size()));
+        return zone;
+    }
+
+    void GraphicsContext::WriteGpuZoneBegin(vk::CommandBuffer commandBuffer, size_t currentFrame,
+                                            uint32_t zone) const {
+        if (zone == std::numeric_limits<uint32_t>::max()) return;
+
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe,
+                                     *m_GpuTimestampFrames[currentFrame].Pool, 2 * zone);
+    }
+
+    void GraphicsContext::WriteGpuZoneEnd(vk::CommandBuffer commandBuffer, size_t currentFrame, uint32_t zone) const {
+        if (zone == std::numeric_limits<uint32_t>::max()) return;
+
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe,
+                                     *m_GpuTimestampFrames[currentFrame].Pool, 2 * zone + 1);
+    }
+
+    SecondaryCommandPool &GraphicsContext::GetSecondaryCommandPool() {
+        if (!m_SecondaryCommandPool) {
+            m_SecondaryCommandPool = std::make_unique<SecondaryCommandPool>(
+                m_Device, m_GraphicsQueueFamily, MAX_FRAMES_IN_FLIGHT);
+        }
+        return *m_SecondaryCommandPool;
+    }
+
+    void GraphicsContext::EndGpuZone(vk::CommandBuffer commandBuffer, size_t currentFrame) {
+        if (!SupportsGpuTimestamps()) return;
+
+        auto &frame = m_GpuTimestampFrames[currentFrame];
+        if (frame.OpenZones.empty()) return;
+
+        auto zone = frame.OpenZones.back();
+        frame.OpenZones.pop_back();
+        WriteGpuZoneEnd(commandBuffer, currentFrame, zone);
+    }
+
     void GraphicsContext::RecreateSwapChain(SDL_Window *window) {
-        m_Device.waitIdle();
+        if (m_Headless) return;
 
-        CleanupSwapChain();
+        RetiredSwapChain retired{
+            .SwapChain = std::move(m_SwapChain),
+            .ImageViews = std::move(m_SwapChainImageViews),
+            .Framebuffers = std::move(m_SwapChainFramebuffers),
+            .RenderFinishedSemaphores = std::move(m_RenderFinishedSemaphores)
+        };
+        m_SwapChainImages.clear();
+        m_SwapChainImageViews.clear();
+        m_SwapChainFramebuffers.clear();
 
-        CreateSwapChain(window);
+        CreateSwapChain(window, *retired.SwapChain);
         CreateImageViews();
         CreateFramebuffers();
+        CreateRenderFinishedSemaphores();
+
+        // the frame fences do not cover the semaphore waits of presents still queued on the old swapchain
+        m_RetiredSwapChains.push_back(std::move(retired));
 
         // std::cout << "Swap chain recreated successfully." << std::endl;
     }
 
+    void GraphicsContext::RetireCompletedFrame(size_t currentFrame) {
+        // a single queue completes frames in submission order
+        m_CompletedFrameNumber = std::max(m_CompletedFrameNumber, m_SubmittedFrameNumbers[currentFrame]);
+
+        m_DeletionQueue.Collect(m_CompletedFrameNumber);
+        m_StagingRing->Reclaim(m_CompletedFrameNumber);
+        if (m_SecondaryCommandPool) {
+            m_SecondaryCommandPool->Reset(currentFrame);
+        }
+    }
+
+    void GraphicsContext::SetPresentMode(PresentMode presentMode, SDL_Window *window) {
+        if (m_PreferredPresentMode == presentMode) return;
+
+        m_PreferredPresentMode = presentMode;
+        RecreateSwapChain(window);
+    }
+
+    std::pair<vk::Result, uint32_t> GraphicsContext::AcquireNextImage(size_t currentFrame) {
+        if (m_Headless) {
+            // the fence of this frame has signaled, so the readback recorded into it is complete
+            CollectReadback(currentFrame);
+            return {vk::Result::eSuccess, static_cast<uint32_t>(currentFrame)};
+        }
+
+        return m_SwapChain.acquireNextImage(
+            std::numeric_limits<uint64_t>::max(), m_ImageAvailableSemaphores[currentFrame],
+            nullptr
+        );
+    }
+
+    void GraphicsContext::RecordFrameEnd(vk::CommandBuffer commandBuffer, size_t currentFrame, uint32_t imageIndex) {
+        if (!m_Headless || !m_EnableReadback) return;
+
+        vk::BufferImageCopy region{
+            .bufferOffset = 0,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = {
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            },
+            .imageOffset = {0, 0, 0},
+            .imageExtent = {m_SwapChainExtent.width, m_SwapChainExtent.height, 1}
+        };
+
+        // the render pass leaves the image in eTransferSrcOptimal
+        commandBuffer.copyImageToBuffer(
+            m_SwapChainImages[imageIndex],
+            vk::ImageLayout::eTransferSrcOptimal,
+            *m_ReadbackBuffers[currentFrame],
+            region
+        );
+
+        vk::BufferMemoryBarrier toHostBarrier{
+            .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+            .dstAccessMask = vk::AccessFlagBits::eHostRead,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .buffer = *m_ReadbackBuffers[currentFrame],
+            .offset = 0,
+            .size = vk::WholeSize
+        };
+
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eHost,
+            {},
+            {},
+            toHostBarrier,
+            {}
+        );
+
+        m_PendingReadbacks[currentFrame] = m_FrameNumber;
+    }
+
+    vk::Result GraphicsContext::SubmitAndPresent(size_t currentFrame, uint32_t imageIndex) {
+        vk::PipelineStageFlags waitStages[] = {vk::PipelineStageFlagBits::eColorAttachmentOutput};
+        vk::Semaphore waitSemaphores[] = {*m_ImageAvailableSemaphores[currentFrame]};
+        vk::Semaphore signalSemaphores[] = {*m_RenderFinishedSemaphores[imageIndex]};
+        vk::CommandBuffer commandBuffers[] = {*m_CommandBuffers[currentFrame]};
+
+        // nothing is acquired or presented in headless mode, the fence alone orders the frames
+        vk::SubmitInfo submitInfo{
+            .waitSemaphoreCount = m_Headless ? 0u : 1u,
+            .pWaitSemaphores = m_Headless ? nullptr : waitSemaphores,
+            .pWaitDstStageMask = m_Headless ? nullptr : waitStages,
+            .commandBufferCount = 1,
+            .pCommandBuffers = commandBuffers,
+            .signalSemaphoreCount = m_Headless ? 0u : 1u,
+            .pSignalSemaphores = m_Headless ? nullptr : signalSemaphores
+        };
+
+        m_GraphicsQueue.submit(submitInfo, m_InFlightFences[currentFrame]);
+        m_SubmittedFrameNumbers[currentFrame] = ++m_FrameNumber;
+        m_DeletionQueue.OnFrameSubmitted(m_FrameNumber);
+
+        if (m_Headless) {
+            return vk::Result::eSuccess;
+        }
+
+        vk::SwapchainKHR swapChains[] = {*m_SwapChain};
+        vk::PresentInfoKHR presentInfo{
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = signalSemaphores,
+            .swapchainCount = 1,
+            .pSwapchains = swapChains,
+            .pImageIndices = &imageIndex
+        };
+
+        vk::Result result = m_PresentQueue.presentKHR(presentInfo);
+        // a present that was queued follows every present on the replaced swapchains
+        if (!m_RetiredSwapChains.empty() &&
+            (result == vk::Result::eSuccess || result == vk::Result::eSuboptimalKHR)) {
+            m_DeletionQueue.Enqueue([retired = std::exchange(m_RetiredSwapChains, {})]() mutable {
+                for (RetiredSwapChain &swapChain: retired) {
+                    swapChain.Framebuffers.clear();
+                    swapChain.ImageViews.clear();
+                    swapChain.SwapChain.clear();
+                    swapChain.RenderFinishedSemaphores.clear();
+                }
+            });
+        }
+        return result;
+    }
+
+    void GraphicsContext::CollectReadback(size_t frameIndex) {
+        if (!m_EnableReadback || !m_PendingReadbacks[frameIndex]) return;
+
+        auto frameNumber = *std::exchange(m_PendingReadbacks[frameIndex], std::nullopt);
+        if (!m_ReadbackCallback) return;
+
+        auto allocationInfo = m_Allocator->getAllocationInfo(*m_ReadbackAllocations[frameIndex]);
+        std::ignore = m_Allocator->invalidateAllocation(*m_ReadbackAllocations[frameIndex], 0, vk::WholeSize);
+
+        m_ReadbackCallback(OffscreenFrame{
+            // the allocation may be larger than the image
+            .Pixels = std::span{
+                static_cast<const std::byte *>(allocationInfo.pMappedData),
+                static_cast<size_t>(GetReadbackSize(m_SwapChainExtent, m_SwapChainImageFormat))
+            },
+            .Extent = m_SwapChainExtent,
+            .Format = m_SwapChainImageFormat,
+            .FrameNumber = frameNumber
+        });
+    }
+
+    void GraphicsContext::FlushReadbacks() {
+        if (!m_Headless) return;
+
+        std::vector<size_t> pendingFrames;
+        for (size_t i = 0; i < m_PendingReadbacks.size(); i++) {
+            if (m_PendingReadbacks[i]) pendingFrames.push_back(i);
+        }
+
+        // deliver in submission order
+        std::ranges::sort(pendingFrames, {}, [this](size_t i) { return *m_PendingReadbacks[i]; });
+        for (auto frameIndex: pendingFrames) {
+            CollectReadback(frameIndex);
+        }
+    }
+
+    const std::vector<const char *> &GraphicsContext::GetDeviceExtensions() const {
+        return m_Headless ? s_HeadlessDeviceExtensions : s_DeviceExtensions;
+    }
+
     void GraphicsContext::CleanupSwapChain() {
         m_SwapChainFramebuffers.clear();
         m_SwapChainImageViews.clear();
         m_SwapChainImages.clear();
 
         m_SwapChain.clear();
+        m_RetiredSwapChains.clear();
+
+        m_ReadbackBuffers.clear();
+        m_ReadbackAllocations.clear();
+        m_OffscreenImages.clear();
+        m_OffscreenAllocations.clear();
     }
 }
@@ -5,6 +5,9 @@ export import EasyGui.Lib;
 export import EasyGui.Core.KeyCodes;
 export import EasyGui.Core.MouseCodes;
 export import EasyGui.Event.AllEvents;
+export import EasyGui.Graphics.StagingRing;
+export import EasyGui.Graphics.SecondaryCommandPool;
+import EasyGui.Tools.Profiler;
 
 import "EasyGui/Lib/Lib_SDL3.hpp";
 import "EasyGui/Lib/Lib_Vulkan.hpp";
@@ -21,36 +24,171 @@ namespace EasyGui {
     struct QueueFamilyIndices {
         std::optional<uint32_t> GraphicsFamily;
         std::optional<uint32_t> PresentFamily;
+        // a family with transfer but without graphics support, usually backed by a DMA engine
+        std::optional<uint32_t> TransferFamily;
 
         [[nodiscard]] bool IsComplete() const {
             return GraphicsFamily.has_value() && PresentFamily.has_value();
         }
     };
 
+    // Preferred presentation mode, falls back to the closest supported one. Fifo is always available.
+    export enum class PresentMode {
+        Fifo,        // v-sync
+        FifoRelaxed, // v-sync, late frames tear instead of waiting a full interval
+        Mailbox,     // uncapped rendering, newest frame is shown at v-blank without tearing
+        Immediate    // uncapped rendering, may tear
+    };
+
+    export struct HeadlessSpec {
+        uint32_t width = 1920;
+        uint32_t height = 1080;
+        vk::Format format = vk::Format::eB8G8R8A8Unorm;
+        // copy every rendered frame into host visible memory and hand it to the readback callback
+        bool enableReadback = false;
+    };
+
+    export struct OffscreenFrame {
+        std::span<const std::byte> Pixels;
+        vk::Extent2D Extent;
+        vk::Format Format;
+        uint64_t FrameNumber;
+    };
+
+    export struct GpuZoneTiming {
+        std::string Name;
+        uint32_t Depth = 0;
+        double Milliseconds = 0.0;
+    };
+
     struct SwapChainSupportDetails {
         vk::SurfaceCapabilitiesKHR Capabilities;
         std::vector<vk::SurfaceFormatKHR> Formats;
         std::vector<vk::PresentModeKHR> PresentModes;
     };
 
+    struct GpuTimestampFrame {
+        vk::raii::QueryPool Pool{nullptr};
+        // zone i owns the queries 2i and 2i + 1
+        std::vector<std::string> ZoneNames;
+        std::vector<uint32_t> ZoneDepths;
+        std::vector<uint32_t> OpenZones;
+        bool Pending = false;
+    };
+
+    // Resources of a replaced swapchain. They are handed to the deletion queue once an image of the new swapchain was
+    // presented, presents are processed in order, so the old ones no longer wait on its semaphores by then.
+    struct RetiredSwapChain {
+        vk::raii::SwapchainKHR SwapChain{nullptr};
+        std::vector<vk::raii::ImageView> ImageViews;
+        std::vector<vk::raii::Framebuffer> Framebuffers;
+        std::vector<vk::raii::Semaphore> RenderFinishedSemaphores;
+    };
+
+    // Defers destruction of GPU resources until every frame that may still reference them has completed.
+    // Entries are keyed by frame number, thread safe.
+    export class DeferredDeletionQueue {
+    public:
+        DeferredDeletionQueue() = default;
+
+        DeferredDeletionQueue(const DeferredDeletionQueue &) = delete;
+
+        DeferredDeletionQueue &operator=(const DeferredDeletionQueue &) = delete;
+
+        ~DeferredDeletionQueue() {
+            Flush();
+        }
+
+        // the frame currently being recorded may use the resource, so it is kept until that frame completed
+        void Enqueue(std::move_only_function<void()> &&deleter) {
+            std::lock_guard lock(m_Mutex);
+            m_Entries.push_back(Entry{
+                .RetireFrameNumber = m_SubmittedFrameNumber + 1,
+                .Deleter = std::move(deleter)
+            });
+        }
+
+        void OnFrameSubmitted(uint64_t frameNumber) {
+            std::lock_guard lock(m_Mutex);
+            m_SubmittedFrameNumber = frameNumber;
+        }
+
+        void Collect(uint64_t completedFrameNumber) {
+            std::vector<std::move_only_function<void()>> deleters;
+            {
+                std::lock_guard lock(m_Mutex);
+                while (!m_Entries.empty() && m_Entries.front().RetireFrameNumber <= completedFrameNumber) {
+                    deleters.push_back(std::move(m_Entries.front().Deleter));
+                    m_Entries.pop_front();
+                }
+            }
+
+            // outside the lock, a deleter may retire further resources
+            for (auto &deleter: deleters) {
+                deleter();
+            }
+        }
+
+        // runs every deleter regardless of frame, the device must be idle
+        void Flush() {
+            while (true) {
+                std::deque<Entry> entries;
+                {
+                    std::lock_guard lock(m_Mutex);
+                    entries.swap(m_Entries);
+                }
+                if (entries.empty()) return;
+
+                for (auto &entry: entries) {
+                    entry.Deleter();
+                }
+            }
+        }
+
+    private:
+        struct Entry {
+            uint64_t RetireFrameNumber;
+            std::move_only_function<void()> Deleter;
+        };
+
+        std::mutex m_Mutex;
+        std::deque<Entry> m_Entries;
+        uint64_t m_SubmittedFrameNumber = 0;
+    };
+
     export class GraphicsContext {
     public:
-        GraphicsContext(SDL_Window *window);
+        GraphicsContext(SDL_Window *window, PresentMode presentMode = PresentMode::Fifo);
+
+        // The instance is created on a worker thread while createWindow runs on the calling thread,
+        // every step of the setup is recorded into the timeline when one is given.
+        GraphicsContext(const std::function<SDL_Window *()> &createWindow, PresentMode presentMode,
+                        Profiling::StartupTimeline *startupTimeline = nullptr);
+
+        explicit GraphicsContext(const HeadlessSpec &headlessSpec,
+                                 Profiling::StartupTimeline *startupTimeline = nullptr);
 
         virtual ~GraphicsContext() {
+            if (*m_Device) {
+                m_Device.waitIdle();
+                SavePipelineCache();
+            }
+            m_DeletionQueue.Flush();
             CleanupSwapChain();
         }
 
     protected:
-        void Init(SDL_Window *window);
+        void Init(const std::function<SDL_Window *()> &createWindow, Profiling::StartupTimeline *startupTimeline);
+
+        void InitHeadless(const HeadlessSpec &headlessSpec, Profiling::StartupTimeline *startupTimeline);
 
-        void CreateInstance();
+        void CreateInstance(const std::vector<const char *> &extensions);
 
         static bool CheckValidationLayerSupport();
 
         void SetupDebugMessenger();
 
-        static std::vector<const char *> GetRequiredExtensions();
+        static std::vector<const char *> GetRequiredExtensions(bool headless);
 
         static vk::DebugUtilsMessengerCreateInfoEXT PopulateDebugMessengerCreateInfo();
 
@@ -60,6 +198,8 @@ namespace EasyGui {
 
         void CreateAllocator();
 
+        void CreatePipelineCache();
+
         void CreateSurface(SDL_Window *window);
 
         QueueFamilyIndices FindQueueFamilies(vk::PhysicalDevice physicalDevice);
@@ -79,7 +219,11 @@ namespace EasyGui {
         [[nodiscard]] vk::Extent2D ChooseSwapExtent(const vk::SurfaceCapabilitiesKHR &capabilities,
                                                     SDL_Window *window) const;
 
-        void CreateSwapChain(SDL_Window *window);
+        void CreateSwapChain(SDL_Window *window, vk::SwapchainKHR oldSwapChain = nullptr);
+
+        void CreateOffscreenTargets(const HeadlessSpec &headlessSpec);
+
+        void CreateReadbackBuffers();
 
         void CreateImageViews();
 
@@ -97,14 +241,101 @@ namespace EasyGui {
 
         void CreateSyncObjects();
 
+        void CreateRenderFinishedSemaphores();
+
+        void CreateTimestampQueryPools();
+
     public:
+        // Hands the current swapchain to its replacement without waiting for the device to idle.
         void RecreateSwapChain(SDL_Window *window);
 
+        // Call right after the fence of this frame has been waited on, runs the deletion queue up to it
+        // and reclaims the staging memory of finished frames.
+        void RetireCompletedFrame(size_t currentFrame);
+
+        void SetPresentMode(PresentMode presentMode, SDL_Window *window);
+
+        [[nodiscard]] PresentMode GetPreferredPresentMode() const { return m_PreferredPresentMode; }
+
+        // the mode the swapchain was actually created with
+        [[nodiscard]] vk::PresentModeKHR GetPresentMode() const { return m_PresentMode; }
+
+        // Returns the image to render into for the given frame in flight. In headless mode this is the
+        // offscreen ring slot of that frame, and the readback of its previous use is delivered here.
+        std::pair<vk::Result, uint32_t> AcquireNextImage(size_t currentFrame);
+
+        // Records work that has to happen after the render pass, e.g. the offscreen readback copy.
+        void RecordFrameEnd(vk::CommandBuffer commandBuffer, size_t currentFrame, uint32_t imageIndex);
+
+        vk::Result SubmitAndPresent(size_t currentFrame, uint32_t imageIndex);
+
+        // Delivers every readback that is still pending, must be called after the device is idle.
+        void FlushReadbacks();
+
+        void SetReadbackCallback(std::function<void(const OffscreenFrame &)> callback) {
+            m_ReadbackCallback = std::move(callback);
+        }
+
+        [[nodiscard]] bool IsHeadless() const { return m_Headless; }
+
+        // Reads back the timestamps of the frame whose fence has just been waited on, never stalls.
+        void CollectGpuTimestamps(size_t currentFrame);
+
+        // Resets the query pool of this frame and opens the outermost "Frame" zone, record outside a render pass.
+        void BeginGpuFrame(vk::CommandBuffer commandBuffer, size_t currentFrame);
+
+        void EndGpuFrame(vk::CommandBuffer commandBuffer, size_t currentFrame);
+
+        void BeginGpuZone(vk::CommandBuffer commandBuffer, size_t currentFrame, std::string_view name);
+
+        void EndGpuZone(vk::CommandBuffer commandBuffer, size_t currentFrame);
+
+        // Reserves a zone nested in the ones open right now, for a command buffer recorded on another thread.
+        // Its timestamps are written with WriteGpuZoneBegin/End, which may run on any thread.
+        uint32_t ReserveGpuZone(size_t currentFrame, std::string_view name);
+
+        void WriteGpuZoneBegin(vk::CommandBuffer commandBuffer, size_t currentFrame, uint32_t zone) const;
+
+        void WriteGpuZoneEnd(vk::CommandBuffer commandBuffer, size_t currentFrame, uint32_t zone) const;
+
+        // per thread pools of secondary command buffers for the graphics queue, created on first use
+        SecondaryCommandPool &GetSecondaryCommandPool();
+
+        [[nodiscard]] bool SupportsGpuTimestamps() const { return m_TimestampPeriod > 0.0; }
+
+        [[nodiscard]] bool SupportsBindlessTextures() const { return m_SupportsBindlessTextures; }
+
+        // frames submitted so far, the frame being recorded gets the next number
+        [[nodiscard]] uint64_t GetFrameNumber() const { return m_FrameNumber; }
+
+        // zones of the most recently completed frame, in recording order
+        [[nodiscard]] const std::vector<GpuZoneTiming> &GetGpuTimings() const { return m_GpuTimings; }
+
+        [[nodiscard]] double GetGpuFrameMilliseconds() const {
+            return m_GpuTimings.empty() ? 0.0 : m_GpuTimings.front().Milliseconds;
+        }
+
+        // Where pipeline cache files are kept, one per device. Takes effect for contexts created afterwards,
+        // an empty path keeps the cache in memory only. Defaults to EasyGui in the temp directory.
+        static void SetPipelineCacheDirectory(std::filesystem::path directory) {
+            s_PipelineCacheDirectory = std::move(directory);
+        }
+
+        // Writes the pipeline cache to its file when pipelines were added since it was loaded, also done on
+        // destruction. Returns false when writing failed.
+        bool SavePipelineCache();
+
     protected:
         void CleanupSwapChain();
 
+        void CollectReadback(size_t frameIndex);
+
+        [[nodiscard]] const std::vector<const char *> &GetDeviceExtensions() const;
+
     protected:
         vk::raii::Context m_Context;
+        // nullptr when headless
+        SDL_Window *m_Window = nullptr;
         vk::raii::Instance m_Instance{nullptr};
 
         vk::raii::SurfaceKHR m_Surface{nullptr};
@@ -112,17 +343,42 @@ namespace EasyGui {
         vk::raii::PhysicalDevice m_PhysicalDevice{nullptr};
         vk::raii::Device m_Device{nullptr};
 
+        // shared by ImGui and every pipeline created by layers
+        vk::raii::PipelineCache m_PipelineCache{nullptr};
+        std::filesystem::path m_PipelineCachePath;
+        // hash of the data in the file, so an unchanged cache is not written again
+        std::optional<uint64_t> m_SavedPipelineCacheHash;
+
         vma::UniqueAllocator m_Allocator;
 
+        DeferredDeletionQueue m_DeletionQueue;
+
+        // keyed by frame number
+        std::unique_ptr<StagingRing> m_StagingRing;
+
         vk::raii::Queue m_GraphicsQueue{nullptr};
         vk::raii::Queue m_PresentQueue{nullptr};
+        // the graphics queue when the device has no dedicated transfer family
+        vk::raii::Queue m_TransferQueue{nullptr};
+        uint32_t m_GraphicsQueueFamily = 0;
+        uint32_t m_TransferQueueFamily = 0;
         vk::raii::SwapchainKHR m_SwapChain{nullptr};
+        // replaced swapchains waiting for the first present of their successor
+        std::vector<RetiredSwapChain> m_RetiredSwapChains;
 
         std::vector<vk::Image> m_SwapChainImages;
         vk::Format m_SwapChainImageFormat;
         vk::Extent2D m_SwapChainExtent;
         std::vector<vk::raii::ImageView> m_SwapChainImageViews;
 
+        // headless only, m_SwapChainImages refers to these
+        std::vector<vma::UniqueImage> m_OffscreenImages;
+        std::vector<vma::UniqueAllocation> m_OffscreenAllocations;
+        std::vector<vma::UniqueBuffer> m_ReadbackBuffers;
+        std::vector<vma::UniqueAllocation> m_ReadbackAllocations;
+        std::vector<std::optional<uint64_t>> m_PendingReadbacks;
+        std::function<void(const OffscreenFrame &)> m_ReadbackCallback;
+
         vk::raii::DescriptorPool m_DescriptorPool{nullptr};
         vk::raii::Sampler m_Sampler{nullptr};
 
@@ -134,14 +390,33 @@ namespace EasyGui {
         std::vector<vk::raii::Semaphore> m_RenderFinishedSemaphores;
         std::vector<vk::raii::Fence> m_InFlightFences;
         std::vector<vk::raii::CommandBuffer> m_CommandBuffers;
+        std::unique_ptr<SecondaryCommandPool> m_SecondaryCommandPool;
+
+        std::vector<GpuTimestampFrame> m_GpuTimestampFrames;
+        std::vector<GpuZoneTiming> m_GpuTimings;
+        double m_TimestampPeriod = 0.0;
+        uint64_t m_TimestampMask = 0;
 
     protected:
         size_t m_MinImageCount = 0;
         size_t m_ImageCount = 0;
         size_t m_CurrentFrame = 0;
+        // number of frames submitted so far, and per frame in flight the number its last submission got
+        uint64_t m_FrameNumber = 0;
+        bool m_SupportsBindlessTextures = false;
+        uint64_t m_CompletedFrameNumber = 0;
+        std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> m_SubmittedFrameNumbers{};
+        bool m_Headless = false;
+        bool m_EnableReadback = false;
+        PresentMode m_PreferredPresentMode = PresentMode::Fifo;
+        vk::PresentModeKHR m_PresentMode = vk::PresentModeKHR::eFifo;
         vk::ClearValue m_ClearColor = vk::ClearColorValue(std::array{0.0f, 0.0f, 0.0f, 1.0f});
 
     protected:
+        constexpr static uint32_t s_MaxGpuTimestampQueries = 256;
+
+        inline static std::optional<std::filesystem::path> s_PipelineCacheDirectory;
+
         const inline static std::vector<const char *> s_ValidationLayers = {
             "VK_LAYER_KHRONOS_validation"
         };
@@ -152,17 +427,30 @@ namespace EasyGui {
             vk::EXTMemoryBudgetExtensionName
         };
 
+        const inline static std::vector<const char *> s_HeadlessDeviceExtensions = {
+            vk::KHRMapMemory2ExtensionName,
+            vk::EXTMemoryBudgetExtensionName
+        };
+
     public:
         const vk::raii::Context &GetRaiiContext() { return m_Context; }
         vk::raii::Instance &GetVulkanInstance() { return m_Instance; }
         vk::raii::PhysicalDevice &GetPhysicalDevice() { return m_PhysicalDevice; }
         vk::raii::Device &GetLogicalDevice() { return m_Device; }
+        vk::raii::PipelineCache &GetPipelineCache() { return m_PipelineCache; }
         vk::raii::SurfaceKHR &GetSurface() { return m_Surface; }
         vk::raii::Queue &GetGraphicsQueue() { return m_GraphicsQueue; }
         vk::raii::Queue &GetPresentQueue() { return m_PresentQueue; }
+        vk::raii::Queue &GetTransferQueue() { return m_TransferQueue; }
+        uint32_t GetGraphicsQueueFamily() const { return m_GraphicsQueueFamily; }
+        uint32_t GetTransferQueueFamily() const { return m_TransferQueueFamily; }
+        bool HasDedicatedTransferQueue() const { return m_TransferQueueFamily != m_GraphicsQueueFamily; }
         vk::raii::RenderPass &GetRenderPass() { return m_RenderPass; }
+        vk::raii::Sampler &GetSampler() { return m_Sampler; }
         vk::raii::CommandPool &GetCommandPool() { return m_CommandPool; }
         vma::UniqueAllocator &GetAllocator() { return m_Allocator; }
+        DeferredDeletionQueue &GetDeletionQueue() { return m_DeletionQueue; }
+        StagingRing &GetStagingRing() { return *m_StagingRing; }
 
         vk::Extent2D GetSwapChainExtent() const {
             return m_SwapChainExtent;
@@ -0,0 +1,82 @@
+export module EasyGui.Graphics.SecondaryCommandPool;
+
+import EasyGui.Lib;
+import std;
+
+namespace EasyGui {
+    // Secondary command buffers for recording on several threads at once.
+    //
+    // Command pools must not be used by two threads at the same time, so every thread gets its own pool per frame in
+    // flight. Once the fence of a frame has signaled its pools are reset as a whole and their buffers are handed out
+    // again, so a steady number of recording threads allocates nothing per frame. Thread safe.
+    export class SecondaryCommandPool {
+    public:
+        SecondaryCommandPool(const vk::raii::Device &device, uint32_t queueFamily, size_t framesInFlight)
+            : m_Device(device), m_QueueFamily(queueFamily), m_Frames(framesInFlight) {}
+
+        SecondaryCommandPool(const SecondaryCommandPool &) = delete;
+
+        SecondaryCommandPool &operator=(const SecondaryCommandPool &) = delete;
+
+        // the fence of the frame must have been waited on
+        void Reset(size_t frame) {
+            std::lock_guard lock(m_Mutex);
+            for (auto &[thread, pool]: m_Frames[frame]) {
+                if (pool->Used == 0) continue;
+
+                pool->Pool.reset();
+                pool->Used = 0;
+            }
+        }
+
+        // a buffer from the pool of the calling thread, begun to continue the subpass described by inheritance
+        vk::CommandBuffer Begin(size_t frame, const vk::CommandBufferInheritanceInfo &inheritance) {
+            ThreadPool &pool = GetThreadPool(frame);
+
+            if (pool.Used == pool.Buffers.size()) {
+                vk::CommandBufferAllocateInfo allocInfo{
+                    .commandPool = *pool.Pool,
+                    .level = vk::CommandBufferLevel::eSecondary,
+                    .commandBufferCount = 1
+                };
+                pool.Buffers.push_back(std::move(m_Device.allocateCommandBuffers(allocInfo).value().front()));
+            }
+
+            vk::CommandBuffer commandBuffer = *pool.Buffers[pool.Used++];
+            commandBuffer.begin(vk::CommandBufferBeginInfo{
+                .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit |
+                         vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+                .pInheritanceInfo = &inheritance
+            });
+            return commandBuffer;
+        }
+
+    private:
+        struct ThreadPool {
+            vk::raii::CommandPool Pool{nullptr};
+            std::vector<vk::raii::CommandBuffer> Buffers;
+            // buffers handed out since the last reset
+            size_t Used = 0;
+        };
+
+        // only the owning thread touches the pool afterwards, the map itself is guarded
+        ThreadPool &GetThreadPool(size_t frame) {
+            std::lock_guard lock(m_Mutex);
+            auto &pool = m_Frames[frame][std::this_thread::get_id()];
+            if (!pool) {
+                pool = std::make_unique<ThreadPool>();
+                pool->Pool = m_Device.createCommandPool(vk::CommandPoolCreateInfo{
+                    .flags = vk::CommandPoolCreateFlagBits::eTransient,
+                    .queueFamilyIndex = m_QueueFamily
+                }).value();
+            }
+            return *pool;
+        }
+
+        const vk::raii::Device &m_Device;
+        uint32_t m_QueueFamily = 0;
+
+        std::mutex m_Mutex;
+        std::vector<std::unordered_map<std::thread::id, std::unique_ptr<ThreadPool>>> m_Frames;
+    };
+}
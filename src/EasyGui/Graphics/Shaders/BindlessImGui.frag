@@ -0,0 +1,21 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// every texture ImGui draws with, ImTextureID is the index into this array
+layout(set = 0, binding = 0) uniform sampler2D u_Textures[];
+
+layout(push_constant) uniform PushConstants {
+    vec2 Scale;
+    vec2 Translate;
+    uint TextureIndex;
+} u_PushConstants;
+
+layout(location = 0) in vec4 v_Color;
+layout(location = 1) in vec2 v_UV;
+
+layout(location = 0) out vec4 o_Color;
+
+void main() {
+    // push constants are uniform across the draw, no nonuniformEXT needed
+    o_Color = v_Color * texture(u_Textures[u_PushConstants.TextureIndex], v_UV);
+}
@@ -0,0 +1,20 @@
+#version 450
+
+layout(location = 0) in vec2 a_Position;
+layout(location = 1) in vec2 a_UV;
+layout(location = 2) in vec4 a_Color;
+
+layout(push_constant) uniform PushConstants {
+    vec2 Scale;
+    vec2 Translate;
+    uint TextureIndex;
+} u_PushConstants;
+
+layout(location = 0) out vec4 v_Color;
+layout(location = 1) out vec2 v_UV;
+
+void main() {
+    v_Color = a_Color;
+    v_UV = a_UV;
+    gl_Position = vec4(a_Position * u_PushConstants.Scale + u_PushConstants.Translate, 0.0, 1.0);
+}
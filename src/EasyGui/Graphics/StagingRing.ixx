@@ -0,0 +1,207 @@
+export module EasyGui.Graphics.StagingRing;
+
+import EasyGui.Lib;
+import std;
+
+namespace EasyGui {
+    // A region of the staging ring, write to Data then copy from Buffer at Offset.
+    export struct StagingAllocation {
+        vk::Buffer Buffer;
+        vk::DeviceSize Offset = 0;
+        std::span<std::byte> Data;
+        uint64_t Id = 0;
+    };
+
+    // Sub-allocates upload memory from a large, persistently mapped host buffer.
+    //
+    // Allocations are released with the value of the counter that tells when the GPU is done reading them, a frame
+    // number or a timeline semaphore value, and become reusable once Reclaim() passes that value. Memory is recycled
+    // in allocation order. When the ring runs out of space a bigger buffer replaces it, the old one is freed after
+    // its last allocation has been reclaimed. An allocation that is never released therefore holds back everything
+    // allocated after it, growing past one is reported once on std::cerr. Thread safe.
+    export class StagingRing {
+    public:
+        constexpr static vk::DeviceSize DefaultSize = 64ull << 20;
+
+        explicit StagingRing(vma::Allocator allocator, vk::DeviceSize initialSize = DefaultSize)
+            : m_Allocator(allocator), m_InitialSize(initialSize) {}
+
+        StagingRing(const StagingRing &) = delete;
+
+        StagingRing &operator=(const StagingRing &) = delete;
+
+        StagingAllocation Allocate(vk::DeviceSize size, vk::DeviceSize alignment = 16) {
+            std::lock_guard lock(m_Mutex);
+            ReclaimLocked();
+
+            auto offset = TryAllocate(size, alignment);
+            if (!offset) {
+                Grow(size);
+                offset = TryAllocate(size, alignment);
+            }
+
+            uint64_t id = m_FirstRecordId + m_Records.size();
+            m_Records.push_back(Record{
+                .Owner = m_Block,
+                .End = *offset + size,
+                .Value = 0,
+                .Released = false
+            });
+
+            return StagingAllocation{
+                .Buffer = *m_Block->Buffer,
+                .Offset = *offset,
+                .Data = {m_Block->Mapped + *offset, static_cast<size_t>(size)},
+                .Id = id
+            };
+        }
+
+        // makes the CPU writes visible to the device, a no-op on coherent memory
+        void Flush(const StagingAllocation &allocation) {
+            std::lock_guard lock(m_Mutex);
+            const auto &block = m_Records[allocation.Id - m_FirstRecordId].Owner;
+            std::ignore = m_Allocator.flushAllocation(*block->Allocation, allocation.Offset, allocation.Data.size());
+        }
+
+        // the allocation may be reused once Reclaim() is called with completedValue >= value, 0 releases it right away
+        void Release(const StagingAllocation &allocation, uint64_t value) {
+            std::lock_guard lock(m_Mutex);
+            auto &record = m_Records[allocation.Id - m_FirstRecordId];
+            record.Value = value;
+            record.Released = true;
+        }
+
+        void Reclaim(uint64_t completedValue) {
+            std::lock_guard lock(m_Mutex);
+            m_CompletedValue = std::max(m_CompletedValue, completedValue);
+            ReclaimLocked();
+        }
+
+        [[nodiscard]] vk::DeviceSize GetCapacity() const {
+            std::lock_guard lock(m_Mutex);
+            return m_Block ? m_Block->Size : 0;
+        }
+
+    private:
+        struct Block {
+            vma::UniqueBuffer Buffer;
+            vma::UniqueAllocation Allocation;
+            std::byte *Mapped = nullptr;
+            vk::DeviceSize Size = 0;
+        };
+
+        struct Record {
+            // keeps a replaced block alive until its last allocation is reclaimed
+            std::shared_ptr<Block> Owner;
+            vk::DeviceSize End;
+            uint64_t Value;
+            bool Released;
+        };
+
+        void ReclaimLocked() {
+            while (!m_Records.empty() && m_Records.front().Released && m_Records.front().Value <= m_CompletedValue) {
+                if (m_Records.front().Owner == m_Block) {
+                    m_Tail = m_Records.front().End;
+                }
+                m_Records.pop_front();
+                m_FirstRecordId++;
+            }
+
+            // nothing lives in the current block anymore, start over at its beginning
+            if (IsCurrentBlockEmpty()) {
+                m_Head = 0;
+                m_Tail = 0;
+            }
+        }
+
+        [[nodiscard]] bool IsCurrentBlockEmpty() const {
+            return m_Records.empty() || m_Records.back().Owner != m_Block;
+        }
+
+        std::optional<vk::DeviceSize> TryAllocate(vk::DeviceSize size, vk::DeviceSize alignment) {
+            if (!m_Block) return std::nullopt;
+
+            auto alignUp = [alignment](vk::DeviceSize value) {
+                return (value + alignment - 1) / alignment * alignment;
+            };
+
+            vk::DeviceSize offset = alignUp(m_Head);
+            if (IsCurrentBlockEmpty() || m_Head > m_Tail) {
+                // free space runs from the head to the end, then wraps around up to the tail
+                if (offset + size <= m_Block->Size) {
+                    m_Head = offset + size;
+                    return offset;
+                }
+                if (!IsCurrentBlockEmpty() && size <= m_Tail) {
+                    m_Head = size;
+                    return 0;
+                }
+                return std::nullopt;
+            }
+
+            // wrapped, free space lies between the head and the tail
+            if (offset + size <= m_Tail) {
+                m_Head = offset + size;
+                return offset;
+            }
+            return std::nullopt;
+        }
+
+        // a leaked allocation looks like a ring that keeps doubling, name the allocation that blocks it
+        void ReportUnreleased(vk::DeviceSize newSize) {
+            if (m_Records.empty() || m_Records.front().Released) return;
+            if (m_ReportedRecordId == m_FirstRecordId) return;
+
+            m_ReportedRecordId = m_FirstRecordId;
+            std::cerr << "StagingRing grows to " << (newSize >> 20) << " MB while allocation " << m_FirstRecordId
+                      << " is still not released, " << m_Records.size() - 1
+                      << " later allocations wait for it to be reclaimed" << std::endl;
+        }
+
+        void Grow(vk::DeviceSize minimumSize) {
+            vk::DeviceSize size = m_Block ? m_Block->Size * 2 : m_InitialSize;
+            while (size < minimumSize) {
+                size *= 2;
+            }
+            ReportUnreleased(size);
+
+            vk::BufferCreateInfo bufferInfo{
+                .size = size,
+                .usage = vk::BufferUsageFlagBits::eTransferSrc,
+                .sharingMode = vk::SharingMode::eExclusive
+            };
+
+            vma::AllocationCreateInfo allocInfo{
+                .flags = vma::AllocationCreateFlagBits::eHostAccessSequentialWrite |
+                         vma::AllocationCreateFlagBits::eMapped,
+                .usage = vma::MemoryUsage::eAuto
+            };
+
+            vma::AllocationInfo info;
+            auto [buffer, allocation] = m_Allocator.createBufferUnique(bufferInfo, allocInfo, &info).value;
+
+            auto block = std::make_shared<Block>();
+            block->Buffer = std::move(buffer);
+            block->Allocation = std::move(allocation);
+            block->Mapped = static_cast<std::byte *>(info.pMappedData);
+            block->Size = size;
+
+            // the old block stays referenced by its outstanding records
+            m_Block = std::move(block);
+            m_Head = 0;
+            m_Tail = 0;
+        }
+
+        vma::Allocator m_Allocator;
+        vk::DeviceSize m_InitialSize;
+
+        mutable std::mutex m_Mutex;
+        std::shared_ptr<Block> m_Block;
+        vk::DeviceSize m_Head = 0;
+        vk::DeviceSize m_Tail = 0;
+        std::deque<Record> m_Records;
+        uint64_t m_FirstRecordId = 0;
+        uint64_t m_CompletedValue = 0;
+        std::optional<uint64_t> m_ReportedRecordId;
+    };
+}
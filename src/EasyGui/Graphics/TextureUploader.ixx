@@ -0,0 +1,409 @@
+export module EasyGui.Graphics.TextureUploader;
+
+import EasyGui.Lib;
+import EasyGui.Graphics.GraphicsContext;
+import EasyGui.Graphics.StagingRing;
+import EasyGui.Utils.Image;
+import EasyGui.Tools.Profiler;
+import std;
+
+import "EasyGui/Tools/ProfilerDefines.hpp";
+
+namespace EasyGui::Vulkan {
+    // Uploads textures without stalling the GPU or the calling thread.
+    //
+    // Upload() may be called from any thread, it writes into the staging ring and queues the copy. The main loop calls
+    // Submit() and Poll() once per iteration: everything queued since the last Submit() is recorded into one command
+    // buffer on the transfer queue, ownership of the images is handed to the graphics queue family and the batch
+    // signals a timeline semaphore. Poll() resolves the futures of every batch the semaphore has reached.
+    // Futures are resolved on the main thread, so they must not be waited on there.
+    export class TextureUploader {
+    public:
+        explicit TextureUploader(GraphicsContext &context)
+            : m_Context(context), m_StagingRing(*context.GetAllocator()) {
+            auto &device = m_Context.GetLogicalDevice();
+
+            m_TransferCommandPool = device.createCommandPool(vk::CommandPoolCreateInfo{
+                .flags = vk::CommandPoolCreateFlagBits::eTransient,
+                .queueFamilyIndex = m_Context.GetTransferQueueFamily()
+            }).value();
+
+            if (m_Context.HasDedicatedTransferQueue()) {
+                m_AcquireCommandPool = device.createCommandPool(vk::CommandPoolCreateInfo{
+                    .flags = vk::CommandPoolCreateFlagBits::eTransient,
+                    .queueFamilyIndex = m_Context.GetGraphicsQueueFamily()
+                }).value();
+                m_TransferSemaphore = CreateTimelineSemaphore();
+            }
+
+            m_ReadySemaphore = CreateTimelineSemaphore();
+        }
+
+        TextureUploader(const TextureUploader &) = delete;
+
+        TextureUploader &operator=(const TextureUploader &) = delete;
+
+        ~TextureUploader() {
+            // queued uploads are dropped, their futures report a broken promise
+            if (m_Batches.empty()) return;
+
+            uint64_t value = m_Batches.back().ReadyValue;
+            vk::SemaphoreWaitInfo waitInfo{
+                .semaphoreCount = 1,
+                .pSemaphores = &*m_ReadySemaphore,
+                .pValues = &value
+            };
+            std::ignore = m_Context.GetLogicalDevice().waitSemaphores(waitInfo, std::numeric_limits<uint64_t>::max());
+        }
+
+        // thread safe, data is copied before returning and only needs to hold width * height texels of format
+        std::future<PixelImage> Upload(uint32_t width, uint32_t height, vk::Format format, const void *data) {
+            return Upload(width, height, format, [data](std::span<std::byte> pixels) {
+                std::memcpy(pixels.data(), data, pixels.size());
+            });
+        }
+
+        // thread safe, write receives the mapped staging memory of width * height texels of format to fill in place
+        std::future<PixelImage> Upload(uint32_t width, uint32_t height, vk::Format format,
+                                       std::invocable<std::span<std::byte>> auto &&write) {
+            EASYGUI_PROFILE_ZONE("TextureUploader::Upload");
+            vk::DeviceSize size = static_cast<vk::DeviceSize>(width) * height * vk::blockSize(format);
+
+            StagingAllocation staging = m_StagingRing.Allocate(size);
+            write(staging.Data);
+            m_StagingRing.Flush(staging);
+
+            vma::Allocator allocator = *m_Context.GetAllocator();
+
+            vk::ImageCreateInfo imageInfo{
+                .imageType = vk::ImageType::e2D,
+                .format = format,
+                .extent = {
+                    .width = width,
+                    .height = height,
+                    .depth = 1
+                },
+                .mipLevels = 1,
+                .arrayLayers = 1,
+                .samples = vk::SampleCountFlagBits::e1,
+                .tiling = vk::ImageTiling::eOptimal,
+                .usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+                .sharingMode = vk::SharingMode::eExclusive,
+                .initialLayout = vk::ImageLayout::eUndefined
+            };
+
+            vma::AllocationCreateInfo imageAllocInfo{
+                .usage = vma::MemoryUsage::eAutoPreferDevice
+            };
+
+            auto [image, memory] = allocator.createImageUnique(imageInfo, imageAllocInfo).value;
+
+            vk::ImageViewCreateInfo viewInfo{
+                .image = *image,
+                .viewType = vk::ImageViewType::e2D,
+                .format = format,
+                .subresourceRange = s_ColorRange
+            };
+
+            vk::UniqueImageView imageView = (*m_Context.GetLogicalDevice()).createImageViewUnique(viewInfo).value;
+
+            PendingUpload upload{
+                .Image = std::move(image),
+                .Memory = std::move(memory),
+                .ImageView = std::move(imageView),
+                .Staging = staging,
+                .Width = width,
+                .Height = height,
+                .Promise = {}
+            };
+            auto future = upload.Promise.get_future();
+
+            {
+                std::lock_guard lock(m_QueueMutex);
+                m_Queued.push_back(std::move(upload));
+            }
+
+            if (m_WakeCallback) {
+                m_WakeCallback();
+            }
+            return future;
+        }
+
+        // called after Upload() queued work, lets an idle main loop pick it up
+        void SetWakeCallback(std::function<void()> callback) {
+            m_WakeCallback = std::move(callback);
+        }
+
+        // main thread, records and submits everything queued so far as a single batch
+        void Submit() {
+            std::vector<PendingUpload> uploads;
+            {
+                std::lock_guard lock(m_QueueMutex);
+                uploads.swap(m_Queued);
+            }
+
+            if (uploads.empty()) return;
+
+            EASYGUI_PROFILE_ZONE("TextureUploader::Submit");
+            bool transferOwnership = m_Context.HasDedicatedTransferQueue();
+
+            Batch batch{
+                .Uploads = std::move(uploads),
+                .TransferCommandBuffer = AllocateCommandBuffer(m_TransferCommandPool),
+                .AcquireCommandBuffer{nullptr},
+                .ReadyValue = 0
+            };
+
+            std::vector<vk::ImageMemoryBarrier> toTransferBarriers;
+            std::vector<vk::ImageMemoryBarrier> releaseBarriers;
+            std::vector<vk::ImageMemoryBarrier> acquireBarriers;
+            toTransferBarriers.reserve(batch.Uploads.size());
+            releaseBarriers.reserve(batch.Uploads.size());
+
+            for (const auto &upload: batch.Uploads) {
+                toTransferBarriers.push_back(vk::ImageMemoryBarrier{
+                    .srcAccessMask = vk::AccessFlagBits::eNone,
+                    .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+                    .oldLayout = vk::ImageLayout::eUndefined,
+                    .newLayout = vk::ImageLayout::eTransferDstOptimal,
+                    .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                    .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                    .image = *upload.Image,
+                    .subresourceRange = s_ColorRange
+                });
+
+                // without a dedicated transfer family this is a plain layout transition on the graphics queue
+                vk::ImageMemoryBarrier releaseBarrier{
+                    .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                    .dstAccessMask = transferOwnership ? vk::AccessFlagBits::eNone : vk::AccessFlagBits::eShaderRead,
+                    .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+                    .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+                    .srcQueueFamilyIndex = transferOwnership ? m_Context.GetTransferQueueFamily() : vk::QueueFamilyIgnored,
+                    .dstQueueFamilyIndex = transferOwnership ? m_Context.GetGraphicsQueueFamily() : vk::QueueFamilyIgnored,
+                    .image = *upload.Image,
+                    .subresourceRange = s_ColorRange
+                };
+                releaseBarriers.push_back(releaseBarrier);
+
+                if (transferOwnership) {
+                    // the acquire has to repeat the layout transition and family indices of the release
+                    vk::ImageMemoryBarrier acquireBarrier = releaseBarrier;
+                    acquireBarrier.srcAccessMask = vk::AccessFlagBits::eNone;
+                    acquireBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+                    acquireBarriers.push_back(acquireBarrier);
+                }
+            }
+
+            vk::CommandBufferBeginInfo beginInfo{
+                .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit
+            };
+
+            auto &transferCommandBuffer = batch.TransferCommandBuffer;
+            transferCommandBuffer.begin(beginInfo);
+            transferCommandBuffer.pipelineBarrier(
+                vk::PipelineStageFlagBits::eTopOfPipe,
+                vk::PipelineStageFlagBits::eTransfer,
+                {}, {}, {}, toTransferBarriers
+            );
+
+            for (const auto &upload: batch.Uploads) {
+                vk::BufferImageCopy region{
+                    .bufferOffset = upload.Staging.Offset,
+                    .bufferRowLength = 0,
+                    .bufferImageHeight = 0,
+                    .imageSubresource = {
+                        .aspectMask = vk::ImageAspectFlagBits::eColor,
+                        .mipLevel = 0,
+                        .baseArrayLayer = 0,
+                        .layerCount = 1
+                    },
+                    .imageOffset = {0, 0, 0},
+                    .imageExtent = {upload.Width, upload.Height, 1}
+                };
+
+                transferCommandBuffer.copyBufferToImage(
+                    upload.Staging.Buffer, *upload.Image, vk::ImageLayout::eTransferDstOptimal, region
+                );
+            }
+
+            transferCommandBuffer.pipelineBarrier(
+                vk::PipelineStageFlagBits::eTransfer,
+                transferOwnership ? vk::PipelineStageFlagBits::eBottomOfPipe : vk::PipelineStageFlagBits::eFragmentShader,
+                {}, {}, {}, releaseBarriers
+            );
+            transferCommandBuffer.end();
+
+            if (!transferOwnership) {
+                batch.ReadyValue = ++m_ReadyValue;
+                SubmitSignal(m_Context.GetGraphicsQueue(), transferCommandBuffer, m_ReadySemaphore, batch.ReadyValue);
+                ReleaseStaging(batch);
+                m_Batches.push_back(std::move(batch));
+                return;
+            }
+
+            uint64_t transferValue = ++m_TransferValue;
+            SubmitSignal(m_Context.GetTransferQueue(), transferCommandBuffer, m_TransferSemaphore, transferValue);
+
+            batch.AcquireCommandBuffer = AllocateCommandBuffer(m_AcquireCommandPool);
+            auto &acquireCommandBuffer = batch.AcquireCommandBuffer;
+            acquireCommandBuffer.begin(beginInfo);
+            acquireCommandBuffer.pipelineBarrier(
+                vk::PipelineStageFlagBits::eTopOfPipe,
+                vk::PipelineStageFlagBits::eFragmentShader,
+                {}, {}, {}, acquireBarriers
+            );
+            acquireCommandBuffer.end();
+
+            batch.ReadyValue = ++m_ReadyValue;
+            vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eAllCommands;
+            vk::TimelineSemaphoreSubmitInfo timelineInfo{
+                .waitSemaphoreValueCount = 1,
+                .pWaitSemaphoreValues = &transferValue,
+                .signalSemaphoreValueCount = 1,
+                .pSignalSemaphoreValues = &batch.ReadyValue
+            };
+
+            vk::SubmitInfo submitInfo{
+                .pNext = &timelineInfo,
+                .waitSemaphoreCount = 1,
+                .pWaitSemaphores = &*m_TransferSemaphore,
+                .pWaitDstStageMask = &waitStage,
+                .commandBufferCount = 1,
+                .pCommandBuffers = &*acquireCommandBuffer,
+                .signalSemaphoreCount = 1,
+                .pSignalSemaphores = &*m_ReadySemaphore
+            };
+
+            m_Context.GetGraphicsQueue().submit(submitInfo);
+            ReleaseStaging(batch);
+            m_Batches.push_back(std::move(batch));
+        }
+
+        // main thread, resolves the futures of every finished batch and returns how many images became ready
+        size_t Poll() {
+            if (m_Batches.empty()) return 0;
+
+            uint64_t completedValue = m_ReadySemaphore.getCounterValue().value;
+            m_StagingRing.Reclaim(completedValue);
+
+            size_t resolved = 0;
+            while (!m_Batches.empty() && m_Batches.front().ReadyValue <= completedValue) {
+                for (auto &upload: m_Batches.front().Uploads) {
+                    upload.Promise.set_value(PixelImage(
+                        std::move(upload.Image),
+                        std::move(upload.Memory),
+                        std::move(upload.ImageView),
+                        upload.Width, upload.Height,
+                        &m_Context.GetDeletionQueue()
+                    ));
+                    resolved++;
+                }
+                m_Batches.pop_front();
+            }
+
+            return resolved;
+        }
+
+        // uploads waiting for the next Submit()
+        [[nodiscard]] bool HasQueuedUploads() const {
+            std::lock_guard lock(m_QueueMutex);
+            return !m_Queued.empty();
+        }
+
+        // submitted batches whose futures are not resolved yet
+        [[nodiscard]] bool HasUploadsInFlight() const {
+            return !m_Batches.empty();
+        }
+
+    private:
+        struct PendingUpload {
+            vma::UniqueImage Image;
+            vma::UniqueAllocation Memory;
+            vk::UniqueImageView ImageView;
+            StagingAllocation Staging;
+            uint32_t Width;
+            uint32_t Height;
+            std::promise<PixelImage> Promise;
+        };
+
+        struct Batch {
+            std::vector<PendingUpload> Uploads;
+            vk::raii::CommandBuffer TransferCommandBuffer;
+            vk::raii::CommandBuffer AcquireCommandBuffer;
+            uint64_t ReadyValue;
+        };
+
+        constexpr static vk::ImageSubresourceRange s_ColorRange{
+            .aspectMask = vk::ImageAspectFlagBits::eColor,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        };
+
+        // the ring reuses the memory once the ready semaphore reached the batch
+        void ReleaseStaging(const Batch &batch) {
+            for (const auto &upload: batch.Uploads) {
+                m_StagingRing.Release(upload.Staging, batch.ReadyValue);
+            }
+        }
+
+        vk::raii::Semaphore CreateTimelineSemaphore() {
+            vk::SemaphoreTypeCreateInfo typeInfo{
+                .semaphoreType = vk::SemaphoreType::eTimeline,
+                .initialValue = 0
+            };
+
+            return m_Context.GetLogicalDevice().createSemaphore(vk::SemaphoreCreateInfo{
+                .pNext = &typeInfo
+            }).value();
+        }
+
+        vk::raii::CommandBuffer AllocateCommandBuffer(const vk::raii::CommandPool &commandPool) {
+            vk::CommandBufferAllocateInfo allocInfo{
+                .commandPool = *commandPool,
+                .level = vk::CommandBufferLevel::ePrimary,
+                .commandBufferCount = 1
+            };
+
+            return std::move(m_Context.GetLogicalDevice().allocateCommandBuffers(allocInfo).value().front());
+        }
+
+        static void SubmitSignal(vk::raii::Queue &queue, const vk::raii::CommandBuffer &commandBuffer,
+                                 const vk::raii::Semaphore &semaphore, uint64_t value) {
+            vk::TimelineSemaphoreSubmitInfo timelineInfo{
+                .signalSemaphoreValueCount = 1,
+                .pSignalSemaphoreValues = &value
+            };
+
+            vk::SubmitInfo submitInfo{
+                .pNext = &timelineInfo,
+                .commandBufferCount = 1,
+                .pCommandBuffers = &*commandBuffer,
+                .signalSemaphoreCount = 1,
+                .pSignalSemaphores = &*semaphore
+            };
+
+            queue.submit(submitInfo);
+        }
+
+        GraphicsContext &m_Context;
+        // keyed by ready semaphore values
+        StagingRing m_StagingRing;
+
+        vk::raii::CommandPool m_TransferCommandPool{nullptr};
+        vk::raii::CommandPool m_AcquireCommandPool{nullptr};
+        // signaled by the transfer queue, only used with a dedicated transfer family
+        vk::raii::Semaphore m_TransferSemaphore{nullptr};
+        // signaled on the graphics queue once a batch can be sampled
+        vk::raii::Semaphore m_ReadySemaphore{nullptr};
+        uint64_t m_TransferValue = 0;
+        uint64_t m_ReadyValue = 0;
+
+        mutable std::mutex m_QueueMutex;
+        std::vector<PendingUpload> m_Queued;
+        std::deque<Batch> m_Batches;
+
+        std::function<void()> m_WakeCallback;
+    };
+}
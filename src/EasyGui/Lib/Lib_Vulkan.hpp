@@ -3,6 +3,7 @@
 #include <vulkan/vulkan.h>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_raii.hpp>
+#include <vulkan/vulkan_format_traits.hpp>
 #include <vk_mem_alloc.h>
 #include <vk_mem_alloc.hpp>
 export namespace VMA_HPP_NAMESPACE {
@@ -0,0 +1,81 @@
+export module EasyGui.Tools.Cancellation;
+
+import std;
+
+namespace EasyGui {
+    // thrown by CancellationToken::ThrowIfCancelled, and stored in the future of a task dropped before it ran
+    export class TaskCancelledError : public std::runtime_error {
+    public:
+        TaskCancelledError() : std::runtime_error("Task was cancelled") {}
+    };
+
+    namespace CancellationDetail {
+        struct State {
+            std::atomic_bool Cancelled{false};
+            // a linked source is cancelled together with its parent
+            std::shared_ptr<const State> Parent;
+
+            [[nodiscard]] bool IsCancelled() const {
+                for (const State *state = this; state; state = state->Parent.get()) {
+                    if (state->Cancelled.load(std::memory_order_acquire)) return true;
+                }
+                return false;
+            }
+        };
+    }
+
+    // Read side of a CancellationSource, cheap to copy into tasks. Tasks poll it at convenient points, a default
+    // constructed token is never cancelled.
+    export class CancellationToken {
+    public:
+        CancellationToken() = default;
+
+        [[nodiscard]] bool IsCancelled() const {
+            return m_State && m_State->IsCancelled();
+        }
+
+        void ThrowIfCancelled() const {
+            if (IsCancelled()) throw TaskCancelledError();
+        }
+
+        // false for the default token, tasks may skip their checks then
+        [[nodiscard]] bool CanBeCancelled() const {
+            return m_State != nullptr;
+        }
+
+    private:
+        friend class CancellationSource;
+
+        explicit CancellationToken(std::shared_ptr<const CancellationDetail::State> state)
+            : m_State(std::move(state)) {}
+
+        std::shared_ptr<const CancellationDetail::State> m_State;
+    };
+
+    // Cancels every task holding one of its tokens, queued tasks are dropped before they run and running ones see
+    // it on their next check. Sources created from a parent token form groups, cancelling the parent cancels all of
+    // them, e.g. one source per window with one linked source per job. Cancelling cannot be undone. Thread safe.
+    export class CancellationSource {
+    public:
+        CancellationSource() : m_State(std::make_shared<CancellationDetail::State>()) {}
+
+        explicit CancellationSource(const CancellationToken &parent) : CancellationSource() {
+            m_State->Parent = parent.m_State;
+        }
+
+        void Cancel() {
+            m_State->Cancelled.store(true, std::memory_order_release);
+        }
+
+        [[nodiscard]] bool IsCancelled() const {
+            return m_State->IsCancelled();
+        }
+
+        [[nodiscard]] CancellationToken GetToken() const {
+            return CancellationToken(m_State);
+        }
+
+    private:
+        std::shared_ptr<CancellationDetail::State> m_State;
+    };
+}
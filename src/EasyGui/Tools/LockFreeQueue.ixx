@@ -0,0 +1,191 @@
+export module EasyGui.Tools.LockFreeQueue;
+
+import std;
+
+namespace EasyGui {
+    // Chase-Lev work-stealing deque, in the formulation for C11 atomics by Le, Pop, Cohen and Zappa Nardelli.
+    //
+    // The owning thread pushes and pops at the bottom, LIFO, any other thread steals from the top, FIFO. Only the
+    // owner may call Push and Pop. The ring grows when full. Replaced rings are kept until destruction because a thief
+    // may still be reading from one.
+    export template<typename T> requires std::is_trivially_copyable_v<T>
+    class WorkStealingDeque {
+    public:
+        explicit WorkStealingDeque(size_t capacity = 1024) {
+            m_Rings.push_back(std::make_unique<Ring>(std::bit_ceil(std::max<size_t>(capacity, 2))));
+            m_Ring.store(m_Rings.back().get(), std::memory_order_relaxed);
+        }
+
+        WorkStealingDeque(const WorkStealingDeque &) = delete;
+
+        WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+        // owner only
+        void Push(T item) {
+            int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+            int64_t top = m_Top.load(std::memory_order_acquire);
+            Ring *ring = m_Ring.load(std::memory_order_relaxed);
+            if (bottom - top > ring->Mask) {
+                ring = Grow(ring, top, bottom);
+            }
+
+            ring->Store(bottom, item);
+            // publishes the item, and whatever it points to, to thieves
+            m_Bottom.store(bottom + 1, std::memory_order_release);
+        }
+
+        // owner only, the most recently pushed item
+        std::optional<T> Pop() {
+            int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+            Ring *ring = m_Ring.load(std::memory_order_relaxed);
+            m_Bottom.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t top = m_Top.load(std::memory_order_relaxed);
+
+            if (top > bottom) {
+                m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+                return std::nullopt;
+            }
+
+            T item = ring->Load(bottom);
+            if (top == bottom) {
+                // the last item, thieves may be racing for it
+                bool won = m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                         std::memory_order_relaxed);
+                m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+                if (!won) return std::nullopt;
+            }
+            return item;
+        }
+
+        // any thread, the oldest item, empty when the deque is empty or another thread won the race
+        std::optional<T> Steal() {
+            int64_t top = m_Top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+            if (top >= bottom) return std::nullopt;
+
+            Ring *ring = m_Ring.load(std::memory_order_acquire);
+            T item = ring->Load(top);
+            if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return std::nullopt;
+            }
+            return item;
+        }
+
+        // a snapshot, only exact when called by the owner with no thief around
+        [[nodiscard]] bool IsEmpty() const {
+            return m_Bottom.load(std::memory_order_relaxed) <= m_Top.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct Ring {
+            explicit Ring(size_t capacity)
+                : Mask(static_cast<int64_t>(capacity) - 1), Items(std::make_unique<std::atomic<T>[]>(capacity)) {}
+
+            void Store(int64_t index, T item) {
+                Items[index & Mask].store(item, std::memory_order_relaxed);
+            }
+
+            T Load(int64_t index) const {
+                return Items[index & Mask].load(std::memory_order_relaxed);
+            }
+
+            int64_t Mask;
+            std::unique_ptr<std::atomic<T>[]> Items;
+        };
+
+        Ring *Grow(Ring *ring, int64_t top, int64_t bottom) {
+            auto grown = std::make_unique<Ring>(static_cast<size_t>(ring->Mask + 1) * 2);
+            for (int64_t i = top; i < bottom; i++) {
+                grown->Store(i, ring->Load(i));
+            }
+
+            Ring *result = grown.get();
+            m_Rings.push_back(std::move(grown));
+            m_Ring.store(result, std::memory_order_release);
+            return result;
+        }
+
+        alignas(std::hardware_destructive_interference_size) std::atomic<int64_t> m_Top{0};
+        alignas(std::hardware_destructive_interference_size) std::atomic<int64_t> m_Bottom{0};
+        std::atomic<Ring *> m_Ring{nullptr};
+        // owner only
+        std::vector<std::unique_ptr<Ring>> m_Rings;
+    };
+
+    // Bounded multi-producer multi-consumer queue after Dmitry Vyukov, every slot carries a sequence number that
+    // tells producers and consumers whose turn it is. TryPush fails when the queue is full.
+    export template<typename T> requires std::is_nothrow_move_assignable_v<T> && std::is_default_constructible_v<T>
+    class BoundedMpmcQueue {
+    public:
+        explicit BoundedMpmcQueue(size_t capacity)
+            : m_Mask(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1),
+              m_Cells(std::make_unique<Cell[]>(m_Mask + 1)) {
+            for (size_t i = 0; i <= m_Mask; i++) {
+                m_Cells[i].Sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        BoundedMpmcQueue(const BoundedMpmcQueue &) = delete;
+
+        BoundedMpmcQueue &operator=(const BoundedMpmcQueue &) = delete;
+
+        bool TryPush(T &&item) {
+            size_t position = m_EnqueuePosition.load(std::memory_order_relaxed);
+            while (true) {
+                Cell &cell = m_Cells[position & m_Mask];
+                size_t sequence = cell.Sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+                if (difference == 0) {
+                    if (m_EnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        cell.Item = std::move(item);
+                        cell.Sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = m_EnqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        std::optional<T> TryPop() {
+            size_t position = m_DequeuePosition.load(std::memory_order_relaxed);
+            while (true) {
+                Cell &cell = m_Cells[position & m_Mask];
+                size_t sequence = cell.Sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+                if (difference == 0) {
+                    if (m_DequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        T item = std::move(cell.Item);
+                        cell.Sequence.store(position + m_Mask + 1, std::memory_order_release);
+                        return item;
+                    }
+                } else if (difference < 0) {
+                    return std::nullopt;
+                } else {
+                    position = m_DequeuePosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // a snapshot
+        [[nodiscard]] bool IsEmpty() const {
+            return m_DequeuePosition.load(std::memory_order_relaxed) >=
+                   m_EnqueuePosition.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct Cell {
+            std::atomic<size_t> Sequence{0};
+            T Item{};
+        };
+
+        size_t m_Mask;
+        std::unique_ptr<Cell[]> m_Cells;
+        alignas(std::hardware_destructive_interference_size) std::atomic<size_t> m_EnqueuePosition{0};
+        alignas(std::hardware_destructive_interference_size) std::atomic<size_t> m_DequeuePosition{0};
+    };
+}
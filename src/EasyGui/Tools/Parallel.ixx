@@ -0,0 +1,264 @@
+export module EasyGui.Tools.Parallel;
+
+import std;
+import EasyGui.Tools.ThreadPool;
+
+// Data-parallel loops over a thread pool.
+//
+// A range is cut into grains of contiguous elements, and the grains into one contiguous partition per participating
+// thread, so every thread walks its own stretch of memory. The calling thread takes the first partition itself and
+// the pool gets one helper task per further partition. A thread that is done with its partition takes the remaining
+// grains of the others, which balances uneven work without giving up locality. Helpers that start after all grains
+// are taken return right away, the call returns once every grain ran and rethrows the first exception of the body.
+// Calling these from inside pool tasks is fine, the caller always makes progress on its own.
+namespace EasyGui {
+    export struct ParallelOptions {
+        // elements per grain, 0 splits the range into about eight grains per thread, raise it for cheap elements
+        size_t grainSize = 0;
+        // threads working on the range including the caller, 0 uses every worker of the pool
+        size_t maxThreads = 0;
+        TaskPriority priority = TaskPriority::Normal;
+    };
+
+    namespace ParallelDetail {
+        struct alignas(std::hardware_destructive_interference_size) Partition {
+            // next grain to hand out, runs past End once the partition is exhausted
+            std::atomic<size_t> Next{0};
+            size_t End = 0;
+        };
+
+        struct Loop {
+            explicit Loop(size_t partitionCount, size_t grainCount)
+                : Partitions(partitionCount), GrainCount(grainCount) {
+                for (size_t i = 0; i < partitionCount; i++) {
+                    Partitions[i].Next.store(grainCount * i / partitionCount, std::memory_order_relaxed);
+                    Partitions[i].End = grainCount * (i + 1) / partitionCount;
+                }
+            }
+
+            std::vector<Partition> Partitions;
+            size_t GrainCount;
+
+            alignas(std::hardware_destructive_interference_size) std::atomic<size_t> Finished{0};
+            std::atomic_bool Failed{false};
+            std::mutex ExceptionMutex;
+            std::exception_ptr Exception;
+        };
+
+        // runs grains until none is left, starting with the partition of the thread
+        template<typename Body>
+        void Participate(Loop &loop, size_t partition, Body &body) {
+            size_t partitionCount = loop.Partitions.size();
+            for (size_t i = 0; i < partitionCount; i++) {
+                Partition &current = loop.Partitions[(partition + i) % partitionCount];
+                while (current.Next.load(std::memory_order_relaxed) < current.End) {
+                    size_t grain = current.Next.fetch_add(1, std::memory_order_relaxed);
+                    if (grain >= current.End) break;
+
+                    // after a failure the grains are only counted
+                    if (!loop.Failed.load(std::memory_order_relaxed)) {
+                        try {
+                            body(grain);
+                        } catch (...) {
+                            std::lock_guard lock(loop.ExceptionMutex);
+                            if (!loop.Exception) loop.Exception = std::current_exception();
+                            loop.Failed.store(true, std::memory_order_relaxed);
+                        }
+                    }
+
+                    if (loop.Finished.fetch_add(1, std::memory_order_acq_rel) + 1 == loop.GrainCount) {
+                        loop.Finished.notify_all();
+                    }
+                }
+            }
+        }
+
+        // calls body(grain) for every grain in [0, grainCount)
+        template<typename Body>
+        void ForEachGrain(size_t grainCount, Body &&body, size_t threadCount, TaskPriority priority,
+                          IThreadPool *pool) {
+            if (grainCount == 0) return;
+
+            if (threadCount <= 1 || grainCount == 1) {
+                for (size_t grain = 0; grain < grainCount; grain++) {
+                    body(grain);
+                }
+                return;
+            }
+
+            // shared with the helpers, one of them may only start after the call returned
+            auto loop = std::make_shared<Loop>(std::min(threadCount, grainCount), grainCount);
+            for (size_t partition = 1; partition < loop->Partitions.size(); partition++) {
+                // the body is only touched while a grain is taken, and the caller waits for those
+                pool->EnqueueDetached(TaskOptions{.priority = priority}, [loop, &body, partition] {
+                    Participate(*loop, partition, body);
+                });
+            }
+            Participate(*loop, 0, body);
+
+            size_t finished;
+            while ((finished = loop->Finished.load(std::memory_order_acquire)) != grainCount) {
+                loop->Finished.wait(finished, std::memory_order_acquire);
+            }
+            if (loop->Exception) std::rethrow_exception(loop->Exception);
+        }
+
+        inline size_t GetThreadCount(const ParallelOptions &options, IThreadPool *pool) {
+            // the caller works too
+            size_t threadCount = pool ? pool->GetThreadCount() + 1 : 1;
+            return options.maxThreads ? std::min(threadCount, options.maxThreads) : threadCount;
+        }
+
+        inline size_t GetGrainSize(size_t count, size_t threadCount, const ParallelOptions &options) {
+            if (options.grainSize) return options.grainSize;
+
+            constexpr size_t grainsPerThread = 8;
+            return std::max<size_t>((count + threadCount * grainsPerThread - 1) / (threadCount * grainsPerThread), 1);
+        }
+    }
+
+    // Calls body(begin, end) for consecutive slices covering [0, count), the slices run in parallel. A null pool
+    // runs everything on the calling thread.
+    export template<typename Body> requires std::invocable<Body &, size_t, size_t>
+    void ParallelForRange(size_t count, Body &&body, const ParallelOptions &options = {},
+                          IThreadPool *pool = GlobalThreadPool()) {
+        using namespace ParallelDetail;
+        size_t threadCount = GetThreadCount(options, pool);
+        size_t grainSize = GetGrainSize(count, threadCount, options);
+        size_t grainCount = (count + grainSize - 1) / grainSize;
+
+        ForEachGrain(grainCount, [&](size_t grain) {
+            size_t begin = grain * grainSize;
+            body(begin, std::min(begin + grainSize, count));
+        }, threadCount, options.priority, pool);
+    }
+
+    // calls body(index) for every index in [0, count)
+    export template<typename Body> requires std::invocable<Body &, size_t>
+    void ParallelFor(size_t count, Body &&body, const ParallelOptions &options = {},
+                     IThreadPool *pool = GlobalThreadPool()) {
+        ParallelForRange(count, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                body(i);
+            }
+        }, options, pool);
+    }
+
+    // calls body(element) for every element of the range
+    export template<std::ranges::random_access_range Range, typename Body>
+        requires std::ranges::sized_range<Range> && std::invocable<Body &, std::ranges::range_reference_t<Range>>
+    void ParallelFor(Range &&range, Body &&body, const ParallelOptions &options = {},
+                     IThreadPool *pool = GlobalThreadPool()) {
+        auto first = std::ranges::begin(range);
+        ParallelForRange(static_cast<size_t>(std::ranges::size(range)), [&](size_t begin, size_t end) {
+            for (auto it = first + begin, last = first + end; it != last; ++it) {
+                body(*it);
+            }
+        }, options, pool);
+    }
+
+    // writes function(input[i]) to output[i], returns the end of the output
+    export template<std::ranges::random_access_range Range, std::random_access_iterator Output, typename Function>
+        requires std::ranges::sized_range<Range> &&
+                 std::invocable<Function &, std::ranges::range_reference_t<Range>> &&
+                 std::indirectly_writable<Output, std::invoke_result_t<Function &,
+                                                                       std::ranges::range_reference_t<Range>>>
+    Output ParallelTransform(Range &&input, Output output, Function &&function, const ParallelOptions &options = {},
+                             IThreadPool *pool = GlobalThreadPool()) {
+        auto first = std::ranges::begin(input);
+        auto count = static_cast<size_t>(std::ranges::size(input));
+        ParallelForRange(count, [&](size_t begin, size_t end) {
+            auto out = output + begin;
+            for (auto it = first + begin, last = first + end; it != last; ++it, ++out) {
+                *out = function(*it);
+            }
+        }, options, pool);
+        return output + count;
+    }
+
+    // Folds transform(element) over the range with reduce, which must be associative. Every grain is folded on its
+    // own and the partial results are combined in order after init, so the result does not depend on the timing.
+    export template<std::ranges::random_access_range Range, typename T, typename Reduce, typename Transform>
+        requires std::ranges::sized_range<Range> &&
+                 std::invocable<Transform &, std::ranges::range_reference_t<Range>> &&
+                 std::invocable<Reduce &, T, T>
+    T ParallelReduce(Range &&range, T init, Reduce &&reduce, Transform &&transform,
+                     const ParallelOptions &options = {}, IThreadPool *pool = GlobalThreadPool()) {
+        using namespace ParallelDetail;
+        auto first = std::ranges::begin(range);
+        auto count = static_cast<size_t>(std::ranges::size(range));
+        size_t threadCount = GetThreadCount(options, pool);
+        size_t grainSize = GetGrainSize(count, threadCount, options);
+        size_t grainCount = (count + grainSize - 1) / grainSize;
+
+        std::vector<std::optional<T>> partials(grainCount);
+        ForEachGrain(grainCount, [&](size_t grain) {
+            size_t begin = grain * grainSize;
+            size_t end = std::min(begin + grainSize, count);
+            // starts from the first element, init is only added once
+            T partial = static_cast<T>(transform(first[begin]));
+            for (size_t i = begin + 1; i < end; i++) {
+                partial = reduce(std::move(partial), static_cast<T>(transform(first[i])));
+            }
+            partials[grain].emplace(std::move(partial));
+        }, threadCount, options.priority, pool);
+
+        T result = std::move(init);
+        for (auto &partial: partials) {
+            result = reduce(std::move(result), std::move(*partial));
+        }
+        return result;
+    }
+
+    export template<std::ranges::random_access_range Range, typename T, typename Reduce = std::plus<>>
+        requires std::ranges::sized_range<Range> && std::invocable<Reduce &, T, T>
+    T ParallelReduce(Range &&range, T init, Reduce &&reduce = {}, const ParallelOptions &options = {},
+                     IThreadPool *pool = GlobalThreadPool()) {
+        return ParallelReduce(std::forward<Range>(range), std::move(init), std::forward<Reduce>(reduce),
+                              std::identity{}, options, pool);
+    }
+
+    // Sorts the range, not stable. Every thread sorts one contiguous run, then neighbouring runs are merged in
+    // parallel pairwise rounds. Ranges below a few thousand elements per thread are sorted on the calling thread.
+    export template<std::ranges::random_access_range Range, typename Compare = std::ranges::less>
+        requires std::ranges::sized_range<Range> && std::sortable<std::ranges::iterator_t<Range>, Compare>
+    void ParallelSort(Range &&range, Compare compare = {}, const ParallelOptions &options = {},
+                      IThreadPool *pool = GlobalThreadPool()) {
+        using namespace ParallelDetail;
+        constexpr size_t minRunSize = 4096;
+
+        auto first = std::ranges::begin(range);
+        auto count = static_cast<size_t>(std::ranges::size(range));
+        size_t runCount = std::min(GetThreadCount(options, pool), count / minRunSize);
+        if (runCount <= 1) {
+            std::sort(first, first + count, compare);
+            return;
+        }
+
+        std::vector<size_t> bounds(runCount + 1);
+        for (size_t run = 0; run <= runCount; run++) {
+            bounds[run] = count * run / runCount;
+        }
+
+        ParallelOptions runOptions{.grainSize = 1, .maxThreads = runCount, .priority = options.priority};
+        ParallelFor(runCount, [&](size_t run) {
+            std::sort(first + bounds[run], first + bounds[run + 1], compare);
+        }, runOptions, pool);
+
+        while (bounds.size() > 2) {
+            size_t runs = bounds.size() - 1;
+            ParallelFor(runs / 2, [&](size_t pair) {
+                std::inplace_merge(first + bounds[2 * pair], first + bounds[2 * pair + 1],
+                                   first + bounds[2 * pair + 2], compare);
+            }, runOptions, pool);
+
+            // every second bound is gone, an odd run at the end is carried over
+            std::vector<size_t> merged;
+            for (size_t run = 0; run <= runs; run += 2) {
+                merged.push_back(bounds[run]);
+            }
+            if (runs % 2) merged.push_back(bounds[runs]);
+            bounds = std::move(merged);
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+// target architecture of the SIMD code paths, the intrinsics of the target come with this header
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define EASYGUI_ARCH_X86 1
+#include <immintrin.h>
+#else
+#define EASYGUI_ARCH_X86 0
+#endif
+
+#if defined(_M_ARM64) || defined(__aarch64__)
+#define EASYGUI_ARCH_ARM64 1
+#else
+#define EASYGUI_ARCH_ARM64 0
+#endif
+
+// MSVC declares __cpuid and the ARM hints here
+#if defined(_MSC_VER) && (EASYGUI_ARCH_X86 || EASYGUI_ARCH_ARM64)
+#include <intrin.h>
+#endif
+
+// GCC and Clang only emit AVX2 in functions that ask for it, MSVC takes the intrinsics anywhere
+#if EASYGUI_ARCH_X86 && !defined(_MSC_VER)
+#define EASYGUI_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define EASYGUI_TARGET_AVX2
+#endif
+
+// tells the core that the thread spins on shared state, so a sibling hyper thread gets the execution units
+#if EASYGUI_ARCH_X86
+#define EASYGUI_CPU_RELAX() _mm_pause()
+#elif EASYGUI_ARCH_ARM64 && defined(_MSC_VER)
+#define EASYGUI_CPU_RELAX() __yield()
+#elif EASYGUI_ARCH_ARM64
+#define EASYGUI_CPU_RELAX() __asm__ __volatile__("yield")
+#else
+#include <thread>
+#define EASYGUI_CPU_RELAX() std::this_thread::yield()
+#endif
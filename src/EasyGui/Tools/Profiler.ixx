@@ -0,0 +1,323 @@
+export module EasyGui.Tools.Profiler;
+
+import std.compat;
+
+namespace EasyGui::Profiling {
+    export struct ZoneEvent {
+        // must outlive the profiler, string literals are expected here
+        const char *Name = nullptr;
+        uint64_t BeginNs = 0;
+        uint64_t EndNs = 0;
+        uint32_t Depth = 0;
+    };
+
+    export struct ThreadCapture {
+        uint32_t ThreadId = 0;
+        std::string ThreadName;
+        std::vector<ZoneEvent> Events;
+    };
+
+    export uint64_t Now() {
+        static const auto epoch = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    // Single producer ring owned by one thread, readers never block the owner. Old events are overwritten.
+    class ThreadRingBuffer {
+    public:
+        constexpr static size_t Capacity = 1 << 14;
+
+        explicit ThreadRingBuffer(uint32_t threadId) : m_ThreadId(threadId) {}
+
+        void Push(const char *name, uint64_t beginNs, uint64_t endNs, uint32_t depth) {
+            if (!m_Slots) {
+                // allocated on first use so idle threads cost nothing, published by the release store below
+                m_Slots = std::make_unique<Slot[]>(Capacity);
+            }
+
+            uint64_t head = m_Head.load(std::memory_order_relaxed);
+            auto &slot = m_Slots[head & (Capacity - 1)];
+            slot.Name.store(name, std::memory_order_relaxed);
+            slot.BeginNs.store(beginNs, std::memory_order_relaxed);
+            slot.EndNs.store(endNs, std::memory_order_relaxed);
+            slot.Depth.store(depth, std::memory_order_relaxed);
+            m_Head.store(head + 1, std::memory_order_release);
+        }
+
+        ThreadCapture Snapshot() const {
+            ThreadCapture capture{.ThreadId = m_ThreadId, .ThreadName = GetName(), .Events = {}};
+
+            uint64_t head = m_Head.load(std::memory_order_acquire);
+            if (head == 0) return capture;
+
+            uint64_t begin = head > Capacity ? head - Capacity : 0;
+            capture.Events.reserve(head - begin);
+            for (uint64_t i = begin; i < head; i++) {
+                const auto &slot = m_Slots[i & (Capacity - 1)];
+                capture.Events.push_back(ZoneEvent{
+                    .Name = slot.Name.load(std::memory_order_relaxed),
+                    .BeginNs = slot.BeginNs.load(std::memory_order_relaxed),
+                    .EndNs = slot.EndNs.load(std::memory_order_relaxed),
+                    .Depth = slot.Depth.load(std::memory_order_relaxed)
+                });
+            }
+
+            // anything the owner may have overwritten while we were copying is dropped
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t headAfter = m_Head.load(std::memory_order_relaxed);
+            uint64_t firstValid = headAfter >= Capacity ? headAfter - Capacity + 1 : 0;
+            if (firstValid > begin) {
+                auto discard = std::min<uint64_t>(firstValid - begin, capture.Events.size());
+                capture.Events.erase(capture.Events.begin(), capture.Events.begin() + static_cast<ptrdiff_t>(discard));
+            }
+
+            return capture;
+        }
+
+        void SetName(std::string name) {
+            std::lock_guard lock(m_NameMutex);
+            m_Name = std::move(name);
+        }
+
+        std::string GetName() const {
+            std::lock_guard lock(m_NameMutex);
+            return m_Name.empty() ? std::format("Thread {}", m_ThreadId) : m_Name;
+        }
+
+    private:
+        struct Slot {
+            std::atomic<const char *> Name{nullptr};
+            std::atomic<uint64_t> BeginNs{0};
+            std::atomic<uint64_t> EndNs{0};
+            std::atomic<uint32_t> Depth{0};
+        };
+
+        uint32_t m_ThreadId;
+        std::unique_ptr<Slot[]> m_Slots;
+        std::atomic<uint64_t> m_Head{0};
+
+        mutable std::mutex m_NameMutex;
+        std::string m_Name;
+    };
+
+    class Registry {
+    public:
+        static Registry &Get() {
+            static Registry registry;
+            return registry;
+        }
+
+        // only taken once per thread and by readers, recording itself is lock free
+        std::shared_ptr<ThreadRingBuffer> Register() {
+            std::lock_guard lock(m_Mutex);
+            auto buffer = std::make_shared<ThreadRingBuffer>(static_cast<uint32_t>(m_Buffers.size() + 1));
+            m_Buffers.push_back(buffer);
+            return buffer;
+        }
+
+        std::vector<ThreadCapture> Capture() {
+            std::vector<std::shared_ptr<ThreadRingBuffer>> buffers;
+            {
+                std::lock_guard lock(m_Mutex);
+                buffers = m_Buffers;
+            }
+
+            std::vector<ThreadCapture> captures;
+            captures.reserve(buffers.size());
+            for (const auto &buffer: buffers) {
+                captures.push_back(buffer->Snapshot());
+            }
+            return captures;
+        }
+
+        std::atomic_bool Enabled{false};
+
+    private:
+        std::mutex m_Mutex;
+        std::vector<std::shared_ptr<ThreadRingBuffer>> m_Buffers;
+    };
+
+    ThreadRingBuffer &LocalBuffer() {
+        // the registry keeps the buffer alive after the thread exits so its events can still be exported
+        thread_local std::shared_ptr<ThreadRingBuffer> buffer = Registry::Get().Register();
+        return *buffer;
+    }
+
+    thread_local uint32_t t_Depth = 0;
+
+    export void SetEnabled(bool enabled) {
+        Registry::Get().Enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    export bool IsEnabled() {
+        return Registry::Get().Enabled.load(std::memory_order_relaxed);
+    }
+
+    export void SetThreadName(std::string name) {
+        LocalBuffer().SetName(std::move(name));
+    }
+
+    // copies the recorded zones of every thread
+    export std::vector<ThreadCapture> Capture() {
+        return Registry::Get().Capture();
+    }
+
+    export class ScopedZone {
+    public:
+        explicit ScopedZone(const char *name) {
+            if (!IsEnabled()) return;
+
+            m_Name = name;
+            m_Depth = t_Depth++;
+            m_BeginNs = Now();
+        }
+
+        ScopedZone(const ScopedZone &) = delete;
+
+        ScopedZone &operator=(const ScopedZone &) = delete;
+
+        ~ScopedZone() {
+            if (!m_Name) return;
+
+            --t_Depth;
+            LocalBuffer().Push(m_Name, m_BeginNs, Now(), m_Depth);
+        }
+
+    private:
+        const char *m_Name = nullptr;
+        uint64_t m_BeginNs = 0;
+        uint32_t m_Depth = 0;
+    };
+
+    std::string EscapeJson(std::string_view text) {
+        std::string escaped;
+        escaped.reserve(text.size());
+        for (char c: text) {
+            switch (c) {
+                case '"': escaped += "\\\"";
+                    break;
+                case '\\': escaped += "\\\\";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) >= 0x20) escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    // Chrome trace event format, loads in chrome://tracing and ui.perfetto.dev
+    export void WriteChromeTrace(std::ostream &os, const std::vector<ThreadCapture> &captures) {
+        os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        auto separator = [&] {
+            if (!first) os << ",\n";
+            first = false;
+        };
+
+        for (const auto &capture: captures) {
+            separator();
+            os << std::format(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"{}"}}}})",
+                              capture.ThreadId, EscapeJson(capture.ThreadName));
+
+            for (const auto &event: capture.Events) {
+                separator();
+                os << std::format(R"({{"name":"{}","ph":"X","pid":1,"tid":{},"ts":{:.3f},"dur":{:.3f}}})",
+                                  EscapeJson(event.Name ? event.Name : "?"), capture.ThreadId,
+                                  static_cast<double>(event.BeginNs) / 1000.0,
+                                  static_cast<double>(event.EndNs - event.BeginNs) / 1000.0);
+            }
+        }
+
+        os << "\n]}\n";
+    }
+
+    export bool WriteChromeTrace(const std::filesystem::path &path) {
+        std::ofstream file(path);
+        if (!file) {
+            return false;
+        }
+        WriteChromeTrace(file, Capture());
+        return static_cast<bool>(file);
+    }
+
+    export struct StartupStep {
+        const char *Name = nullptr;
+        // relative to the creation of the timeline
+        double StartMs = 0.0;
+        double DurationMs = 0.0;
+        // false for steps that ran on a worker thread alongside the main thread
+        bool MainThread = true;
+    };
+
+    // Wall time of each step of application startup, thread safe. Steps are also recorded as profiler zones.
+    export class StartupTimeline {
+    public:
+        StartupTimeline() : m_StartNs(Now()), m_MainThread(std::this_thread::get_id()) {}
+
+        // measures its own lifetime, a null timeline only records the profiler zone
+        class Scope {
+        public:
+            Scope(StartupTimeline *timeline, const char *name)
+                : m_Timeline(timeline), m_Name(name), m_Zone(name), m_BeginNs(Now()) {}
+
+            Scope(const Scope &) = delete;
+
+            Scope &operator=(const Scope &) = delete;
+
+            ~Scope() {
+                if (m_Timeline) {
+                    m_Timeline->Record(m_Name, m_BeginNs, Now());
+                }
+            }
+
+        private:
+            StartupTimeline *m_Timeline;
+            const char *m_Name;
+            ScopedZone m_Zone;
+            uint64_t m_BeginNs;
+        };
+
+        // name must be a string with static storage duration, times come from Profiling::Now()
+        void Record(const char *name, uint64_t beginNs, uint64_t endNs) {
+            std::lock_guard lock(m_Mutex);
+            m_Steps.push_back(StartupStep{
+                .Name = name,
+                .StartMs = static_cast<double>(beginNs - m_StartNs) / 1e6,
+                .DurationMs = static_cast<double>(endNs - beginNs) / 1e6,
+                .MainThread = std::this_thread::get_id() == m_MainThread
+            });
+        }
+
+        // ordered by start time
+        [[nodiscard]] std::vector<StartupStep> GetSteps() const {
+            std::lock_guard lock(m_Mutex);
+            auto steps = m_Steps;
+            std::ranges::sort(steps, {}, &StartupStep::StartMs);
+            return steps;
+        }
+
+        // until the end of the last step
+        [[nodiscard]] double GetTotalMilliseconds() const {
+            double total = 0.0;
+            for (const auto &step: GetSteps()) {
+                total = std::max(total, step.StartMs + step.DurationMs);
+            }
+            return total;
+        }
+
+        [[nodiscard]] std::string Format() const {
+            std::string report = std::format("startup: {:.1f} ms\n", GetTotalMilliseconds());
+            for (const auto &step: GetSteps()) {
+                report += std::format("  {:8.1f} ms  {:8.1f} ms  {:<6}  {}\n",
+                                      step.StartMs, step.DurationMs, step.MainThread ? "main" : "worker", step.Name);
+            }
+            return report;
+        }
+
+    private:
+        uint64_t m_StartNs;
+        std::thread::id m_MainThread;
+        mutable std::mutex m_Mutex;
+        std::vector<StartupStep> m_Steps;
+    };
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#define EASYGUI_PROFILE_CONCAT_IMPL(a, b) a##b
+#define EASYGUI_PROFILE_CONCAT(a, b) EASYGUI_PROFILE_CONCAT_IMPL(a, b)
+
+// name must be a string with static storage duration, e.g. a literal
+#define EASYGUI_PROFILE_ZONE(name) ::EasyGui::Profiling::ScopedZone EASYGUI_PROFILE_CONCAT(_profileZone, __LINE__){name}
@@ -0,0 +1,291 @@
+export module EasyGui.Tools.Task;
+
+import std;
+
+namespace EasyGui {
+    namespace TaskSlabDetail {
+        constexpr size_t s_SizeClassCount = 4;
+        constexpr std::array<size_t, s_SizeClassCount> s_ClassSizes{64, 128, 256, 512};
+        constexpr size_t s_BatchSize = 64;
+        constexpr size_t s_ChunkSize = 64 << 10;
+
+        struct FreeNode {
+            FreeNode *Next;
+        };
+
+        struct FreeList {
+            FreeNode *Head = nullptr;
+            size_t Count = 0;
+        };
+
+        class SharedLists {
+        public:
+            FreeList TakeBatch(size_t sizeClass) {
+                std::lock_guard lock(m_Mutex);
+                auto &batches = m_Batches[sizeClass];
+                if (batches.empty()) {
+                    Carve(sizeClass);
+                }
+
+                FreeList batch = batches.back();
+                batches.pop_back();
+                return batch;
+            }
+
+            void GiveBatch(size_t sizeClass, FreeList batch) {
+                std::lock_guard lock(m_Mutex);
+                m_Batches[sizeClass].push_back(batch);
+            }
+
+        private:
+            // cuts a fresh chunk into batches of the size class, called with the mutex held
+            void Carve(size_t sizeClass) {
+                size_t nodeSize = s_ClassSizes[sizeClass];
+                auto *chunk = static_cast<std::byte *>(::operator new(s_ChunkSize, std::align_val_t{64}));
+
+                size_t nodeCount = s_ChunkSize / nodeSize;
+                for (size_t first = 0; first < nodeCount; first += s_BatchSize) {
+                    FreeList batch;
+                    for (size_t i = std::min(first + s_BatchSize, nodeCount); i-- > first;) {
+                        auto *node = reinterpret_cast<FreeNode *>(chunk + i * nodeSize);
+                        node->Next = batch.Head;
+                        batch.Head = node;
+                        batch.Count++;
+                    }
+                    m_Batches[sizeClass].push_back(batch);
+                }
+            }
+
+            std::mutex m_Mutex;
+            std::array<std::vector<FreeList>, s_SizeClassCount> m_Batches;
+        };
+
+        // never destroyed, thread caches may give their nodes back during static destruction
+        inline SharedLists &GetSharedLists() {
+            static auto *shared = new SharedLists();
+            return *shared;
+        }
+
+        struct ThreadCache {
+            ThreadCache() = default;
+
+            ThreadCache(const ThreadCache &) = delete;
+
+            ThreadCache &operator=(const ThreadCache &) = delete;
+
+            // whatever a finished thread still holds goes back to the shared lists
+            ~ThreadCache() {
+                for (size_t sizeClass = 0; sizeClass < s_SizeClassCount; sizeClass++) {
+                    if (Lists[sizeClass].Head) {
+                        GetSharedLists().GiveBatch(sizeClass, Lists[sizeClass]);
+                    }
+                }
+            }
+
+            std::array<FreeList, s_SizeClassCount> Lists;
+        };
+
+        inline thread_local ThreadCache t_Cache;
+
+        inline size_t GetSizeClass(size_t size, size_t alignment) {
+            if (alignment > 64) return s_SizeClassCount;
+
+            for (size_t sizeClass = 0; sizeClass < s_SizeClassCount; sizeClass++) {
+                if (size <= s_ClassSizes[sizeClass]) return sizeClass;
+            }
+            return s_SizeClassCount;
+        }
+
+        // takes s_BatchSize nodes off the front of the list
+        inline FreeList SplitBatch(FreeList &list) {
+            FreeList batch{.Head = list.Head, .Count = s_BatchSize};
+            FreeNode *last = list.Head;
+            for (size_t i = 1; i < s_BatchSize; i++) {
+                last = last->Next;
+            }
+            list.Head = last->Next;
+            list.Count -= s_BatchSize;
+            last->Next = nullptr;
+            return batch;
+        }
+    }
+
+    // Size class allocator for task nodes and the shared state of their futures.
+    //
+    // Tasks are usually allocated on one thread and freed on another, so every thread keeps a free list per size
+    // class and trades whole batches with a shared list, taking its lock once per batch. Memory is carved from 64 KB
+    // chunks that are never returned to the system, the slab only grows to the peak number of tasks in flight.
+    // Larger or over-aligned requests go to the global heap.
+    export class TaskSlab {
+    public:
+        constexpr static size_t MaxSize = 512;
+
+        static void *Allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+            using namespace TaskSlabDetail;
+            size_t sizeClass = GetSizeClass(size, alignment);
+            if (sizeClass == s_SizeClassCount) {
+                return ::operator new(size, std::align_val_t{alignment});
+            }
+
+            FreeList &list = t_Cache.Lists[sizeClass];
+            if (!list.Head) {
+                list = GetSharedLists().TakeBatch(sizeClass);
+            }
+
+            FreeNode *node = list.Head;
+            list.Head = node->Next;
+            list.Count--;
+            return node;
+        }
+
+        static void Deallocate(void *pointer, size_t size, size_t alignment = alignof(std::max_align_t)) noexcept {
+            using namespace TaskSlabDetail;
+            size_t sizeClass = GetSizeClass(size, alignment);
+            if (sizeClass == s_SizeClassCount) {
+                ::operator delete(pointer, std::align_val_t{alignment});
+                return;
+            }
+
+            FreeList &list = t_Cache.Lists[sizeClass];
+            auto *node = static_cast<FreeNode *>(pointer);
+            node->Next = list.Head;
+            list.Head = node;
+            // threads that only free, the workers, hand batches back for the threads that only allocate
+            if (++list.Count >= 2 * s_BatchSize) {
+                GetSharedLists().GiveBatch(sizeClass, SplitBatch(list));
+            }
+        }
+    };
+
+    // standard allocator on top of the task slab, e.g. for the shared state of a std::promise
+    export template<typename T>
+    struct SlabAllocator {
+        using value_type = T;
+
+        SlabAllocator() = default;
+
+        template<typename U>
+        SlabAllocator(const SlabAllocator<U> &) noexcept {}
+
+        T *allocate(size_t count) {
+            return static_cast<T *>(TaskSlab::Allocate(count * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T *pointer, size_t count) noexcept {
+            TaskSlab::Deallocate(pointer, count * sizeof(T), alignof(T));
+        }
+
+        template<typename U>
+        bool operator==(const SlabAllocator<U> &) const noexcept { return true; }
+    };
+
+    // Move-only callable for the thread pools. Callables up to InlineSize bytes live inside the task, larger ones in
+    // the task slab, so building a task never touches the global heap for captures below TaskSlab::MaxSize.
+    export class Task {
+    public:
+        constexpr static size_t InlineSize = 64 - sizeof(void *);
+
+        Task() = default;
+
+        template<typename Function>
+            requires (!std::same_as<std::decay_t<Function>, Task> && std::invocable<std::decay_t<Function> &>)
+        Task(Function &&function) {
+            using Stored = std::decay_t<Function>;
+            if constexpr (IsInline<Stored>()) {
+                new(m_Storage) Stored(std::forward<Function>(function));
+                m_Operations = &s_InlineOperations<Stored>;
+            } else {
+                void *memory = TaskSlab::Allocate(sizeof(Stored), alignof(Stored));
+                auto *stored = new(memory) Stored(std::forward<Function>(function));
+                std::memcpy(m_Storage, &stored, sizeof(stored));
+                m_Operations = &s_SlabOperations<Stored>;
+            }
+        }
+
+        Task(const Task &) = delete;
+
+        Task &operator=(const Task &) = delete;
+
+        Task(Task &&other) noexcept {
+            MoveFrom(other);
+        }
+
+        Task &operator=(Task &&other) noexcept {
+            if (this != &other) {
+                Reset();
+                MoveFrom(other);
+            }
+            return *this;
+        }
+
+        ~Task() {
+            Reset();
+        }
+
+        void operator()() {
+            m_Operations->Invoke(m_Storage);
+        }
+
+        explicit operator bool() const {
+            return m_Operations != nullptr;
+        }
+
+    private:
+        struct Operations {
+            void (*Invoke)(void *storage);
+            void (*Relocate)(void *from, void *to) noexcept;
+            void (*Destroy)(void *storage) noexcept;
+        };
+
+        template<typename Stored>
+        constexpr static bool IsInline() {
+            return sizeof(Stored) <= InlineSize && alignof(Stored) <= alignof(std::max_align_t) &&
+                   std::is_nothrow_move_constructible_v<Stored>;
+        }
+
+        template<typename Stored>
+        static Stored *GetSlabPointer(void *storage) {
+            Stored *stored;
+            std::memcpy(&stored, storage, sizeof(stored));
+            return stored;
+        }
+
+        template<typename Stored>
+        constexpr static Operations s_InlineOperations{
+            .Invoke = [](void *storage) { (*std::launder(static_cast<Stored *>(storage)))(); },
+            .Relocate = [](void *from, void *to) noexcept {
+                auto *source = std::launder(static_cast<Stored *>(from));
+                new(to) Stored(std::move(*source));
+                source->~Stored();
+            },
+            .Destroy = [](void *storage) noexcept { std::launder(static_cast<Stored *>(storage))->~Stored(); }
+        };
+
+        template<typename Stored>
+        constexpr static Operations s_SlabOperations{
+            .Invoke = [](void *storage) { (*GetSlabPointer<Stored>(storage))(); },
+            .Relocate = [](void *from, void *to) noexcept { std::memcpy(to, from, sizeof(Stored *)); },
+            .Destroy = [](void *storage) noexcept {
+                Stored *stored = GetSlabPointer<Stored>(storage);
+                stored->~Stored();
+                TaskSlab::Deallocate(stored, sizeof(Stored), alignof(Stored));
+            }
+        };
+
+        void MoveFrom(Task &other) noexcept {
+            m_Operations = std::exchange(other.m_Operations, nullptr);
+            if (m_Operations) {
+                m_Operations->Relocate(other.m_Storage, m_Storage);
+            }
+        }
+
+        void Reset() noexcept {
+            if (m_Operations) {
+                std::exchange(m_Operations, nullptr)->Destroy(m_Storage);
+            }
+        }
+
+        alignas(std::max_align_t) std::byte m_Storage[InlineSize];
+        const Operations *m_Operations = nullptr;
+    };
+}
@@ -0,0 +1,581 @@
+export module EasyGui.Tools.TaskGraph;
+
+import std;
+import EasyGui.Tools.ThreadPool;
+
+// Non-blocking composition of thread pool tasks.
+//
+// A TaskFuture is completed by a pool task and runs its continuations on the completing thread, continuations added
+// with Then enqueue the next task from there, so a chain of stages never has a worker waiting on a future. WhenAll
+// and WhenAny join futures the same way. TaskGraph covers fixed dependency structures that are run repeatedly, a
+// node is enqueued once its last predecessor finished, and a node with a single ready successor runs it right away on
+// the same worker.
+namespace EasyGui {
+    export template<typename T>
+    class TaskFuture;
+
+    namespace TaskGraphDetail {
+        // void results are stored as monostate
+        template<typename T>
+        using Stored = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+        template<typename T>
+        class State {
+        public:
+            explicit State(IThreadPool *pool) : Pool(pool) {}
+
+            State(const State &) = delete;
+
+            State &operator=(const State &) = delete;
+
+            void SetValue(Stored<T> &&value) {
+                Complete([&] { m_Value.emplace(std::move(value)); });
+            }
+
+            void SetException(std::exception_ptr exception) {
+                Complete([&] { m_Exception = std::move(exception); });
+            }
+
+            // runs the callback on the thread that completes the state, or right away if it is complete already
+            void OnReady(Task &&callback) {
+                {
+                    std::lock_guard lock(m_Mutex);
+                    if (!m_Ready.load(std::memory_order_relaxed)) {
+                        m_Callbacks.push_back(std::move(callback));
+                        return;
+                    }
+                }
+                callback();
+            }
+
+            [[nodiscard]] bool IsReady() const {
+                return m_Ready.load(std::memory_order_acquire);
+            }
+
+            void Wait() const {
+                m_Ready.wait(false, std::memory_order_acquire);
+            }
+
+            // complete states only
+            [[nodiscard]] std::exception_ptr GetException() const {
+                return m_Exception;
+            }
+
+            // complete states only, at most once
+            Stored<T> TakeValue() {
+                if (m_Exception) std::rethrow_exception(m_Exception);
+                return std::move(*m_Value);
+            }
+
+            // where continuations run
+            IThreadPool *Pool;
+
+        private:
+            template<typename Setter>
+            void Complete(Setter &&setter) {
+                std::vector<Task> callbacks;
+                {
+                    std::lock_guard lock(m_Mutex);
+                    setter();
+                    m_Ready.store(true, std::memory_order_release);
+                    callbacks.swap(m_Callbacks);
+                }
+                m_Ready.notify_all();
+
+                for (Task &callback: callbacks) {
+                    callback();
+                }
+            }
+
+            std::mutex m_Mutex;
+            std::atomic_bool m_Ready{false};
+            std::optional<Stored<T>> m_Value;
+            std::exception_ptr m_Exception;
+            std::vector<Task> m_Callbacks;
+        };
+
+        template<typename T>
+        using StatePtr = std::shared_ptr<State<T>>;
+
+        struct Access {
+            template<typename T>
+            static StatePtr<T> Take(TaskFuture<T> &future) {
+                if (!future.m_State) throw std::runtime_error("TaskFuture has no state.");
+                return std::exchange(future.m_State, nullptr);
+            }
+
+            template<typename T>
+            static TaskFuture<T> Make(StatePtr<T> state) {
+                return TaskFuture<T>(std::move(state));
+            }
+        };
+
+        // runs the function and completes the state with its result
+        template<typename T, typename Function>
+        void Fulfil(State<T> &state, Function &function) {
+            std::optional<Stored<T>> value;
+            try {
+                if constexpr (std::is_void_v<T>) {
+                    function();
+                    value.emplace();
+                } else {
+                    value.emplace(function());
+                }
+            } catch (...) {
+                state.SetException(std::current_exception());
+                return;
+            }
+            // outside the try, the continuations run in here
+            state.SetValue(std::move(*value));
+        }
+
+        // enqueues the function, the state fails with TaskCancelledError if the token is cancelled before it starts
+        template<typename T, typename Function>
+        void Schedule(StatePtr<T> state, const TaskOptions &options, Function &&function) {
+            IThreadPool *pool = state->Pool;
+            pool->EnqueueDetached(TaskOptions{.priority = options.priority},
+                                  [state = std::move(state), token = options.token,
+                                      function = std::forward<Function>(function)]() mutable {
+                                      if (token.IsCancelled()) {
+                                          state->SetException(std::make_exception_ptr(TaskCancelledError()));
+                                          return;
+                                      }
+                                      Fulfil(*state, function);
+                                  });
+        }
+
+        // the first exception of a join wins
+        struct JoinError {
+            void Set(std::exception_ptr exception) {
+                std::lock_guard lock(Mutex);
+                if (!Exception) Exception = std::move(exception);
+            }
+
+            std::mutex Mutex;
+            std::exception_ptr Exception;
+        };
+    }
+
+    // Move-only handle to the result of a pool task, like std::future but with continuations. Then, WhenAll and
+    // WhenAny consume the futures they are given. Wait and Get block, inside pool tasks prefer a continuation.
+    export template<typename T>
+    class TaskFuture {
+    public:
+        using value_type = T;
+
+        TaskFuture() = default;
+
+        TaskFuture(const TaskFuture &) = delete;
+
+        TaskFuture &operator=(const TaskFuture &) = delete;
+
+        TaskFuture(TaskFuture &&) noexcept = default;
+
+        TaskFuture &operator=(TaskFuture &&) noexcept = default;
+
+        // false for default constructed and consumed futures
+        [[nodiscard]] bool IsValid() const {
+            return m_State != nullptr;
+        }
+
+        [[nodiscard]] bool IsReady() const {
+            return m_State && m_State->IsReady();
+        }
+
+        void Wait() const {
+            if (m_State) m_State->Wait();
+        }
+
+        // waits, then returns the result or rethrows the exception of the task, consumes the future
+        T Get() {
+            auto state = TaskGraphDetail::Access::Take(*this);
+            state->Wait();
+            if constexpr (std::is_void_v<T>) {
+                state->TakeValue();
+            } else {
+                return state->TakeValue();
+            }
+        }
+
+        template<typename Function>
+        auto Then(Function &&function) {
+            return Then(TaskOptions{}, std::forward<Function>(function));
+        }
+
+        // Enqueues the function with the result once this future is ready, the function takes no arguments for
+        // void futures. An exception skips the function and is passed on to the returned future. Consumes the
+        // future.
+        template<typename Function>
+        auto Then(const TaskOptions &options, Function &&function) {
+            using namespace TaskGraphDetail;
+            using Result = std::remove_cvref_t<decltype(Invoke(function, std::declval<StatePtr<T> &>()))>;
+
+            StatePtr<T> source = Access::Take(*this);
+            auto next = std::make_shared<State<Result>>(source->Pool);
+            source->OnReady(Task([source, next, options, function = std::forward<Function>(function)]() mutable {
+                if (auto exception = source->GetException()) {
+                    next->SetException(std::move(exception));
+                    return;
+                }
+
+                Schedule(next, options, [source = std::move(source), function = std::move(function)]() mutable {
+                    return Invoke(function, source);
+                });
+            }));
+            return Access::Make(std::move(next));
+        }
+
+    private:
+        friend struct TaskGraphDetail::Access;
+
+        explicit TaskFuture(TaskGraphDetail::StatePtr<T> state) : m_State(std::move(state)) {}
+
+        template<typename Function>
+        static decltype(auto) Invoke(Function &function, const TaskGraphDetail::StatePtr<T> &source) {
+            if constexpr (std::is_void_v<T>) {
+                return std::invoke(function);
+            } else {
+                return std::invoke(function, source->TakeValue());
+            }
+        }
+
+        TaskGraphDetail::StatePtr<T> m_State;
+    };
+
+    // enqueues the function and returns a future for its result
+    export template<typename Function> requires std::invocable<Function>
+    auto Spawn(IThreadPool *pool, const TaskOptions &options, Function &&function) {
+        using namespace TaskGraphDetail;
+        using Result = std::invoke_result_t<Function>;
+
+        auto state = std::make_shared<State<Result>>(pool);
+        Schedule(state, options, std::forward<Function>(function));
+        return Access::Make(std::move(state));
+    }
+
+    export template<typename Function> requires std::invocable<Function>
+    auto Spawn(IThreadPool *pool, Function &&function) {
+        return Spawn(pool, TaskOptions{}, std::forward<Function>(function));
+    }
+
+    export template<typename Function> requires std::invocable<Function>
+    auto Spawn(Function &&function) {
+        return Spawn(GlobalThreadPool(), TaskOptions{}, std::forward<Function>(function));
+    }
+
+    // A future that is ready once every future is, with the results in the order of the futures, or the first
+    // exception. Continuations run on the pool of the first future.
+    export template<typename T>
+    auto WhenAll(std::vector<TaskFuture<T>> futures) {
+        using namespace TaskGraphDetail;
+        using Result = std::conditional_t<std::is_void_v<T>, void, std::vector<T>>;
+
+        struct Join : JoinError {
+            explicit Join(size_t count) : Remaining(count), Values(std::is_void_v<T> ? 0 : count) {}
+
+            std::atomic<size_t> Remaining;
+            std::vector<std::optional<Stored<T>>> Values;
+        };
+
+        std::vector<StatePtr<T>> states;
+        states.reserve(futures.size());
+        for (auto &future: futures) {
+            states.push_back(Access::Take(future));
+        }
+
+        auto output = std::make_shared<State<Result>>(states.empty() ? GlobalThreadPool() : states.front()->Pool);
+        if (states.empty()) {
+            output->SetValue({});
+            return Access::Make(std::move(output));
+        }
+
+        auto join = std::make_shared<Join>(states.size());
+        for (size_t i = 0; i < states.size(); i++) {
+            states[i]->OnReady(Task([join, output, state = states[i], i] {
+                if (auto exception = state->GetException()) {
+                    join->Set(std::move(exception));
+                } else if constexpr (!std::is_void_v<T>) {
+                    join->Values[i].emplace(state->TakeValue());
+                }
+
+                // the last one sees the values of all others
+                if (join->Remaining.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+                if (join->Exception) {
+                    output->SetException(join->Exception);
+                } else if constexpr (std::is_void_v<T>) {
+                    output->SetValue({});
+                } else {
+                    std::vector<T> values;
+                    values.reserve(join->Values.size());
+                    for (auto &value: join->Values) {
+                        values.push_back(std::move(*value));
+                    }
+                    output->SetValue(std::move(values));
+                }
+            }));
+        }
+        return Access::Make(std::move(output));
+    }
+
+    // WhenAll over futures of different types, void results become std::monostate in the tuple
+    export template<typename... Ts> requires (sizeof...(Ts) > 0)
+    auto WhenAll(TaskFuture<Ts>... futures) {
+        using namespace TaskGraphDetail;
+        using Result = std::tuple<Stored<Ts>...>;
+
+        struct Join : JoinError {
+            std::atomic<size_t> Remaining{sizeof...(Ts)};
+            std::tuple<std::optional<Stored<Ts>>...> Values;
+        };
+
+        std::tuple<StatePtr<Ts>...> states{Access::Take(futures)...};
+        auto output = std::make_shared<State<Result>>(std::get<0>(states)->Pool);
+        auto join = std::make_shared<Join>();
+
+        auto finish = [join, output] {
+            if (join->Exception) {
+                output->SetException(join->Exception);
+                return;
+            }
+            output->SetValue(std::apply([](auto &... values) { return Result{std::move(*values)...}; },
+                                        join->Values));
+        };
+
+        [&]<size_t... Is>(std::index_sequence<Is...>) {
+            (std::get<Is>(states)->OnReady(Task([join, finish, state = std::get<Is>(states)] {
+                if (auto exception = state->GetException()) {
+                    join->Set(std::move(exception));
+                } else {
+                    std::get<Is>(join->Values).emplace(state->TakeValue());
+                }
+
+                if (join->Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    finish();
+                }
+            })), ...);
+        }(std::index_sequence_for<Ts...>{});
+        return Access::Make(std::move(output));
+    }
+
+    export template<typename T>
+    struct WhenAnyResult {
+        // position of the future that finished first
+        size_t Index;
+        T Value;
+    };
+
+    template<>
+    struct WhenAnyResult<void> {
+        size_t Index;
+    };
+
+    // A future that is ready as soon as the first of the futures is, with its position and result or its exception.
+    // The other results are dropped once they arrive.
+    export template<typename T>
+    TaskFuture<WhenAnyResult<T>> WhenAny(std::vector<TaskFuture<T>> futures) {
+        using namespace TaskGraphDetail;
+
+        if (futures.empty()) throw std::runtime_error("WhenAny needs at least one future.");
+
+        std::vector<StatePtr<T>> states;
+        states.reserve(futures.size());
+        for (auto &future: futures) {
+            states.push_back(Access::Take(future));
+        }
+
+        auto output = std::make_shared<State<WhenAnyResult<T>>>(states.front()->Pool);
+        auto decided = std::make_shared<std::atomic_bool>(false);
+        for (size_t i = 0; i < states.size(); i++) {
+            states[i]->OnReady(Task([decided, output, state = states[i], i] {
+                if (decided->exchange(true, std::memory_order_acq_rel)) return;
+
+                if (auto exception = state->GetException()) {
+                    output->SetException(std::move(exception));
+                } else if constexpr (std::is_void_v<T>) {
+                    output->SetValue({.Index = i});
+                } else {
+                    output->SetValue({.Index = i, .Value = state->TakeValue()});
+                }
+            }));
+        }
+        return Access::Make(std::move(output));
+    }
+
+    // Tasks with explicit dependency edges, built once and run any number of times, one run at a time.
+    //
+    // Every run starts the nodes without predecessors and enqueues a node once all of its predecessors finished.
+    // After an exception, or once the token of the run is cancelled, the remaining nodes are skipped and the future
+    // of the run fails with that exception. The graph must not change while running, destroying it waits for the run.
+    export class TaskGraph {
+    public:
+        struct Node {
+            size_t Index;
+        };
+
+        TaskGraph() = default;
+
+        TaskGraph(const TaskGraph &) = delete;
+
+        TaskGraph &operator=(const TaskGraph &) = delete;
+
+        ~TaskGraph() {
+            Wait();
+        }
+
+        template<typename Function> requires std::invocable<Function &>
+        Node Add(Function &&function) {
+            ThrowIfRunning();
+            m_Nodes.push_back({.Function = Task(std::forward<Function>(function))});
+            m_Validated = false;
+            return {m_Nodes.size() - 1};
+        }
+
+        // after only starts once before has finished
+        void Precede(Node before, Node after) {
+            ThrowIfRunning();
+            if (before.Index >= m_Nodes.size() || after.Index >= m_Nodes.size()) {
+                throw std::runtime_error("TaskGraph node does not belong to this graph.");
+            }
+
+            m_Nodes[before.Index].Successors.push_back(after.Index);
+            m_Nodes[after.Index].PredecessorCount++;
+            m_Validated = false;
+        }
+
+        // throws if the graph has a cycle
+        TaskFuture<void> Run(IThreadPool *pool = GlobalThreadPool(), const TaskOptions &options = {}) {
+            using namespace TaskGraphDetail;
+
+            ThrowIfRunning();
+            Validate();
+
+            m_Pool = pool;
+            m_Options = options;
+            m_Failed.store(false, std::memory_order_relaxed);
+            m_Error.Exception = nullptr;
+            m_Done = std::make_shared<State<void>>(pool);
+            if (m_Nodes.empty()) {
+                m_Done->SetValue({});
+                return Access::Make(m_Done);
+            }
+
+            for (size_t i = 0; i < m_Nodes.size(); i++) {
+                m_Pending[i].store(m_Nodes[i].PredecessorCount, std::memory_order_relaxed);
+            }
+            m_Remaining.store(m_Nodes.size(), std::memory_order_relaxed);
+
+            // the release in EnqueueDetached publishes the counters to the workers
+            for (size_t i = 0; i < m_Nodes.size(); i++) {
+                if (m_Nodes[i].PredecessorCount == 0) Enqueue(i);
+            }
+            return Access::Make(m_Done);
+        }
+
+        [[nodiscard]] bool IsRunning() const {
+            return m_Done && !m_Done->IsReady();
+        }
+
+        // blocks until the current run finished
+        void Wait() const {
+            if (m_Done) m_Done->Wait();
+        }
+
+    private:
+        struct NodeData {
+            Task Function;
+            std::vector<size_t> Successors;
+            size_t PredecessorCount = 0;
+        };
+
+        void ThrowIfRunning() const {
+            if (IsRunning()) throw std::runtime_error("TaskGraph is running.");
+        }
+
+        // checks for cycles with Kahn's algorithm and sizes the counters, once per change of the graph
+        void Validate() {
+            if (m_Validated) return;
+
+            std::vector<size_t> pending(m_Nodes.size());
+            std::vector<size_t> ready;
+            for (size_t i = 0; i < m_Nodes.size(); i++) {
+                pending[i] = m_Nodes[i].PredecessorCount;
+                if (pending[i] == 0) ready.push_back(i);
+            }
+
+            size_t visited = 0;
+            while (!ready.empty()) {
+                size_t index = ready.back();
+                ready.pop_back();
+                visited++;
+                for (size_t successor: m_Nodes[index].Successors) {
+                    if (--pending[successor] == 0) ready.push_back(successor);
+                }
+            }
+            if (visited != m_Nodes.size()) throw std::runtime_error("TaskGraph has a cycle.");
+
+            m_Pending = std::make_unique<std::atomic<size_t>[]>(m_Nodes.size());
+            m_Validated = true;
+        }
+
+        void Enqueue(size_t index) {
+            m_Pool->EnqueueDetached(TaskOptions{.priority = m_Options.priority}, [this, index] { Execute(index); });
+        }
+
+        void Execute(size_t index) {
+            constexpr size_t none = std::numeric_limits<size_t>::max();
+
+            while (index != none) {
+                if (!m_Failed.load(std::memory_order_relaxed)) {
+                    try {
+                        m_Options.token.ThrowIfCancelled();
+                        m_Nodes[index].Function();
+                    } catch (...) {
+                        m_Error.Set(std::current_exception());
+                        m_Failed.store(true, std::memory_order_relaxed);
+                    }
+                }
+
+                // one ready successor continues on this thread, the others are enqueued
+                size_t next = none;
+                for (size_t successor: m_Nodes[index].Successors) {
+                    if (m_Pending[successor].fetch_sub(1, std::memory_order_acq_rel) != 1) continue;
+
+                    if (next == none) {
+                        next = successor;
+                    } else {
+                        Enqueue(successor);
+                    }
+                }
+
+                if (m_Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    Finish();
+                    return;
+                }
+                index = next;
+            }
+        }
+
+        void Finish() {
+            // the graph may be destroyed as soon as the run completes, keep the state alive past that
+            auto done = m_Done;
+            if (m_Error.Exception) {
+                done->SetException(m_Error.Exception);
+            } else {
+                done->SetValue({});
+            }
+        }
+
+        std::vector<NodeData> m_Nodes;
+        bool m_Validated = false;
+
+        // state of the current run
+        IThreadPool *m_Pool = nullptr;
+        TaskOptions m_Options;
+        std::unique_ptr<std::atomic<size_t>[]> m_Pending;
+        std::atomic<size_t> m_Remaining{0};
+        std::atomic_bool m_Failed{false};
+        TaskGraphDetail::JoinError m_Error;
+        TaskGraphDetail::StatePtr<void> m_Done;
+    };
+}
@@ -1,39 +1,94 @@
 export module EasyGui.Tools.ThreadPool;
 
 import std.compat;
+import EasyGui.Tools.Profiler;
+import EasyGui.Tools.LockFreeQueue;
+export import EasyGui.Tools.Task;
+export import EasyGui.Tools.Cancellation;
+
+import "EasyGui/Tools/PlatformDefines.hpp";
+import "EasyGui/Tools/ProfilerDefines.hpp";
 
 namespace EasyGui {
+    // Workers take queued tasks of a higher priority first, so background work only runs while nothing more urgent
+    // is queued. Running tasks are never interrupted.
+    export enum class TaskPriority : uint8_t {
+        // work the user is waiting for, e.g. the thumbnail that just scrolled into view
+        UiCritical,
+        Normal,
+        // bulk work like indexing a folder
+        Background
+    };
+
+    export constexpr size_t TaskPriorityCount = 3;
+
+    export struct TaskOptions {
+        TaskPriority priority = TaskPriority::Normal;
+        // a task whose token is cancelled before it starts is dropped, its future throws TaskCancelledError
+        CancellationToken token{};
+    };
+
     export class IThreadPool {
     public:
         virtual ~IThreadPool() = default;
 
+        [[nodiscard]] virtual size_t GetThreadCount() const = 0;
+
     protected:
-        virtual void EnqueueFunc(std::function<void()> &&task) = 0;
+        virtual void EnqueueTask(Task &&task, TaskPriority priority) = 0;
 
     public:
         template<typename... Args> requires std::invocable<Args...>
         void EnqueueDetached(Args &&... args) {
-            std::function<void()> task = [tup = std::make_tuple(std::forward<Args>(args)...)]() mutable {
-                std::apply([]<typename... Tps>(const auto &first, Tps &&... rest) {
-                    first(std::forward<Tps>(rest)...);
-                }, std::move(tup));
-            };
-            EnqueueFunc(std::move(task));
+            EnqueueDetached(TaskOptions{}, std::forward<Args>(args)...);
+        }
+
+        // a TaskCancelledError thrown by the task itself ends it quietly
+        template<typename... Args> requires std::invocable<Args...>
+        void EnqueueDetached(const TaskOptions &options, Args &&... args) {
+            EnqueueTask(Task([token = options.token, tup = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                if (token.IsCancelled()) return;
+
+                try {
+                    std::apply([](auto &&first, auto &&... rest) {
+                        first(std::forward<decltype(rest)>(rest)...);
+                    }, std::move(tup));
+                } catch (const TaskCancelledError &) {}
+            }), options.priority);
         }
 
         template<typename... Args> requires std::invocable<Args...>
         auto Enqueue(Args &&... args) {
+            return Enqueue(TaskOptions{}, std::forward<Args>(args)...);
+        }
+
+        // The shared state of the future comes from the task slab and small captures are stored inside the task,
+        // so a typical call does not touch the global heap.
+        template<typename... Args> requires std::invocable<Args...>
+        auto Enqueue(const TaskOptions &options, Args &&... args) {
             using ReturnType = std::invoke_result_t<Args...>;
-            auto task = std::make_shared<std::packaged_task<ReturnType()>>(
-                [tup = std::make_tuple(std::forward<Args>(args)...)]() mutable {
-                    return std::apply([]<typename... Tps>(auto &&first, Tps &&... rest) {
-                        return first(std::forward<Tps>(rest)...);
-                    }, std::move(tup));
-                });
+            std::promise<ReturnType> promise(std::allocator_arg, SlabAllocator<ReturnType>{});
+            std::future<ReturnType> future = promise.get_future();
 
-            std::future<ReturnType> res = task->get_future();
-            EnqueueFunc([task]() { (*task)(); });
-            return res;
+            EnqueueTask(Task([promise = std::move(promise), token = options.token,
+                              tup = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                try {
+                    token.ThrowIfCancelled();
+                    if constexpr (std::is_void_v<ReturnType>) {
+                        std::apply([](auto &&first, auto &&... rest) {
+                            first(std::forward<decltype(rest)>(rest)...);
+                        }, std::move(tup));
+                        promise.set_value();
+                    } else {
+                        promise.set_value(std::apply([](auto &&first, auto &&... rest) -> ReturnType {
+                            return first(std::forward<decltype(rest)>(rest)...);
+                        }, std::move(tup)));
+                    }
+                } catch (...) {
+                    promise.set_exception(std::current_exception());
+                }
+            }), options.priority);
+            return future;
         }
     };
 
@@ -42,34 +97,39 @@ namespace EasyGui {
         ThreadPool(size_t size = std::jthread::hardware_concurrency() * 2) {
             m_WorkerThreads.reserve(size);
             for (size_t i = 0; i < size; ++i) {
-                m_WorkerThreads.emplace_back([this] {
+                m_WorkerThreads.emplace_back([this, i] {
+                    Profiling::SetThreadName(std::format("Worker {}", i));
+
                     while (!m_ShouldStop) {
-                        std::function<void()> task;
+                        Task task;
 
                         // in a scope
                         {
                             std::unique_lock lock(m_Mutex);
-                            m_Condition.wait(lock, [this] { return m_ShouldStop || !m_Tasks.empty(); });
+                            m_Condition.wait(lock, [this] { return m_ShouldStop || HasTasks(); });
 
-                            if (m_ShouldStop && m_Tasks.empty()) {
+                            if (m_ShouldStop && !HasTasks()) {
                                 return;
                             }
 
-                            task = std::move(m_Tasks.front());
-                            m_Tasks.pop();
+                            // the first non-empty queue has the highest priority
+                            auto &tasks = *std::ranges::find_if(m_Tasks, [](auto &queue) { return !queue.empty(); });
+                            task = std::move(tasks.front());
+                            tasks.pop();
                         }
 
+                        EASYGUI_PROFILE_ZONE("ThreadPool::Task");
                         task();
                     }
                 });
             }
         }
 
-        void EnqueueFunc(std::function<void()> &&task) override {
+        void EnqueueTask(Task &&task, TaskPriority priority) override {
             // forward
             {
                 std::lock_guard lock(m_Mutex);
-                m_Tasks.emplace(std::move(task));
+                m_Tasks[std::to_underlying(priority)].emplace(std::move(task));
             }
             m_Condition.notify_one();
         }
@@ -89,6 +149,10 @@ namespace EasyGui {
             }
         }
 
+        [[nodiscard]] size_t GetThreadCount() const override {
+            return m_WorkerThreads.size();
+        }
+
         void DetachAll() {
             m_ShouldStop = true;
             m_Condition.notify_all();
@@ -101,15 +165,324 @@ namespace EasyGui {
         }
 
     private:
+        // called with the mutex held
+        [[nodiscard]] bool HasTasks() const {
+            return std::ranges::any_of(m_Tasks, [](auto &queue) { return !queue.empty(); });
+        }
+
         std::vector<std::jthread> m_WorkerThreads{};
         std::condition_variable m_Condition{};
         std::mutex m_Mutex{};
-        std::queue<std::function<void()>> m_Tasks{};
+        std::array<std::queue<Task>, TaskPriorityCount> m_Tasks{};
         std::atomic_bool m_ShouldStop{false};
     };
 
+    // Thread pool with one work-stealing deque per worker.
+    //
+    // Tasks enqueued by a worker go to its own deque, which it runs newest first while idle workers steal the oldest
+    // tasks of the others, so fanning out from inside a task never touches shared state. Tasks from other threads go
+    // through a bounded lock-free injection queue, a locked overflow queue takes over when it is full. Every priority
+    // has its own set of queues and a worker only looks at the next priority once all queues of the current one came
+    // up empty. Idle workers spin briefly and then park on an atomic wait until new work is announced. Tasks left at
+    // destruction still run.
+    export class WorkStealingThreadPool : public IThreadPool {
+    public:
+        [[nodiscard]] static size_t GetDefaultThreadCount() {
+            return std::max<size_t>(std::jthread::hardware_concurrency(), 1);
+        }
+
+        explicit WorkStealingThreadPool(size_t threadCount = GetDefaultThreadCount()) {
+            threadCount = std::max<size_t>(threadCount, 1);
+            m_Workers.reserve(threadCount);
+            for (size_t i = 0; i < threadCount; i++) {
+                m_Workers.push_back(std::make_unique<Worker>());
+            }
+            // every deque exists before the first worker starts stealing
+            for (size_t i = 0; i < threadCount; i++) {
+                m_Workers[i]->Thread = std::jthread([this, i] { Run(i); });
+            }
+        }
+
+        WorkStealingThreadPool(const WorkStealingThreadPool &) = delete;
+
+        WorkStealingThreadPool &operator=(const WorkStealingThreadPool &) = delete;
+
+        ~WorkStealingThreadPool() override {
+            m_ShouldStop.store(true);
+            m_WakeEpoch.fetch_add(1);
+            m_WakeEpoch.notify_all();
+            for (auto &worker: m_Workers) {
+                if (worker->Thread.joinable()) {
+                    worker->Thread.join();
+                }
+            }
+        }
+
+        [[nodiscard]] size_t GetThreadCount() const override {
+            return m_Workers.size();
+        }
+
+        // whether the calling thread is one of the workers of this pool
+        [[nodiscard]] bool IsWorkerThread() const {
+            return s_CurrentPool == this;
+        }
+
+    protected:
+        void EnqueueTask(Task &&task, TaskPriority priority) override {
+            size_t level = std::to_underlying(priority);
+            // the node comes from the task slab, the deques only move pointers around
+            auto *pending = new(TaskSlab::Allocate(sizeof(Task), alignof(Task))) Task(std::move(task));
+            if (s_CurrentPool == this) {
+                m_Workers[s_CurrentWorker]->Deques[level].Push(pending);
+            } else {
+                Shared &shared = m_Shared[level];
+                if (!shared.Injection.TryPush(std::move(pending))) {
+                    std::lock_guard lock(shared.OverflowMutex);
+                    shared.Overflow.push_back(pending);
+                    shared.OverflowSize.fetch_add(1);
+                }
+            }
+            Announce();
+        }
+
+    private:
+        using PendingTask = Task *;
+
+        struct Worker {
+            // one per priority
+            std::array<WorkStealingDeque<PendingTask>, TaskPriorityCount> Deques;
+            std::jthread Thread;
+        };
+
+        // the queues for tasks from other threads, one set per priority
+        struct Shared {
+            BoundedMpmcQueue<PendingTask> Injection{4096};
+
+            std::mutex OverflowMutex;
+            std::deque<PendingTask> Overflow;
+            std::atomic<size_t> OverflowSize{0};
+        };
+
+        // Wakes a parked worker, unless a worker is searching already, which either finds the task or sees it in its
+        // last look before parking. The seq_cst accesses pair with the ones in Search.
+        void Announce() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (m_Searching.load() > 0 || m_Sleepers.load() == 0) return;
+
+            // every announce bumps the epoch, a wake up that finds no parked worker is cheap and can not be lost
+            m_WakeEpoch.fetch_add(1);
+            m_WakeEpoch.notify_one();
+        }
+
+        PendingTask FindTask(size_t index) {
+            for (size_t level = 0; level < TaskPriorityCount; level++) {
+                if (PendingTask task = FindTask(index, level)) return task;
+            }
+            return nullptr;
+        }
+
+        PendingTask FindTask(size_t index, size_t level) {
+            if (auto task = m_Workers[index]->Deques[level].Pop()) return *task;
+
+            Shared &shared = m_Shared[level];
+            if (auto task = shared.Injection.TryPop()) return *task;
+
+            if (shared.OverflowSize.load(std::memory_order_relaxed) > 0) {
+                std::lock_guard lock(shared.OverflowMutex);
+                if (!shared.Overflow.empty()) {
+                    PendingTask task = shared.Overflow.front();
+                    shared.Overflow.pop_front();
+                    shared.OverflowSize.fetch_sub(1);
+                    return task;
+                }
+            }
+
+            // start at a random victim so thieves spread out
+            size_t count = m_Workers.size();
+            s_RandomState ^= s_RandomState << 13;
+            s_RandomState ^= s_RandomState >> 17;
+            s_RandomState ^= s_RandomState << 5;
+            size_t start = s_RandomState % count;
+            for (size_t i = 0; i < count; i++) {
+                size_t victim = (start + i) % count;
+                if (victim == index) continue;
+
+                // most deques of the lower priorities are empty, skip them without the fence in Steal
+                auto &deque = m_Workers[victim]->Deques[level];
+                if (deque.IsEmpty()) continue;
+
+                if (auto task = deque.Steal()) return *task;
+            }
+            return nullptr;
+        }
+
+        // any deque or shared queue of any priority
+        [[nodiscard]] bool HasQueuedTasks() const {
+            bool injected = std::ranges::any_of(m_Shared, [](const Shared &shared) {
+                return !shared.Injection.IsEmpty() || shared.OverflowSize.load(std::memory_order_relaxed) > 0;
+            });
+            return injected || std::ranges::any_of(m_Workers, [](const auto &worker) {
+                return std::ranges::any_of(worker->Deques, [](const auto &deque) { return !deque.IsEmpty(); });
+            });
+        }
+
+        // Spins for a while, tiny tasks come in bursts and parking right away would cost a wake up per task, then
+        // parks. Empty after a wake up or once the pool stops.
+        PendingTask Search(size_t index) {
+            constexpr int spinCount = 64;
+
+            m_Searching.fetch_add(1);
+            PendingTask task = nullptr;
+            for (int spin = 0; !task && spin < spinCount; spin++) {
+                EASYGUI_CPU_RELAX();
+                task = FindTask(index);
+            }
+
+            if (task) {
+                // enqueues skip the wake up while someone searches, so the last searcher passes it on, pushes to the
+                // deques of other workers included
+                if (m_Searching.fetch_sub(1) == 1 && m_Sleepers.load() > 0 && HasQueuedTasks()) {
+                    Announce();
+                }
+                return task;
+            }
+
+            // register as sleeper before the last look, so an enqueue either wakes this worker or is found
+            uint32_t epoch = m_WakeEpoch.load();
+            m_Sleepers.fetch_add(1);
+            m_Searching.fetch_sub(1);
+            // pairs with the fence in Announce, the relaxed emptiness checks in FindTask see every announced push
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            task = FindTask(index);
+            if (!task && !m_ShouldStop.load()) {
+                m_WakeEpoch.wait(epoch);
+            }
+            m_Sleepers.fetch_sub(1);
+            return task;
+        }
+
+        void Run(size_t index) {
+            s_CurrentPool = this;
+            s_CurrentWorker = index;
+            s_RandomState = static_cast<uint32_t>(index) * 2654435761u + 1;
+            Profiling::SetThreadName(std::format("Worker {}", index));
+
+            while (true) {
+                PendingTask task = FindTask(index);
+                if (!task) {
+                    task = Search(index);
+                    if (!task) {
+                        // stopping only once nothing is left to run
+                        if (m_ShouldStop.load()) return;
+                        continue;
+                    }
+                }
+
+                EASYGUI_PROFILE_ZONE("ThreadPool::Task");
+                (*task)();
+                task->~Task();
+                TaskSlab::Deallocate(task, sizeof(Task), alignof(Task));
+            }
+        }
+
+        std::vector<std::unique_ptr<Worker>> m_Workers;
+        std::array<Shared, TaskPriorityCount> m_Shared;
+
+        alignas(std::hardware_destructive_interference_size) std::atomic<uint32_t> m_WakeEpoch{0};
+        std::atomic<uint32_t> m_Sleepers{0};
+        std::atomic<uint32_t> m_Searching{0};
+        std::atomic_bool m_ShouldStop{false};
+
+        inline static thread_local WorkStealingThreadPool *s_CurrentPool = nullptr;
+        inline static thread_local size_t s_CurrentWorker = 0;
+        inline static thread_local uint32_t s_RandomState = 1;
+    };
+
+    std::atomic<size_t> s_GlobalThreadCount{0};
+
+    // Thread count of the pool GlobalThreadPool creates on first use, 0 uses the hardware concurrency.
+    // Has no effect once the pool exists.
+    export void SetGlobalThreadPoolSize(size_t threadCount) {
+        s_GlobalThreadCount.store(threadCount);
+    }
+
     export IThreadPool* GlobalThreadPool() {
-        static ThreadPool pool{};
+        static WorkStealingThreadPool pool{
+            s_GlobalThreadCount.load() ? s_GlobalThreadCount.load() : WorkStealingThreadPool::GetDefaultThreadCount()
+        };
         return &pool;
     }
+
+    // Tasks that belong together, e.g. everything one window or one job requested, enqueued with a shared priority
+    // and cancelled together. Destroying the group cancels it, so work for a closed window does not outlive it.
+    // Groups created from the token of another group are cancelled with it.
+    export class TaskGroup {
+    public:
+        explicit TaskGroup(IThreadPool *pool = GlobalThreadPool(), TaskPriority priority = TaskPriority::Normal,
+                           const CancellationToken &parent = {})
+            : m_Pool(pool), m_Priority(priority), m_Source(parent) {}
+
+        TaskGroup(const TaskGroup &) = delete;
+
+        TaskGroup &operator=(const TaskGroup &) = delete;
+
+        ~TaskGroup() {
+            Cancel();
+        }
+
+        template<typename... Args> requires std::invocable<Args...>
+        void EnqueueDetached(Args &&... args) {
+            m_Pool->EnqueueDetached(GetOptions(), std::forward<Args>(args)...);
+        }
+
+        template<typename... Args> requires std::invocable<Args...>
+        auto Enqueue(Args &&... args) {
+            return m_Pool->Enqueue(GetOptions(), std::forward<Args>(args)...);
+        }
+
+        // queued tasks of the group are dropped, running ones see it through their token
+        void Cancel() {
+            m_Source.Cancel();
+        }
+
+        [[nodiscard]] bool IsCancelled() const {
+            return m_Source.IsCancelled();
+        }
+
+        // for tasks to poll, and as parent of nested groups
+        [[nodiscard]] CancellationToken GetToken() const {
+            return m_Source.GetToken();
+        }
+
+    private:
+        [[nodiscard]] TaskOptions GetOptions() const {
+            return {.priority = m_Priority, .token = m_Source.GetToken()};
+        }
+
+        IThreadPool *m_Pool;
+        TaskPriority m_Priority;
+        CancellationSource m_Source;
+    };
+
+    // Waits for the futures that are still valid when it goes out of scope. Tasks that reference the stack or an
+    // object under construction are joined before an exception unwinds past them, futures taken with get() on the
+    // normal path are skipped.
+    export template<typename... Futures>
+    class WaitGuard {
+    public:
+        explicit WaitGuard(Futures &... futures) : m_Futures(futures...) {}
+
+        WaitGuard(const WaitGuard &) = delete;
+
+        WaitGuard &operator=(const WaitGuard &) = delete;
+
+        ~WaitGuard() {
+            std::apply([](auto &... futures) {
+                ((futures.valid() ? futures.wait() : void()), ...);
+            }, m_Futures);
+        }
+
+    private:
+        std::tuple<Futures &...> m_Futures;
+    };
 }
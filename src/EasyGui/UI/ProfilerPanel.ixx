@@ -0,0 +1,106 @@
+export module EasyGui.UI.ProfilerPanel;
+
+import EasyGui.Lib;
+import EasyGui.Tools.Profiler;
+import std.compat;
+
+namespace EasyGui::UI {
+    ImU32 ZoneColor(const char *name) {
+        // zones with the same name keep their color across frames
+        auto hash = static_cast<uint32_t>(std::hash<std::string_view>{}(name ? name : ""));
+        float hue = static_cast<float>(hash % 360) / 360.0f;
+        ImVec4 color;
+        ImGui::ColorConvertHSVtoRGB(hue, 0.55f, 0.8f, color.x, color.y, color.z);
+        color.w = 1.0f;
+        return ImGui::ColorConvertFloat4ToU32(color);
+    }
+
+    export struct ProfilerPanelState {
+        float WindowMs = 50.0f;
+        bool Paused = false;
+        std::vector<Profiling::ThreadCapture> Captures;
+        uint64_t CaptureEndNs = 0;
+        std::string TracePath = "trace.json";
+    };
+
+    // Live flame graph of the most recent zones of every thread, one lane per thread.
+    export void RenderProfilerPanel(ProfilerPanelState &state, bool *open = nullptr) {
+        if (!ImGui::Begin("Profiler", open)) {
+            ImGui::End();
+            return;
+        }
+
+        bool enabled = Profiling::IsEnabled();
+        if (ImGui::Checkbox("Enabled", &enabled)) {
+            Profiling::SetEnabled(enabled);
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Paused", &state.Paused);
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(160.0f);
+        ImGui::SliderFloat("Window (ms)", &state.WindowMs, 1.0f, 1000.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+
+        ImGui::SetNextItemWidth(240.0f);
+        ImGui::InputText("##TracePath", &state.TracePath);
+        ImGui::SameLine();
+        if (ImGui::Button("Export Chrome Trace")) {
+            Profiling::WriteChromeTrace(state.TracePath);
+        }
+
+        if (!state.Paused) {
+            state.Captures = Profiling::Capture();
+            state.CaptureEndNs = Profiling::Now();
+        }
+
+        auto windowNs = static_cast<uint64_t>(state.WindowMs * 1'000'000.0f);
+        uint64_t windowEnd = state.CaptureEndNs;
+        uint64_t windowBegin = windowEnd > windowNs ? windowEnd - windowNs : 0;
+
+        const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+
+        ImGui::BeginChild("FlameGraph", ImVec2{0.0f, 0.0f}, ImGuiChildFlags_Borders);
+        ImDrawList *drawList = ImGui::GetWindowDrawList();
+        const float width = ImGui::GetContentRegionAvail().x;
+
+        for (const auto &capture: state.Captures) {
+            uint32_t maxDepth = 0;
+            for (const auto &event: capture.Events) {
+                if (event.EndNs >= windowBegin && event.BeginNs <= windowEnd) {
+                    maxDepth = std::max(maxDepth, event.Depth);
+                }
+            }
+
+            ImGui::TextUnformatted(capture.ThreadName.c_str());
+            ImVec2 origin = ImGui::GetCursorScreenPos();
+            float laneHeight = static_cast<float>(maxDepth + 1) * rowHeight;
+            ImGui::InvisibleButton(std::format("##Lane{}", capture.ThreadId).c_str(), ImVec2{width, laneHeight});
+            bool laneHovered = ImGui::IsItemHovered();
+            ImVec2 mouse = ImGui::GetIO().MousePos;
+
+            for (const auto &event: capture.Events) {
+                if (event.EndNs < windowBegin || event.BeginNs > windowEnd) continue;
+
+                auto toX = [&](uint64_t ns) {
+                    ns = std::clamp(ns, windowBegin, windowEnd);
+                    return origin.x + static_cast<float>(ns - windowBegin) / static_cast<float>(windowNs) * width;
+                };
+
+                ImVec2 min{toX(event.BeginNs), origin.y + static_cast<float>(event.Depth) * rowHeight};
+                ImVec2 max{std::max(toX(event.EndNs), min.x + 1.0f), min.y + rowHeight - 1.0f};
+                drawList->AddRectFilled(min, max, ZoneColor(event.Name));
+
+                const char *name = event.Name ? event.Name : "?";
+                if (max.x - min.x > ImGui::CalcTextSize(name).x + 4.0f) {
+                    drawList->AddText(ImVec2{min.x + 2.0f, min.y + 2.0f}, IM_COL32(0, 0, 0, 255), name);
+                }
+
+                if (laneHovered && mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y && mouse.y < max.y) {
+                    ImGui::SetTooltip("%s\n%.3f ms", name, static_cast<double>(event.EndNs - event.BeginNs) / 1e6);
+                }
+            }
+        }
+
+        ImGui::EndChild();
+        ImGui::End();
+    }
+}
@@ -0,0 +1,434 @@
+module EasyGui.Utils.FontAtlasCache;
+
+import std;
+import EasyGui.Utils.MappedFile;
+import EasyGui.Tools.Profiler;
+
+import "EasyGui/Tools/ProfilerDefines.hpp";
+
+namespace EasyGui {
+    namespace {
+        constexpr std::array<char, 4> s_FontCacheMagic{'E', 'G', 'F', 'C'};
+        constexpr uint32_t s_FontCacheVersion = 1;
+
+        // layout of a cache file: the header, GlyphCount glyphs, then PixelBytes of Alpha8 pixels
+        struct FontCacheFileHeader {
+            std::array<char, 4> Magic{};
+            uint32_t Version = 0;
+            uint64_t Key = 0;
+            uint64_t GlyphCount = 0;
+            uint64_t PixelBytes = 0;
+        };
+
+        static_assert(sizeof(FontCacheFileHeader) == 32, "the header is written as is and must not contain padding");
+
+        struct CachedGlyph {
+            float Size = 0.0f;
+            float Density = 0.0f;
+            uint32_t Codepoint = 0;
+            uint16_t Width = 0;
+            uint16_t Height = 0;
+            float AdvanceX = 0.0f;
+            float X0 = 0.0f;
+            float Y0 = 0.0f;
+            float X1 = 0.0f;
+            float Y1 = 0.0f;
+            uint32_t Visible = 0;
+            uint64_t PixelOffset = 0;
+        };
+
+        static_assert(sizeof(CachedGlyph) == 48, "glyphs are written as is and must not contain padding");
+
+        struct GlyphKey {
+            float Size = 0.0f;
+            float Density = 0.0f;
+            uint32_t Codepoint = 0;
+
+            bool operator==(const GlyphKey &) const = default;
+        };
+
+        struct GlyphKeyHash {
+            size_t operator()(const GlyphKey &key) const {
+                uint64_t value = std::bit_cast<uint32_t>(key.Size) | static_cast<uint64_t>(key.Codepoint) << 32;
+                return std::hash<uint64_t>{}(value ^ static_cast<uint64_t>(std::bit_cast<uint32_t>(key.Density)) << 11);
+            }
+        };
+
+        // replaces the FontLoaderData of a source, the stb_truetype loader data is kept in LoaderData
+        struct SourceCache {
+            void *LoaderData = nullptr;
+            uint64_t Key = 0;
+            std::filesystem::path Path;
+
+            std::optional<MappedFile> File;
+            std::span<const CachedGlyph> FileGlyphs;
+            std::span<const std::byte> FilePixels;
+
+            // glyphs rasterized since the file was mapped, written back on destruction
+            std::vector<CachedGlyph> NewGlyphs;
+            std::vector<std::byte> NewPixels;
+
+            // indices below FileGlyphs.size() are file glyphs, the rest new ones
+            std::unordered_map<GlyphKey, size_t, GlyphKeyHash> Index;
+        };
+
+        std::optional<std::filesystem::path> s_Directory;
+        std::atomic<size_t> s_CachedGlyphs = 0;
+        std::atomic<size_t> s_RasterizedGlyphs = 0;
+
+        constexpr uint64_t s_FnvOffset = 0xcbf29ce484222325ull;
+        constexpr uint64_t s_FnvPrime = 0x100000001b3ull;
+
+        // FNV-1a over 64 bit words, font files are tens of MB and hashed on every startup
+        uint64_t HashBytes(uint64_t hash, const void *data, size_t size) {
+            const auto *bytes = static_cast<const std::uint8_t *>(data);
+            size_t words = size / sizeof(uint64_t);
+            for (size_t i = 0; i < words; i++) {
+                uint64_t word;
+                std::memcpy(&word, bytes + i * sizeof(uint64_t), sizeof(word));
+                hash = (hash ^ word) * s_FnvPrime;
+            }
+            for (size_t i = words * sizeof(uint64_t); i < size; i++) {
+                hash = (hash ^ bytes[i]) * s_FnvPrime;
+            }
+            return hash;
+        }
+
+        template<typename T>
+        uint64_t HashValue(uint64_t hash, const T &value) {
+            return HashBytes(hash, &value, sizeof(value));
+        }
+
+        // ranges are pairs of codepoints terminated by 0
+        uint64_t HashRanges(uint64_t hash, const ImWchar *ranges) {
+            if (!ranges) return HashValue(hash, ImWchar{0});
+
+            const ImWchar *end = ranges;
+            while (*end) end++;
+            return HashBytes(hash, ranges, (end - ranges) * sizeof(ImWchar));
+        }
+
+        uint64_t MakeSourceKey(const ImFontConfig &source) {
+            uint64_t hash = HashBytes(s_FnvOffset, source.FontData, static_cast<size_t>(source.FontDataSize));
+            hash = HashValue(hash, source.FontNo);
+            hash = HashValue(hash, source.SizePixels);
+            hash = HashValue(hash, source.OversampleH);
+            hash = HashValue(hash, source.OversampleV);
+            hash = HashValue(hash, source.PixelSnapH);
+            hash = HashValue(hash, source.RasterizerMultiply);
+            hash = HashValue(hash, source.RasterizerDensity);
+            hash = HashValue(hash, source.FontLoaderFlags);
+            // the cached glyphs store the final offsets and advance
+            hash = HashValue(hash, source.GlyphOffset.x);
+            hash = HashValue(hash, source.GlyphOffset.y);
+            hash = HashValue(hash, source.GlyphMinAdvanceX);
+            hash = HashValue(hash, source.GlyphMaxAdvanceX);
+            hash = HashValue(hash, source.GlyphExtraAdvanceX);
+            hash = HashValue(hash, source.MergeMode);
+            // merged sources scale their offsets against the size of the first source of the font
+            if (source.MergeMode && source.DstFont && !source.DstFont->Sources.empty()) {
+                hash = HashValue(hash, source.DstFont->Sources[0]->SizePixels);
+            }
+            hash = HashRanges(hash, source.GlyphRanges);
+            return HashRanges(hash, source.GlyphExcludeRanges);
+        }
+
+        void OpenCacheFile(SourceCache &cache) {
+            auto file = MappedFile::Open(cache.Path);
+            if (!file) return;
+
+            std::span<const std::byte> data = file->GetData();
+            FontCacheFileHeader header;
+            if (data.size() < sizeof(header)) return;
+            std::memcpy(&header, data.data(), sizeof(header));
+
+            // the key is part of the file name, a mismatch means a damaged or foreign file
+            size_t payload = data.size() - sizeof(header);
+            if (header.Magic != s_FontCacheMagic || header.Version != s_FontCacheVersion || header.Key != cache.Key ||
+                header.GlyphCount > payload / sizeof(CachedGlyph) ||
+                header.GlyphCount * sizeof(CachedGlyph) + header.PixelBytes != payload) {
+                return;
+            }
+
+            // the view is page aligned, so are the glyphs right after the header
+            cache.FileGlyphs = {
+                reinterpret_cast<const CachedGlyph *>(data.data() + sizeof(header)),
+                static_cast<size_t>(header.GlyphCount)
+            };
+            cache.FilePixels = data.subspan(sizeof(header) + header.GlyphCount * sizeof(CachedGlyph));
+            cache.File = std::move(file);
+
+            cache.Index.reserve(cache.FileGlyphs.size());
+            for (size_t i = 0; i < cache.FileGlyphs.size(); i++) {
+                const CachedGlyph &glyph = cache.FileGlyphs[i];
+                if (glyph.PixelOffset > cache.FilePixels.size() ||
+                    static_cast<size_t>(glyph.Width) * glyph.Height > cache.FilePixels.size() - glyph.PixelOffset) {
+                    continue;
+                }
+                cache.Index.emplace(GlyphKey{glyph.Size, glyph.Density, glyph.Codepoint}, i);
+            }
+        }
+
+        void SaveCacheFile(SourceCache &cache) {
+            if (cache.NewGlyphs.empty()) return;
+            EASYGUI_PROFILE_ZONE("FontAtlasCache::Save");
+
+            // the file is rewritten as a whole, new pixels go after the ones already in it
+            std::vector<CachedGlyph> glyphs(cache.FileGlyphs.begin(), cache.FileGlyphs.end());
+            std::vector<std::byte> pixels(cache.FilePixels.begin(), cache.FilePixels.end());
+            for (CachedGlyph glyph: cache.NewGlyphs) {
+                glyph.PixelOffset += cache.FilePixels.size();
+                glyphs.push_back(glyph);
+            }
+            pixels.insert(pixels.end(), cache.NewPixels.begin(), cache.NewPixels.end());
+
+            // a mapped file can not be replaced
+            cache.FileGlyphs = {};
+            cache.FilePixels = {};
+            cache.File.reset();
+
+            FontCacheFileHeader header{
+                .Magic = s_FontCacheMagic,
+                .Version = s_FontCacheVersion,
+                .Key = cache.Key,
+                .GlyphCount = glyphs.size(),
+                .PixelBytes = pixels.size()
+            };
+
+            std::error_code error;
+            std::filesystem::create_directories(cache.Path.parent_path(), error);
+
+            std::filesystem::path temporaryPath = cache.Path;
+            temporaryPath += ".tmp";
+            {
+                std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+                file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+                file.write(reinterpret_cast<const char *>(glyphs.data()),
+                           static_cast<std::streamsize>(glyphs.size() * sizeof(CachedGlyph)));
+                file.write(reinterpret_cast<const char *>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+                if (!file) {
+                    std::cerr << "Failed to write the font atlas cache to " << temporaryPath << std::endl;
+                    return;
+                }
+            }
+
+            std::filesystem::rename(temporaryPath, cache.Path, error);
+            if (error) {
+                std::cerr << "Failed to save the font atlas cache: " << error.message() << std::endl;
+            }
+        }
+
+        std::filesystem::path GetDefaultDirectory() {
+            std::error_code error;
+            std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+            return error ? std::filesystem::path{} : directory / "EasyGui";
+        }
+
+        const ImFontLoader &GetStbLoader() {
+            return *ImFontAtlasGetFontLoaderForStbTruetype();
+        }
+
+        // hands the stb_truetype loader its own FontLoaderData for the duration of a call
+        class StbLoaderData {
+        public:
+            explicit StbLoaderData(ImFontConfig *source)
+                : m_Source(source), m_Cache(static_cast<SourceCache *>(source->FontLoaderData)) {
+                m_Source->FontLoaderData = m_Cache->LoaderData;
+            }
+
+            StbLoaderData(const StbLoaderData &) = delete;
+
+            StbLoaderData &operator=(const StbLoaderData &) = delete;
+
+            ~StbLoaderData() {
+                m_Cache->LoaderData = m_Source->FontLoaderData;
+                m_Source->FontLoaderData = m_Cache;
+            }
+
+        private:
+            ImFontConfig *m_Source;
+            SourceCache *m_Cache;
+        };
+
+        bool FontSrcInit(ImFontAtlas *atlas, ImFontConfig *source) {
+            EASYGUI_PROFILE_ZONE("FontAtlasCache::FontSrcInit");
+            if (!GetStbLoader().FontSrcInit(atlas, source)) return false;
+
+            auto cache = std::make_unique<SourceCache>();
+            cache->LoaderData = source->FontLoaderData;
+            cache->Key = MakeSourceKey(*source);
+            std::filesystem::path directory = s_Directory ? *s_Directory : GetDefaultDirectory();
+            if (!directory.empty()) {
+                cache->Path = directory / std::format("font_cache_{:016x}.bin", cache->Key);
+                OpenCacheFile(*cache);
+            }
+
+            source->FontLoaderData = cache.release();
+            return true;
+        }
+
+        void FontSrcDestroy(ImFontAtlas *atlas, ImFontConfig *source) {
+            auto *cache = static_cast<SourceCache *>(source->FontLoaderData);
+            if (!cache->Path.empty()) {
+                SaveCacheFile(*cache);
+            }
+
+            source->FontLoaderData = cache->LoaderData;
+            GetStbLoader().FontSrcDestroy(atlas, source);
+            delete cache;
+        }
+
+        bool FontSrcContainsGlyph(ImFontAtlas *atlas, ImFontConfig *source, ImWchar codepoint) {
+            StbLoaderData stbData(source);
+            return GetStbLoader().FontSrcContainsGlyph(atlas, source, codepoint);
+        }
+
+        bool FontBakedInit(ImFontAtlas *atlas, ImFontConfig *source, ImFontBaked *baked, void *loaderData) {
+            StbLoaderData stbData(source);
+            return GetStbLoader().FontBakedInit(atlas, source, baked, loaderData);
+        }
+
+        void FontBakedDestroy(ImFontAtlas *atlas, ImFontConfig *source, ImFontBaked *baked, void *loaderData) {
+            StbLoaderData stbData(source);
+            GetStbLoader().FontBakedDestroy(atlas, source, baked, loaderData);
+        }
+
+        // Packs a cached glyph into the atlas the way the stb_truetype loader packs a rasterized one. The pixels were
+        // read back after the post-process of the atlas, e.g. RasterizerMultiply, so they are only copied.
+        bool LoadCachedGlyph(ImFontAtlas *atlas, const CachedGlyph &cached, const std::byte *pixels,
+                             ImFontGlyph *glyph) {
+            glyph->Codepoint = cached.Codepoint;
+            glyph->AdvanceX = cached.AdvanceX;
+            if (!cached.Visible) return true;
+
+            ImFontAtlasRectId packId = ImFontAtlasPackAddRect(atlas, cached.Width, cached.Height);
+            if (packId == ImFontAtlasRectId_Invalid) return false;
+
+            ImTextureRect *rect = ImFontAtlasPackGetRect(atlas, packId);
+            glyph->X0 = cached.X0;
+            glyph->Y0 = cached.Y0;
+            glyph->X1 = cached.X1;
+            glyph->Y1 = cached.Y1;
+            glyph->Visible = true;
+            glyph->PackId = packId;
+            ImTextureData *texture = atlas->TexData;
+            auto *dst = static_cast<unsigned char *>(texture->GetPixelsAt(rect->x, rect->y));
+            ImFontAtlasTextureBlockConvert(reinterpret_cast<const unsigned char *>(pixels), ImTextureFormat_Alpha8,
+                                           cached.Width, dst, texture->Format, texture->GetPitch(), rect->w, rect->h);
+            ImFontAtlasTextureBlockQueueUpload(atlas, texture, rect->x, rect->y, rect->w, rect->h);
+            return true;
+        }
+
+        // reads the pixels of a freshly rasterized glyph back from the atlas texture
+        void StoreGlyph(SourceCache &cache, ImFontAtlas *atlas, const GlyphKey &key, const ImFontGlyph &glyph) {
+            // only the stb_truetype loader runs underneath, which never produces colored glyphs
+            if (glyph.Colored) return;
+
+            CachedGlyph cached{
+                .Size = key.Size,
+                .Density = key.Density,
+                .Codepoint = key.Codepoint,
+                .AdvanceX = glyph.AdvanceX,
+                .X0 = glyph.X0,
+                .Y0 = glyph.Y0,
+                .X1 = glyph.X1,
+                .Y1 = glyph.Y1,
+                .Visible = glyph.Visible ? 1u : 0u,
+                .PixelOffset = cache.NewPixels.size()
+            };
+
+            if (glyph.Visible && glyph.PackId != ImFontAtlasRectId_Invalid) {
+                const ImTextureRect *rect = ImFontAtlasPackGetRect(atlas, glyph.PackId);
+                ImTextureData *texture = atlas->TexData;
+                cached.Width = rect->w;
+                cached.Height = rect->h;
+
+                // the atlas stores Alpha8 as is and RGBA32 as white with the coverage in alpha
+                cache.NewPixels.resize(cache.NewPixels.size() + static_cast<size_t>(rect->w) * rect->h);
+                std::byte *dst = cache.NewPixels.data() + cached.PixelOffset;
+                for (int y = 0; y < rect->h; y++) {
+                    const auto *row = static_cast<const std::byte *>(texture->GetPixelsAt(rect->x, rect->y + y));
+                    if (texture->Format == ImTextureFormat_Alpha8) {
+                        std::memcpy(dst, row, rect->w);
+                    } else {
+                        for (int x = 0; x < rect->w; x++) {
+                            dst[x] = row[x * 4 + 3];
+                        }
+                    }
+                    dst += rect->w;
+                }
+            }
+
+            cache.Index.emplace(key, cache.FileGlyphs.size() + cache.NewGlyphs.size());
+            cache.NewGlyphs.push_back(cached);
+        }
+
+        bool FontBakedLoadGlyph(ImFontAtlas *atlas, ImFontConfig *source, ImFontBaked *baked, void *loaderData,
+                                ImWchar codepoint, ImFontGlyph *glyph, float *advanceX) {
+            auto *cache = static_cast<SourceCache *>(source->FontLoaderData);
+            GlyphKey key{baked->Size, baked->RasterizerDensity, codepoint};
+
+            // advance only queries have nothing to pack
+            if (glyph) {
+                if (auto it = cache->Index.find(key); it != cache->Index.end()) {
+                    size_t index = it->second;
+                    bool inFile = index < cache->FileGlyphs.size();
+                    const CachedGlyph &cached = inFile
+                                                    ? cache->FileGlyphs[index]
+                                                    : cache->NewGlyphs[index - cache->FileGlyphs.size()];
+                    const std::byte *pixels = (inFile ? cache->FilePixels.data() : cache->NewPixels.data()) +
+                                              cached.PixelOffset;
+                    if (LoadCachedGlyph(atlas, cached, pixels, glyph)) {
+                        if (advanceX) *advanceX = cached.AdvanceX;
+                        s_CachedGlyphs.fetch_add(1, std::memory_order_relaxed);
+                        return true;
+                    }
+                }
+            }
+
+            bool loaded;
+            {
+                StbLoaderData stbData(source);
+                loaded = GetStbLoader().FontBakedLoadGlyph(atlas, source, baked, loaderData, codepoint, glyph,
+                                                           advanceX);
+            }
+
+            if (loaded && glyph && !cache->Path.empty() && !cache->Index.contains(key)) {
+                StoreGlyph(*cache, atlas, key, *glyph);
+                s_RasterizedGlyphs.fetch_add(1, std::memory_order_relaxed);
+            }
+            return loaded;
+        }
+
+        const ImFontLoader *GetCachingLoader() {
+            static const ImFontLoader loader = [] {
+                // everything that is not per source or per glyph stays with stb_truetype
+                ImFontLoader result = GetStbLoader();
+                result.Name = "EasyGui.FontAtlasCache";
+                result.FontSrcInit = FontSrcInit;
+                result.FontSrcDestroy = FontSrcDestroy;
+                result.FontSrcContainsGlyph = FontSrcContainsGlyph;
+                result.FontBakedInit = FontBakedInit;
+                result.FontBakedDestroy = FontBakedDestroy;
+                result.FontBakedLoadGlyph = FontBakedLoadGlyph;
+                return result;
+            }();
+            return &loader;
+        }
+    }
+
+    void SetFontAtlasCacheDirectory(const std::filesystem::path &directory) {
+        s_Directory = directory;
+    }
+
+    void InstallFontAtlasCache(ImFontAtlas &atlas) {
+        atlas.SetFontLoader(GetCachingLoader());
+    }
+
+    FontAtlasCacheStats GetFontAtlasCacheStats() {
+        return {
+            .CachedGlyphs = s_CachedGlyphs.load(std::memory_order_relaxed),
+            .RasterizedGlyphs = s_RasterizedGlyphs.load(std::memory_order_relaxed)
+        };
+    }
+}
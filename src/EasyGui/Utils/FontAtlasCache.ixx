@@ -0,0 +1,31 @@
+export module EasyGui.Utils.FontAtlasCache;
+
+import std;
+import EasyGui.Lib;
+
+// On-disk cache of rasterized glyphs for the ImGui font atlas.
+//
+// ImGui 1.92 rasterizes glyphs on demand, per font size, which for large CJK fonts costs most of the first frames.
+// The cache wraps the stb_truetype font loader of an atlas. Every font source is keyed by a hash of its font data,
+// its size, glyph ranges and rasterizer settings, and the cache file of that key is memory mapped when the source is
+// added. Glyphs found there are copied into the atlas with their metrics instead of being rasterized. Anything
+// missing is rasterized as usual, which includes every glyph of a changed key, and is written back when the source
+// is destroyed, at the latest together with the ImGui context.
+namespace EasyGui {
+    export struct FontAtlasCacheStats {
+        // glyphs copied from cache files
+        size_t CachedGlyphs = 0;
+        // glyphs the cache had to rasterize
+        size_t RasterizedGlyphs = 0;
+    };
+
+    // where the cache files live, temp_directory_path()/EasyGui by default, set it before any font is added,
+    // an empty path turns the cache off
+    export void SetFontAtlasCacheDirectory(const std::filesystem::path &directory);
+
+    // installs the caching font loader, fonts added to the atlas afterwards load through the cache
+    export void InstallFontAtlasCache(ImFontAtlas &atlas);
+
+    // totals over every atlas since startup
+    export FontAtlasCacheStats GetFontAtlasCacheStats();
+}
@@ -1,17 +1,30 @@
 export module EasyGui.Utils.Image;
 
 import EasyGui.Lib;
+import EasyGui.Graphics.GraphicsContext;
+import EasyGui.Graphics.BindlessTextureTable;
+import EasyGui.Tools.Profiler;
 import std;
 
+import "EasyGui/Tools/ProfilerDefines.hpp";
+
 namespace EasyGui::Vulkan {
     export class ImGuiImage {
     public:
         ImGuiImage() = default;
 
+        // with a deletion queue the descriptor set outlives this object until no frame in flight uses it
         ImGuiImage(ImTextureID &&textureId,
-                   size_t width, size_t height)
+                   size_t width, size_t height,
+                   DeferredDeletionQueue *deletionQueue = nullptr)
             : m_TextureId(std::exchange(textureId, 0)),
-              m_Width(width), m_Height(height) {}
+              m_Width(width), m_Height(height), m_DeletionQueue(deletionQueue) {}
+
+        // bindless mode, the texture id is the index of the image in the table
+        ImGuiImage(BindlessTextureTable &textureTable, uint32_t index,
+                   size_t width, size_t height)
+            : m_TextureId(static_cast<ImTextureID>(index)),
+              m_Width(width), m_Height(height), m_TextureTable(&textureTable) {}
 
         ImGuiImage(const ImGuiImage &) = delete;
 
@@ -19,13 +32,16 @@ namespace EasyGui::Vulkan {
 
         ImGuiImage(ImGuiImage &&other) noexcept
             : m_TextureId(std::exchange(other.m_TextureId, 0)),
-              m_Width(other.m_Width), m_Height(other.m_Height) {}
+              m_Width(other.m_Width), m_Height(other.m_Height),
+              m_DeletionQueue(other.m_DeletionQueue), m_TextureTable(other.m_TextureTable) {}
 
         ImGuiImage &operator=(ImGuiImage &&other) noexcept {
             if (this != &other) {
                 std::swap(m_TextureId, other.m_TextureId);
                 std::swap(m_Width, other.m_Width);
                 std::swap(m_Height, other.m_Height);
+                std::swap(m_DeletionQueue, other.m_DeletionQueue);
+                std::swap(m_TextureTable, other.m_TextureTable);
             }
             return *this;
         }
@@ -35,8 +51,20 @@ namespace EasyGui::Vulkan {
         }
 
         ~ImGuiImage() {
-            if (m_TextureId) {
-                ImGui_ImplVulkan_RemoveTexture(reinterpret_cast<VkDescriptorSet>(m_TextureId));
+            if (!m_TextureId) return;
+
+            if (m_TextureTable) {
+                m_TextureTable->Unregister(static_cast<uint32_t>(m_TextureId));
+                return;
+            }
+
+            auto descriptorSet = reinterpret_cast<VkDescriptorSet>(m_TextureId);
+            if (m_DeletionQueue) {
+                m_DeletionQueue->Enqueue([descriptorSet] {
+                    ImGui_ImplVulkan_RemoveTexture(descriptorSet);
+                });
+            } else {
+                ImGui_ImplVulkan_RemoveTexture(descriptorSet);
             }
         }
 
@@ -68,6 +96,8 @@ namespace EasyGui::Vulkan {
         ImTextureID m_TextureId = 0;
         size_t m_Width = 0;
         size_t m_Height = 0;
+        DeferredDeletionQueue *m_DeletionQueue = nullptr;
+        BindlessTextureTable *m_TextureTable = nullptr;
     };
 
     export class PixelImage {
@@ -75,9 +105,10 @@ namespace EasyGui::Vulkan {
         PixelImage(vma::UniqueImage &&image,
                    vma::UniqueAllocation &&memory,
                    vk::UniqueImageView &&imageView,
-                   size_t width, size_t height)
+                   size_t width, size_t height,
+                   DeferredDeletionQueue *deletionQueue = nullptr)
             : m_Image(std::move(image)), m_Memory(std::move(memory)), m_ImageView(std::move(imageView)),
-              m_Width(width), m_Height(height) {}
+              m_Width(width), m_Height(height), m_DeletionQueue(deletionQueue) {}
 
         PixelImage() = default;
 
@@ -89,10 +120,17 @@ namespace EasyGui::Vulkan {
             : m_Image(std::move(other.m_Image)), m_Memory(std::move(other.m_Memory)),
               m_ImageView(std::move(other.m_ImageView)),
               m_Width(std::exchange(other.m_Width, 0)),
-              m_Height(std::exchange(other.m_Height, 0)) {}
+              m_Height(std::exchange(other.m_Height, 0)),
+              m_DeletionQueue(other.m_DeletionQueue) {}
+
+        ~PixelImage() {
+            Retire();
+        }
 
         PixelImage &operator=(PixelImage &&other) noexcept {
             if (this != &other) {
+                Retire();
+                m_DeletionQueue = other.m_DeletionQueue;
                 m_Image = std::move(other.m_Image);
                 m_Memory = std::move(other.m_Memory);
                 m_ImageView = std::move(other.m_ImageView);
@@ -123,6 +161,16 @@ namespace EasyGui::Vulkan {
 
             return {
                 std::bit_cast<ImTextureID>(descriptorSet),
+                m_Width, m_Height,
+                m_DeletionQueue
+            };
+        }
+
+        // for windows created with bindless textures, no descriptor set is allocated
+        ImGuiImage CreateImGuiImage(BindlessTextureTable &textureTable, vk::Sampler sampler) const {
+            return {
+                textureTable,
+                textureTable.Register(m_ImageView.get(), sampler),
                 m_Width, m_Height
             };
         }
@@ -144,24 +192,131 @@ namespace EasyGui::Vulkan {
         }
 
     private:
+        // hands the handles to the deletion queue, without one they are destroyed right away as before
+        void Retire() {
+            if (!m_DeletionQueue || !(m_Image || m_Memory || m_ImageView)) return;
+
+            m_DeletionQueue->Enqueue([image = std::move(m_Image), memory = std::move(m_Memory),
+                                         imageView = std::move(m_ImageView)]() mutable {
+                imageView.reset();
+                memory.reset();
+                image.reset();
+            });
+        }
+
         vma::UniqueImage m_Image;
         vma::UniqueAllocation m_Memory;
         vk::UniqueImageView m_ImageView;
 
         size_t m_Width = 0;
         size_t m_Height = 0;
+        DeferredDeletionQueue *m_DeletionQueue = nullptr;
     };
 
+    // levels down to 1x1
+    export uint32_t CalculateMipLevels(uint32_t width, uint32_t height) {
+        return static_cast<uint32_t>(std::bit_width(std::max(width, height)));
+    }
+
+    // Fills levels 1..mipLevels-1 from level 0 with linear blits. Every level must be in eTransferDstOptimal with
+    // level 0 holding the image, afterwards all levels are in eShaderReadOnlyOptimal.
+    export void RecordMipChainGeneration(vk::CommandBuffer commandBuffer, vk::Image image,
+                                         uint32_t width, uint32_t height, uint32_t mipLevels) {
+        vk::ImageMemoryBarrier barrier{
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .image = image,
+            .subresourceRange = {
+                .aspectMask = vk::ImageAspectFlagBits::eColor,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            }
+        };
+
+        auto mipWidth = static_cast<int32_t>(width);
+        auto mipHeight = static_cast<int32_t>(height);
+
+        for (uint32_t level = 1; level < mipLevels; level++) {
+            barrier.subresourceRange.baseMipLevel = level - 1;
+            barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+            barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+            barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+            barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+            commandBuffer.pipelineBarrier(
+                vk::PipelineStageFlagBits::eTransfer,
+                vk::PipelineStageFlagBits::eTransfer,
+                {}, {}, {}, barrier
+            );
+
+            int32_t nextWidth = std::max(mipWidth / 2, 1);
+            int32_t nextHeight = std::max(mipHeight / 2, 1);
+
+            vk::ImageBlit blit{
+                .srcSubresource = {
+                    .aspectMask = vk::ImageAspectFlagBits::eColor,
+                    .mipLevel = level - 1,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1
+                },
+                .srcOffsets = std::array{vk::Offset3D{0, 0, 0}, vk::Offset3D{mipWidth, mipHeight, 1}},
+                .dstSubresource = {
+                    .aspectMask = vk::ImageAspectFlagBits::eColor,
+                    .mipLevel = level,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1
+                },
+                .dstOffsets = std::array{vk::Offset3D{0, 0, 0}, vk::Offset3D{nextWidth, nextHeight, 1}}
+            };
+
+            commandBuffer.blitImage(
+                image, vk::ImageLayout::eTransferSrcOptimal,
+                image, vk::ImageLayout::eTransferDstOptimal,
+                blit, vk::Filter::eLinear
+            );
+
+            // the source level is final now
+            barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
+            barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+            barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+            barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+            commandBuffer.pipelineBarrier(
+                vk::PipelineStageFlagBits::eTransfer,
+                vk::PipelineStageFlagBits::eFragmentShader,
+                {}, {}, {}, barrier
+            );
+
+            mipWidth = nextWidth;
+            mipHeight = nextHeight;
+        }
+
+        // the last level is only ever written
+        barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+        barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+        barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+        commandBuffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eFragmentShader,
+            {}, {}, {}, barrier
+        );
+    }
+
     export class ImageHelper {
     public:
         ImageHelper(vk::raii::PhysicalDevice* physicalDevice, vk::raii::Device* logicalDevice,
                     vk::raii::CommandPool* commandPool,
                     vk::raii::Queue* graphicsQueue,
                     vk::raii::Instance* instance,
-                    vma::UniqueAllocator* allocator)
+                    vma::UniqueAllocator* allocator,
+                    DeferredDeletionQueue* deletionQueue = nullptr,
+                    StagingRing* stagingRing = nullptr)
             : m_PhysicalDevice(physicalDevice), m_LogicalDevice(logicalDevice),
               m_CommandPool(commandPool), m_GraphicsQueue(graphicsQueue),
-              m_Instance(*instance), m_Allocator(**allocator) {}
+              m_Instance(*instance), m_Allocator(**allocator), m_DeletionQueue(deletionQueue),
+              m_StagingRing(stagingRing) {}
 
         std::pair<vma::UniqueImage, vma::UniqueAllocation>
         CreateImage(
@@ -170,7 +325,8 @@ namespace EasyGui::Vulkan {
             vk::Format format,
             vk::ImageTiling tiling,
             vk::ImageUsageFlags usage,
-            vk::MemoryPropertyFlags properties) {
+            vk::MemoryPropertyFlags properties,
+            uint32_t mipLevels = 1) {
             vk::ImageCreateInfo imageInfo{
                 .imageType = vk::ImageType::e2D,
                 .format = format,
@@ -179,7 +335,7 @@ namespace EasyGui::Vulkan {
                     .height = height,
                     .depth = 1
                 },
-                .mipLevels = 1,
+                .mipLevels = mipLevels,
                 .arrayLayers = 1,
                 .samples = vk::SampleCountFlagBits::e1,
                 .tiling = tiling,
@@ -200,6 +356,15 @@ namespace EasyGui::Vulkan {
         std::pair<vma::UniqueBuffer, vma::UniqueAllocation> CreateAndCopyBuffer(
             vk::DeviceSize size,
             const void *data) {
+            return CreateAndFillBuffer(size, [data](std::span<std::byte> bytes) {
+                std::memcpy(bytes.data(), data, bytes.size());
+            });
+        }
+
+        std::pair<vma::UniqueBuffer, vma::UniqueAllocation> CreateAndFillBuffer(
+            vk::DeviceSize size,
+            std::invocable<std::span<std::byte>> auto &&write) {
+            EASYGUI_PROFILE_ZONE("ImageHelper::CreateAndCopyBuffer");
             vk::BufferCreateInfo bufferInfo{
                 .size = size,
                 .usage = vk::BufferUsageFlagBits::eTransferSrc,
@@ -216,7 +381,7 @@ namespace EasyGui::Vulkan {
             ).value;
 
             void *mappedData = m_Allocator.mapMemory(*allocation).value;
-            std::memcpy(mappedData, data, size);
+            write(std::span{static_cast<std::byte *>(mappedData), static_cast<size_t>(size)});
             m_Allocator.unmapMemory(*allocation);
             return {std::move(buffer), std::move(allocation)};
         }
@@ -225,7 +390,10 @@ namespace EasyGui::Vulkan {
             vk::Buffer buffer,
             vk::Image image,
             uint32_t width,
-            uint32_t height) {
+            uint32_t height,
+            vk::DeviceSize bufferOffset = 0,
+            uint32_t mipLevels = 1) {
+            EASYGUI_PROFILE_ZONE("ImageHelper::CopyBufferToImage");
             vk::CommandBufferAllocateInfo allocInfo{
                 .commandPool = *m_CommandPool,
                 .level = vk::CommandBufferLevel::ePrimary,
@@ -250,14 +418,14 @@ namespace EasyGui::Vulkan {
                 .subresourceRange = {
                     .aspectMask = vk::ImageAspectFlagBits::eColor,
                     .baseMipLevel = 0,
-                    .levelCount = 1,
+                    .levelCount = mipLevels,
                     .baseArrayLayer = 0,
                     .layerCount = 1
                 }
             };
 
             vk::BufferImageCopy region{
-                .bufferOffset = 0,
+                .bufferOffset = bufferOffset,
                 .bufferRowLength = 0,
                 .bufferImageHeight = 0,
                 .imageSubresource = {
@@ -305,14 +473,19 @@ namespace EasyGui::Vulkan {
                 region
             );
 
-            commandBuffer.pipelineBarrier(
-                vk::PipelineStageFlagBits::eTransfer,
-                vk::PipelineStageFlagBits::eFragmentShader,
-                {},
-                {},
-                {},
-                toShaderBarrier
-            );
+            if (mipLevels > 1) {
+                // recorded into the same submission, the blits leave every level shader readable
+                RecordMipChainGeneration(*commandBuffer, image, width, height, mipLevels);
+            } else {
+                commandBuffer.pipelineBarrier(
+                    vk::PipelineStageFlagBits::eTransfer,
+                    vk::PipelineStageFlagBits::eFragmentShader,
+                    {},
+                    {},
+                    {},
+                    toShaderBarrier
+                );
+            }
 
             commandBuffer.end();
 
@@ -327,7 +500,8 @@ namespace EasyGui::Vulkan {
 
         vk::UniqueImageView CreateImageView(
             vk::Image image,
-            vk::Format format) {
+            vk::Format format,
+            uint32_t mipLevels = 1) {
             vk::ImageViewCreateInfo viewInfo{
                 .image = image,
                 .viewType = vk::ImageViewType::e2D,
@@ -335,7 +509,7 @@ namespace EasyGui::Vulkan {
                 .subresourceRange = {
                     .aspectMask = vk::ImageAspectFlagBits::eColor,
                     .baseMipLevel = 0,
-                    .levelCount = 1,
+                    .levelCount = mipLevels,
                     .baseArrayLayer = 0,
                     .layerCount = 1
                 }
@@ -350,29 +524,70 @@ namespace EasyGui::Vulkan {
             uint32_t width,
             uint32_t height,
             vk::Format format,
-            const void *data) {
+            const void *data,
+            bool generateMips = false) {
+            return CreatePixelImage(width, height, format, [data](std::span<std::byte> pixels) {
+                std::memcpy(pixels.data(), data, pixels.size());
+            }, generateMips);
+        }
+
+        // write receives the staging memory of the image, width * height texels of format, to fill in place,
+        // e.g. with one of the PixelConversion kernels
+        PixelImage CreatePixelImage(
+            uint32_t width,
+            uint32_t height,
+            vk::Format format,
+            std::invocable<std::span<std::byte>> auto &&write,
+            bool generateMips = false) {
+            EASYGUI_PROFILE_ZONE("ImageHelper::CreatePixelImage");
+            // the mip chain is built with linear blits between levels, the format has to support all three,
+            // otherwise the image keeps its only level
+            constexpr vk::FormatFeatureFlags mipFeatures = vk::FormatFeatureFlagBits::eBlitSrc |
+                                                           vk::FormatFeatureFlagBits::eBlitDst |
+                                                           vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+            uint32_t mipLevels = 1;
+            if (generateMips && (m_PhysicalDevice->getFormatProperties(format).optimalTilingFeatures & mipFeatures) ==
+                                mipFeatures) {
+                mipLevels = CalculateMipLevels(width, height);
+            }
+
+            vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
+            if (mipLevels > 1) {
+                usage |= vk::ImageUsageFlagBits::eTransferSrc;
+            }
+
             auto [image, memory] = CreateImage(
                 width, height, format,
                 vk::ImageTiling::eOptimal,
-                vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
-                vk::MemoryPropertyFlagBits::eDeviceLocal
-            );
-
-            auto [buffer, stagingMemory] = CreateAndCopyBuffer(
-                width * height * 4, data // Assuming 4 bytes per pixel for RGBA
+                usage,
+                vk::MemoryPropertyFlagBits::eDeviceLocal,
+                mipLevels
             );
 
-            CopyBufferToImageWithTransitions(*buffer, *image, width, height);
+            vk::DeviceSize size = static_cast<vk::DeviceSize>(width) * height * vk::blockSize(format);
+            if (m_StagingRing) {
+                StagingAllocation staging = m_StagingRing->Allocate(size);
+                write(staging.Data);
+                m_StagingRing->Flush(staging);
+
+                CopyBufferToImageWithTransitions(staging.Buffer, *image, width, height, staging.Offset, mipLevels);
+                // the copy has completed, the memory can be reused right away
+                m_StagingRing->Release(staging, 0);
+            } else {
+                auto [buffer, stagingMemory] = CreateAndFillBuffer(size, write);
+                CopyBufferToImageWithTransitions(*buffer, *image, width, height, 0, mipLevels);
+            }
 
             vk::UniqueImageView imageView{
-                CreateImageView(*image, format)
+                CreateImageView(*image, format, mipLevels)
             };
 
             return PixelImage(
                 std::move(image),
                 std::move(memory),
                 std::move(imageView),
-                width, height
+                width, height,
+                m_DeletionQueue
             );
         }
 
@@ -383,6 +598,8 @@ namespace EasyGui::Vulkan {
         vk::raii::Queue* m_GraphicsQueue;
         vk::Instance m_Instance;
         vma::Allocator m_Allocator;
+        DeferredDeletionQueue* m_DeletionQueue;
+        StagingRing* m_StagingRing;
 
         uint32_t FindMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) {
             vk::PhysicalDeviceMemoryProperties memProperties = m_PhysicalDevice->getMemoryProperties();
@@ -407,6 +624,9 @@ namespace EasyGui::Vulkan {
             .addressModeV = vk::SamplerAddressMode::eRepeat,
             .addressModeW = vk::SamplerAddressMode::eRepeat,
             .anisotropyEnable = vk::False,
+            // the whole mip chain, images without mips clamp to their only level
+            .minLod = 0.0f,
+            .maxLod = vk::LodClampNone,
             .borderColor = vk::BorderColor::eIntOpaqueBlack,
             .unnormalizedCoordinates = vk::False,
         };
@@ -419,6 +639,7 @@ namespace EasyGui {
     export class CPUImageData {
     public:
         static std::optional<CPUImageData> LoadFromFile(const std::filesystem::path& path) {
+            EASYGUI_PROFILE_ZONE("CPUImageData::LoadFromFile");
             if (!std::filesystem::exists(path)) {
                 return std::nullopt;
             }
@@ -431,6 +652,35 @@ namespace EasyGui {
             return imageData;
         }
 
+        // decodes an encoded file already in memory as RGBA, e.g. a mapped file
+        static std::optional<CPUImageData> LoadFromMemory(std::span<const std::byte> encoded) {
+            EASYGUI_PROFILE_ZONE("CPUImageData::LoadFromMemory");
+            if (encoded.empty() || encoded.size() > static_cast<size_t>(std::numeric_limits<int>::max())) {
+                return std::nullopt;
+            }
+
+            CPUImageData imageData(encoded);
+            if (imageData.m_Width <= 0 || imageData.m_Height <= 0 || imageData.m_Channels <= 0 || !imageData.m_Data) {
+                return std::nullopt;
+            }
+
+            return imageData;
+        }
+
+        // reads only the header, the decoded RGBA size in bytes or 0 when the format is not recognized
+        static size_t QueryDecodedSize(std::span<const std::byte> encoded) {
+            if (encoded.empty() || encoded.size() > static_cast<size_t>(std::numeric_limits<int>::max())) {
+                return 0;
+            }
+
+            int width = 0, height = 0, channels = 0;
+            if (!stbi_info_from_memory(reinterpret_cast<const stbi_uc *>(encoded.data()),
+                                       static_cast<int>(encoded.size()), &width, &height, &channels)) {
+                return 0;
+            }
+            return static_cast<size_t>(width) * height * 4;
+        }
+
         int GetWidth() const {
             return m_Width;
         }
@@ -457,6 +707,13 @@ namespace EasyGui {
             ));
         }
 
+        CPUImageData(std::span<const std::byte> encoded) {
+            m_Data.reset(stbi_load_from_memory(
+                reinterpret_cast<const stbi_uc *>(encoded.data()), static_cast<int>(encoded.size()),
+                &m_Width, &m_Height, &m_Channels, STBI_rgb_alpha
+            ));
+        }
+
         struct STBDeleteType {
             void operator()(unsigned char* data) const {
                 stbi_image_free(data);
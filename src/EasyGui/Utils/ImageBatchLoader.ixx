@@ -0,0 +1,219 @@
+export module EasyGui.Utils.ImageBatchLoader;
+
+import EasyGui.Utils.Image;
+import EasyGui.Utils.MappedFile;
+import EasyGui.Tools.ThreadPool;
+import EasyGui.Tools.Profiler;
+import std;
+
+import "EasyGui/Tools/ProfilerDefines.hpp";
+
+namespace EasyGui {
+    export struct DecodedImage {
+        // position of the path in the batch
+        size_t Index = 0;
+        std::filesystem::path Path;
+        // empty when the file could not be read or decoded
+        std::optional<CPUImageData> Image;
+    };
+
+    export struct ImageBatchSpec {
+        // decoded bytes held by the batch, running decodes and results not yet taken, before no more files are started
+        size_t maxInFlightBytes = 512ull << 20;
+        // concurrent decodes, 0 uses the hardware concurrency
+        size_t maxConcurrentDecodes = 0;
+        // Background for folders decoded ahead of time, UiCritical for images that are on screen
+        TaskPriority priority = TaskPriority::Normal;
+    };
+
+    // Decodes a list of image files on a thread pool and hands the results out as they complete.
+    //
+    // Files are memory mapped and decoded with stbi_load_from_memory. A file is only started while the decoded bytes
+    // held by the batch stay below maxInFlightBytes, so the memory of a large folder is bounded by the budget plus one
+    // image per concurrent decode. Results are returned in completion order, taking one frees its share of the budget.
+    // Destroying the loader cancels files that have not started yet, queued decodes are dropped and running ones
+    // finish in the background.
+    export class ImageBatchLoader {
+    public:
+        ImageBatchLoader(IThreadPool *threadPool, std::vector<std::filesystem::path> paths,
+                         const ImageBatchSpec &spec = {})
+            : m_State(std::make_shared<State>()) {
+            m_State->ThreadPool = threadPool;
+            m_State->Paths = std::move(paths);
+            m_State->MaxInFlightBytes = spec.maxInFlightBytes;
+            m_State->Priority = spec.priority;
+            m_State->MaxConcurrentDecodes = spec.maxConcurrentDecodes
+                                                ? spec.maxConcurrentDecodes
+                                                : std::max<size_t>(std::jthread::hardware_concurrency(), 1);
+
+            std::lock_guard lock(m_State->Mutex);
+            Schedule(m_State);
+        }
+
+        ImageBatchLoader(const ImageBatchLoader &) = delete;
+
+        ImageBatchLoader &operator=(const ImageBatchLoader &) = delete;
+
+        ~ImageBatchLoader() {
+            Cancel();
+        }
+
+        // a finished image if one is ready, never blocks
+        std::optional<DecodedImage> TryPop() {
+            std::lock_guard lock(m_State->Mutex);
+            return PopLocked();
+        }
+
+        // blocks until the next image finished, empty once every file has been returned
+        std::optional<DecodedImage> WaitPop() {
+            std::unique_lock lock(m_State->Mutex);
+            m_State->Condition.wait(lock, [this] {
+                return !m_State->Results.empty() || IsFinishedLocked();
+            });
+            return PopLocked();
+        }
+
+        // calls the callback for at most maxCount ready images, for draining a few per frame on the UI thread
+        template<typename Callback> requires std::invocable<Callback, DecodedImage &&>
+        size_t Poll(Callback &&callback, size_t maxCount = std::numeric_limits<size_t>::max()) {
+            size_t count = 0;
+            while (count < maxCount) {
+                auto image = TryPop();
+                if (!image) break;
+
+                callback(std::move(*image));
+                count++;
+            }
+            return count;
+        }
+
+        // files that have not been started are skipped
+        void Cancel() {
+            std::lock_guard lock(m_State->Mutex);
+            m_State->Cancelled = true;
+            m_State->Cancellation.Cancel();
+            m_State->Condition.notify_all();
+        }
+
+        // every file has been returned or the batch was cancelled
+        [[nodiscard]] bool IsFinished() const {
+            std::lock_guard lock(m_State->Mutex);
+            return IsFinishedLocked();
+        }
+
+        [[nodiscard]] size_t GetTotalCount() const {
+            return m_State->Paths.size();
+        }
+
+        [[nodiscard]] size_t GetCompletedCount() const {
+            std::lock_guard lock(m_State->Mutex);
+            return m_State->CompletedCount;
+        }
+
+        [[nodiscard]] size_t GetInFlightBytes() const {
+            std::lock_guard lock(m_State->Mutex);
+            return m_State->InFlightBytes;
+        }
+
+    private:
+        struct Result {
+            DecodedImage Image;
+            size_t Bytes = 0;
+        };
+
+        // shared with the running tasks, so the loader can go away before them
+        struct State {
+            IThreadPool *ThreadPool = nullptr;
+            std::vector<std::filesystem::path> Paths;
+            size_t MaxInFlightBytes = 0;
+            size_t MaxConcurrentDecodes = 0;
+            TaskPriority Priority = TaskPriority::Normal;
+            CancellationSource Cancellation;
+
+            mutable std::mutex Mutex;
+            std::condition_variable Condition;
+            std::deque<Result> Results;
+            size_t NextIndex = 0;
+            size_t RunningDecodes = 0;
+            size_t InFlightBytes = 0;
+            size_t CompletedCount = 0;
+            size_t ReturnedCount = 0;
+            bool Cancelled = false;
+        };
+
+        // starts files while the budget allows, called with the mutex held
+        static void Schedule(const std::shared_ptr<State> &state) {
+            while (!state->Cancelled &&
+                   state->NextIndex < state->Paths.size() &&
+                   state->RunningDecodes < state->MaxConcurrentDecodes &&
+                   state->InFlightBytes < state->MaxInFlightBytes) {
+                size_t index = state->NextIndex++;
+                state->RunningDecodes++;
+                TaskOptions options{.priority = state->Priority, .token = state->Cancellation.GetToken()};
+                state->ThreadPool->EnqueueDetached(options, [state, index] {
+                    Decode(state, index);
+                });
+            }
+        }
+
+        static void Decode(const std::shared_ptr<State> &state, size_t index) {
+            EASYGUI_PROFILE_ZONE("ImageBatchLoader::Decode");
+            const std::filesystem::path &path = state->Paths[index];
+
+            Result result{.Image = {.Index = index, .Path = path}};
+            // the result is pushed in any case, a file without one would keep WaitPop() blocked forever
+            try {
+                auto file = MappedFile::Open(path);
+                if (file) {
+                    // charge the budget before decoding, so other workers see the memory this one is about to take
+                    size_t bytes = CPUImageData::QueryDecodedSize(file->GetData());
+                    {
+                        std::lock_guard lock(state->Mutex);
+                        state->InFlightBytes += bytes;
+                    }
+                    result.Bytes = bytes;
+
+                    if (result.Bytes > 0) {
+                        result.Image.Image = CPUImageData::LoadFromMemory(file->GetData());
+                    }
+                }
+            } catch (const std::exception &e) {
+                std::cerr << "Failed to decode " << path.string() << ": " << e.what() << std::endl;
+                result.Image.Image.reset();
+            } catch (...) {
+                result.Image.Image.reset();
+            }
+
+            std::lock_guard lock(state->Mutex);
+            state->RunningDecodes--;
+            state->CompletedCount++;
+            if (state->Cancelled) {
+                state->InFlightBytes -= result.Bytes;
+            } else {
+                state->Results.push_back(std::move(result));
+                Schedule(state);
+            }
+            state->Condition.notify_all();
+        }
+
+        std::optional<DecodedImage> PopLocked() {
+            if (m_State->Results.empty()) return std::nullopt;
+
+            Result result = std::move(m_State->Results.front());
+            m_State->Results.pop_front();
+            m_State->ReturnedCount++;
+
+            // the caller owns the pixels now
+            m_State->InFlightBytes -= result.Bytes;
+            Schedule(m_State);
+            return std::move(result.Image);
+        }
+
+        [[nodiscard]] bool IsFinishedLocked() const {
+            if (m_State->Cancelled) return m_State->Results.empty();
+            return m_State->ReturnedCount == m_State->Paths.size();
+        }
+
+        std::shared_ptr<State> m_State;
+    };
+}
@@ -0,0 +1,216 @@
+module EasyGui.Utils.ImageResize;
+
+import std;
+import EasyGui.Tools.Profiler;
+import EasyGui.Tools.Parallel;
+
+import <immintrin.h>;
+import "EasyGui/Tools/ProfilerDefines.hpp";
+
+namespace EasyGui {
+    namespace {
+        constexpr double s_Pi = std::numbers::pi;
+
+        double GetFilterRadius(ResizeFilter filter) {
+            switch (filter) {
+                case ResizeFilter::Box: return 0.5;
+                case ResizeFilter::Bilinear: return 1.0;
+                case ResizeFilter::Lanczos3: return 3.0;
+            }
+            return 1.0;
+        }
+
+        double Sinc(double x) {
+            if (std::abs(x) < 1e-8) return 1.0;
+            x *= s_Pi;
+            return std::sin(x) / x;
+        }
+
+        double EvaluateFilter(ResizeFilter filter, double x) {
+            x = std::abs(x);
+            switch (filter) {
+                case ResizeFilter::Box: return x <= 0.5 ? 1.0 : 0.0;
+                case ResizeFilter::Bilinear: return std::max(0.0, 1.0 - x);
+                case ResizeFilter::Lanczos3: return x < 3.0 ? Sinc(x) * Sinc(x / 3.0) : 0.0;
+            }
+            return 0.0;
+        }
+
+        // the source samples contributing to one destination sample
+        struct Contribution {
+            uint32_t First = 0;
+            uint32_t Count = 0;
+            size_t WeightOffset = 0;
+        };
+
+        struct Contributions {
+            std::vector<Contribution> Samples;
+            std::vector<float> Weights;
+        };
+
+        Contributions ComputeContributions(ResizeFilter filter, uint32_t srcSize, uint32_t dstSize) {
+            double scale = static_cast<double>(srcSize) / dstSize;
+            // when downscaling the filter is stretched over the source pixels one destination pixel covers
+            double filterScale = std::max(scale, 1.0);
+            double support = GetFilterRadius(filter) * filterScale;
+
+            Contributions result;
+            result.Samples.reserve(dstSize);
+            std::vector<double> weights;
+            for (uint32_t i = 0; i < dstSize; i++) {
+                double center = (i + 0.5) * scale;
+                auto first = static_cast<int64_t>(std::floor(center - support));
+                auto last = static_cast<int64_t>(std::ceil(center + support));
+                first = std::max<int64_t>(first, 0);
+                last = std::min<int64_t>(last, srcSize - 1);
+
+                weights.clear();
+                double sum = 0.0;
+                for (int64_t j = first; j <= last; j++) {
+                    double weight = EvaluateFilter(filter, (j + 0.5 - center) / filterScale);
+                    weights.push_back(weight);
+                    sum += weight;
+                }
+
+                // trim zero weights at both ends, they only cost time
+                size_t begin = 0;
+                size_t end = weights.size();
+                while (begin < end && weights[begin] == 0.0) begin++;
+                while (end > begin && weights[end - 1] == 0.0) end--;
+
+                Contribution contribution{.WeightOffset = result.Weights.size()};
+                if (begin == end || sum == 0.0) {
+                    // nothing covered, fall back to the nearest sample
+                    contribution.First = std::min(static_cast<uint32_t>(center), srcSize - 1);
+                    contribution.Count = 1;
+                    result.Weights.push_back(1.0f);
+                } else {
+                    contribution.First = static_cast<uint32_t>(first + static_cast<int64_t>(begin));
+                    contribution.Count = static_cast<uint32_t>(end - begin);
+                    for (size_t k = begin; k < end; k++) {
+                        result.Weights.push_back(static_cast<float>(weights[k] / sum));
+                    }
+                }
+                result.Samples.push_back(contribution);
+            }
+            return result;
+        }
+
+        __m128 LoadPixel(const std::uint8_t *pixel) {
+            std::int32_t value;
+            std::memcpy(&value, pixel, sizeof(value));
+            const __m128i zero = _mm_setzero_si128();
+            __m128i widened = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(value), zero), zero);
+            return _mm_cvtepi32_ps(widened);
+        }
+
+        void StorePixels(__m128 value, std::uint8_t *pixel) {
+            // rounded and clamped, the negative lobes of Lanczos overshoot
+            __m128i integer = _mm_cvtps_epi32(value);
+            __m128i packed = _mm_packus_epi16(_mm_packs_epi32(integer, integer), integer);
+            std::int32_t result = _mm_cvtsi128_si32(packed);
+            std::memcpy(pixel, &result, sizeof(result));
+        }
+
+        // srcRows of RGBA8 into rows of dstWidth float pixels
+        void ResizeRowsHorizontal(const std::uint8_t *src, uint32_t srcWidth, float *dst, uint32_t dstWidth,
+                                  const Contributions &contributions, uint32_t rowBegin, uint32_t rowEnd) {
+            for (uint32_t y = rowBegin; y < rowEnd; y++) {
+                const std::uint8_t *srcRow = src + static_cast<size_t>(y) * srcWidth * 4;
+                float *dstRow = dst + static_cast<size_t>(y) * dstWidth * 4;
+
+                for (uint32_t x = 0; x < dstWidth; x++) {
+                    const Contribution &contribution = contributions.Samples[x];
+                    const float *weights = contributions.Weights.data() + contribution.WeightOffset;
+                    const std::uint8_t *pixel = srcRow + static_cast<size_t>(contribution.First) * 4;
+
+                    __m128 sum = _mm_setzero_ps();
+                    for (uint32_t k = 0; k < contribution.Count; k++, pixel += 4) {
+                        sum = _mm_add_ps(sum, _mm_mul_ps(LoadPixel(pixel), _mm_set1_ps(weights[k])));
+                    }
+                    _mm_storeu_ps(dstRow + static_cast<size_t>(x) * 4, sum);
+                }
+            }
+        }
+
+        // float rows of width pixels into RGBA8 rows, vectorized along the row
+        void ResizeRowsVertical(const float *src, std::uint8_t *dst, uint32_t width,
+                                const Contributions &contributions, uint32_t rowBegin, uint32_t rowEnd) {
+            size_t rowFloats = static_cast<size_t>(width) * 4;
+            for (uint32_t y = rowBegin; y < rowEnd; y++) {
+                const Contribution &contribution = contributions.Samples[y];
+                const float *weights = contributions.Weights.data() + contribution.WeightOffset;
+                const float *firstRow = src + static_cast<size_t>(contribution.First) * rowFloats;
+                std::uint8_t *dstRow = dst + static_cast<size_t>(y) * rowFloats;
+
+                for (size_t x = 0; x < rowFloats; x += 4) {
+                    __m128 sum = _mm_setzero_ps();
+                    const float *sample = firstRow + x;
+                    for (uint32_t k = 0; k < contribution.Count; k++, sample += rowFloats) {
+                        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(sample), _mm_set1_ps(weights[k])));
+                    }
+                    StorePixels(sum, dstRow + x);
+                }
+            }
+        }
+
+        // Splits [0, rows) into ranges of at least minRowsPerTask rows. The calling thread works on the ranges too
+        // and never blocks on the pool, so resizing from inside a pool task can not deadlock.
+        void ForEachRowRange(IThreadPool *threadPool, uint32_t rows, auto &&body) {
+            constexpr size_t minRowsPerTask = 16;
+            size_t threadCount = threadPool ? threadPool->GetThreadCount() + 1 : 1;
+            // a few ranges per thread, so threads that finish early help the others
+            size_t rowsPerTask = std::max(minRowsPerTask, rows / (threadCount * 4));
+
+            ParallelForRange(rows, [&](size_t begin, size_t end) {
+                body(static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+            }, ParallelOptions{.grainSize = rowsPerTask}, threadPool);
+        }
+    }
+
+    std::pair<uint32_t, uint32_t> FitWithin(uint32_t width, uint32_t height, uint32_t maxWidth, uint32_t maxHeight) {
+        if (width == 0 || height == 0) return {1, 1};
+
+        double scale = std::min({1.0, static_cast<double>(maxWidth) / width, static_cast<double>(maxHeight) / height});
+        return {
+            std::max(1u, static_cast<uint32_t>(std::lround(width * scale))),
+            std::max(1u, static_cast<uint32_t>(std::lround(height * scale)))
+        };
+    }
+
+    void ResizeRgba8(const void *src, uint32_t srcWidth, uint32_t srcHeight,
+                     void *dst, uint32_t dstWidth, uint32_t dstHeight,
+                     ResizeFilter filter, IThreadPool *threadPool) {
+        EASYGUI_PROFILE_ZONE("ResizeRgba8");
+        if (srcWidth == 0 || srcHeight == 0 || dstWidth == 0 || dstHeight == 0) return;
+
+        Contributions horizontal = ComputeContributions(filter, srcWidth, dstWidth);
+        Contributions vertical = ComputeContributions(filter, srcHeight, dstHeight);
+
+        const auto *srcBytes = static_cast<const std::uint8_t *>(src);
+        auto *dstBytes = static_cast<std::uint8_t *>(dst);
+        std::vector<float> intermediate(static_cast<size_t>(srcHeight) * dstWidth * 4);
+
+        ForEachRowRange(threadPool, srcHeight, [&](uint32_t begin, uint32_t end) {
+            EASYGUI_PROFILE_ZONE("ResizeRgba8::Horizontal");
+            ResizeRowsHorizontal(srcBytes, srcWidth, intermediate.data(), dstWidth, horizontal, begin, end);
+        });
+
+        ForEachRowRange(threadPool, dstHeight, [&](uint32_t begin, uint32_t end) {
+            EASYGUI_PROFILE_ZONE("ResizeRgba8::Vertical");
+            ResizeRowsVertical(intermediate.data(), dstBytes, dstWidth, vertical, begin, end);
+        });
+    }
+
+    void ResizeImage(const CPUImageData &image, std::span<std::byte> dst, uint32_t dstWidth, uint32_t dstHeight,
+                     ResizeFilter filter, IThreadPool *threadPool) {
+        if (dst.size() < static_cast<size_t>(dstWidth) * dstHeight * 4) {
+            throw std::runtime_error("resize destination is too small!");
+        }
+
+        // CPUImageData is always decoded as RGBA, whatever the channel count of the file
+        ResizeRgba8(image.GetData(),
+                    static_cast<uint32_t>(image.GetWidth()), static_cast<uint32_t>(image.GetHeight()),
+                    dst.data(), dstWidth, dstHeight, filter, threadPool);
+    }
+}
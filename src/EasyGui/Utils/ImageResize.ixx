@@ -0,0 +1,38 @@
+export module EasyGui.Utils.ImageResize;
+
+import EasyGui.Utils.Image;
+import EasyGui.Tools.ThreadPool;
+import std;
+
+// Separable RGBA8 downscaling for thumbnails.
+//
+// The image is filtered horizontally into a float buffer of the target width, then vertically into the destination,
+// each pass vectorized over the four channels of a pixel and split into row ranges on the thread pool. Channels are
+// filtered independently, premultiply images with transparency first to avoid dark fringes. Upscaling works too but
+// is not what the filters are tuned for.
+namespace EasyGui {
+    export enum class ResizeFilter {
+        // average of the covered source pixels, fastest
+        Box,
+        // triangle filter widened to the scale factor
+        Bilinear,
+        // windowed sinc with three lobes, sharpest
+        Lanczos3
+    };
+
+    // the largest size with the aspect ratio of the source that fits into maxWidth x maxHeight, never larger than
+    // the source and at least 1x1
+    export std::pair<uint32_t, uint32_t> FitWithin(uint32_t width, uint32_t height,
+                                                   uint32_t maxWidth, uint32_t maxHeight);
+
+    // src holds srcWidth * srcHeight RGBA8 pixels, dst receives dstWidth * dstHeight tightly packed RGBA8 pixels and
+    // may be mapped staging memory. Without a thread pool everything runs on the calling thread, with one the calling
+    // thread works on the row ranges too, so workers of the pool may call it as well.
+    export void ResizeRgba8(const void *src, uint32_t srcWidth, uint32_t srcHeight,
+                            void *dst, uint32_t dstWidth, uint32_t dstHeight,
+                            ResizeFilter filter = ResizeFilter::Lanczos3, IThreadPool *threadPool = nullptr);
+
+    // dst must hold dstWidth * dstHeight * 4 bytes
+    export void ResizeImage(const CPUImageData &image, std::span<std::byte> dst, uint32_t dstWidth, uint32_t dstHeight,
+                            ResizeFilter filter = ResizeFilter::Lanczos3, IThreadPool *threadPool = nullptr);
+}
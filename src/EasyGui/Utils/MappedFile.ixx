@@ -0,0 +1,97 @@
+export module EasyGui.Utils.MappedFile;
+
+import std;
+
+#ifdef _WIN32
+import <Windows.h>;
+#else
+import <fcntl.h>;
+import <sys/mman.h>;
+import <sys/stat.h>;
+import <unistd.h>;
+#endif
+
+namespace EasyGui {
+    // Read only view of a whole file, the pages are only read when touched. Empty and unreadable files can not be
+    // mapped and give an empty optional.
+    export class MappedFile {
+    public:
+        static std::optional<MappedFile> Open(const std::filesystem::path &path) {
+#ifdef _WIN32
+            HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                      FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+            if (file == INVALID_HANDLE_VALUE) return std::nullopt;
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+                CloseHandle(file);
+                return std::nullopt;
+            }
+
+            HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            // the view keeps the mapping alive
+            CloseHandle(file);
+            if (!mapping) return std::nullopt;
+
+            const void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+            if (!view) return std::nullopt;
+
+            return MappedFile(view, static_cast<size_t>(size.QuadPart));
+#else
+            int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (file < 0) return std::nullopt;
+
+            struct stat status{};
+            if (::fstat(file, &status) != 0 || status.st_size <= 0) {
+                ::close(file);
+                return std::nullopt;
+            }
+
+            auto size = static_cast<size_t>(status.st_size);
+            void *view = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+            // the mapping keeps the file alive
+            ::close(file);
+            if (view == MAP_FAILED) return std::nullopt;
+
+            ::madvise(view, size, MADV_SEQUENTIAL);
+            return MappedFile(view, size);
+#endif
+        }
+
+        MappedFile(const MappedFile &) = delete;
+
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        MappedFile(MappedFile &&other) noexcept
+            : m_View(std::exchange(other.m_View, nullptr)),
+              m_Size(std::exchange(other.m_Size, 0)) {}
+
+        MappedFile &operator=(MappedFile &&other) noexcept {
+            if (this != &other) {
+                std::swap(m_View, other.m_View);
+                std::swap(m_Size, other.m_Size);
+            }
+            return *this;
+        }
+
+        ~MappedFile() {
+            if (!m_View) return;
+#ifdef _WIN32
+            UnmapViewOfFile(m_View);
+#else
+            ::munmap(const_cast<void *>(m_View), m_Size);
+#endif
+        }
+
+        std::span<const std::byte> GetData() const {
+            return {static_cast<const std::byte *>(m_View), m_Size};
+        }
+
+    private:
+        MappedFile(const void *view, size_t size) : m_View(view), m_Size(size) {}
+
+        const void *m_View = nullptr;
+        size_t m_Size = 0;
+    };
+}
@@ -0,0 +1,440 @@
+module EasyGui.Utils.PixelConversion;
+
+import std;
+
+import "EasyGui/Tools/PlatformDefines.hpp";
+
+namespace EasyGui {
+    namespace {
+        std::uint32_t LoadU32(const std::uint8_t *src) {
+            std::uint32_t value;
+            std::memcpy(&value, src, sizeof(value));
+            return value;
+        }
+
+        void StoreU32(std::uint8_t *dst, std::uint32_t value) {
+            std::memcpy(dst, &value, sizeof(value));
+        }
+
+        SimdLevel DetectSimdLevel() {
+#if EASYGUI_ARCH_X86 && defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            int maxLeaf = info[0];
+
+            __cpuid(info, 1);
+            bool sse2 = info[3] & (1 << 26);
+            bool osxsave = info[2] & (1 << 27);
+            bool avx = info[2] & (1 << 28);
+
+            // AVX2 also needs the operating system to save the ymm registers
+            if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) {
+                __cpuidex(info, 7, 0);
+                if (info[1] & (1 << 5)) {
+                    return SimdLevel::AVX2;
+                }
+            }
+            return sse2 ? SimdLevel::SSE2 : SimdLevel::Scalar;
+#elif EASYGUI_ARCH_X86
+            // the avx2 check of the builtin includes the operating system support for the ymm registers
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+            return __builtin_cpu_supports("sse2") ? SimdLevel::SSE2 : SimdLevel::Scalar;
+#else
+            return SimdLevel::Scalar;
+#endif
+        }
+
+        const SimdLevel s_SupportedLevel = DetectSimdLevel();
+        std::atomic<SimdLevel> s_Level{s_SupportedLevel};
+
+        // 8 bit transfer function tables, a lookup beats any vectorized pow at this precision
+        using TransferTable = std::array<std::uint8_t, 256>;
+
+        const TransferTable &GetSrgbToLinearTable() {
+            static const TransferTable table = [] {
+                TransferTable result{};
+                for (int i = 0; i < 256; i++) {
+                    double c = i / 255.0;
+                    double linear = c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4);
+                    result[i] = static_cast<std::uint8_t>(linear * 255.0 + 0.5);
+                }
+                return result;
+            }();
+            return table;
+        }
+
+        const TransferTable &GetLinearToSrgbTable() {
+            static const TransferTable table = [] {
+                TransferTable result{};
+                for (int i = 0; i < 256; i++) {
+                    double linear = i / 255.0;
+                    double c = linear <= 0.0031308 ? linear * 12.92 : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+                    result[i] = static_cast<std::uint8_t>(c * 255.0 + 0.5);
+                }
+                return result;
+            }();
+            return table;
+        }
+
+        // scalar, also handles the tails of the vector loops
+
+        void RgbToRgbaScalar(const std::uint8_t *src, std::uint8_t *dst, size_t pixelCount, std::uint8_t alpha) {
+            std::uint32_t alphaBits = static_cast<std::uint32_t>(alpha) << 24;
+            size_t i = 0;
+            // four pixels from three words
+            for (; i + 4 <= pixelCount; i += 4, src += 12, dst += 16) {
+                std::uint32_t w0 = LoadU32(src);
+                std::uint32_t w1 = LoadU32(src + 4);
+                std::uint32_t w2 = LoadU32(src + 8);
+                StoreU32(dst, (w0 & 0x00FFFFFF) | alphaBits);
+                StoreU32(dst + 4, (((w0 >> 24) | (w1 << 8)) & 0x00FFFFFF) | alphaBits);
+                StoreU32(dst + 8, (((w1 >> 16) | (w2 << 16)) & 0x00FFFFFF) | alphaBits);
+                StoreU32(dst + 12, (w2 >> 8) | alphaBits);
+            }
+            for (; i < pixelCount; i++, src += 3, dst += 4) {
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+                dst[3] = alpha;
+            }
+        }
+
+        void SwizzleRgbaBgraScalar(const std::uint8_t *src, std::uint8_t *dst, size_t pixelCount) {
+            for (size_t i = 0; i < pixelCount; i++, src += 4, dst += 4) {
+                std::uint32_t value = LoadU32(src);
+                StoreU32(dst, (value & 0xFF00FF00) | ((value & 0xFF) << 16) | ((value >> 16) & 0xFF));
+            }
+        }
+
+        // c * a / 255 rounded, exact for all 8 bit inputs
+        std::uint8_t MultiplyUnorm8(std::uint32_t c, std::uint32_t a) {
+            std::uint32_t t = c * a + 128;
+            return static_cast<std::uint8_t>((t + (t >> 8)) >> 8);
+        }
+
+        void PremultiplyAlphaScalar(const std::uint8_t *src, std::uint8_t *dst, size_t pixelCount) {
+            for (size_t i = 0; i < pixelCount; i++, src += 4, dst += 4) {
+                std::uint8_t alpha = src[3];
+                dst[0] = MultiplyUnorm8(src[0], alpha);
+                dst[1] = MultiplyUnorm8(src[1], alpha);
+                dst[2] = MultiplyUnorm8(src[2], alpha);
+                dst[3] = alpha;
+            }
+        }
+
+        void ApplyTransferTable(const TransferTable &table, const std::uint8_t *src, std::uint8_t *dst,
+                                size_t pixelCount) {
+            for (size_t i = 0; i < pixelCount; i++, src += 4, dst += 4) {
+                dst[0] = table[src[0]];
+                dst[1] = table[src[1]];
+                dst[2] = table[src[2]];
+                dst[3] = src[3];
+            }
+        }
+
+        // x / 257 rounded, exact for all 16 bit inputs
+        std::uint8_t Unorm16ToUnorm8(std::uint32_t value) {
+            std::uint32_t t = std::min<std::uint32_t>(value + 128, 0xFFFF);
+            return static_cast<std::uint8_t>((t - (t >> 8)) >> 8);
+        }
+
+        void Rgba16ToRgba8Scalar(const std::uint8_t *src, std::uint8_t *dst, size_t pixelCount) {
+            for (size_t i = 0; i < pixelCount * 4; i++, src += 2) {
+                std::uint16_t value;
+                std::memcpy(&value, src, sizeof(value));
+                dst[i] = Unorm16ToUnorm8(value);
+            }
+        }
+
+        void RgbaFloatToRgba8Scalar(const std::uint8_t *src, std::uint8_t *dst, size_t pixelCount) {
+            for (size_t i = 0; i < pixelCount * 4; i++, src += 4) {
+                float value;
+                std::memcpy(&value, src, sizeof(value));
+                // written so that NaN ends up as 0 like in the vector paths
+                value = value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f;
+                dst[i] = static_cast<std::uint8_t>(value * 255.0f + 0.5f);
+            }
+        }
+
+#if EASYGUI_ARCH_X86
+        // SSE2
+
+        void SwizzleRgbaBgraSSE2(const std::uint8_t *src, std::uint8_t *dst, size_t pixelCount) {
+            const __m128i greenAlpha = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+            const __m128i lowByte = _mm_set1_epi32(0xFF);
+            size_t i = 0;
+            for (; i + 4 <= pixelCount; i += 4) {
+                __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+                __m128i red = _mm_slli_epi32(_mm_and_si128(value, lowByte), 16);
+                __m128i blue = _mm_and_si128(_mm_srli_epi32(value, 16), lowByte);
+                __m128i result = _mm_or_si128(_mm_and_si128(value, greenAlpha), _mm_or_si128(red, blue));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), result);
+            }
+            SwizzleRgbaBgraScalar(src + i * 4, dst + i * 4, pixelCount - i);
+        }
+
+        __m128i PremultiplyHalfSSE2(__m128i color, __m128i bias) {
+            // broadcast the alpha of each pixel over its four 16 bit lanes
+            __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(color, _MM_SHUFFLE(3, 3, 3, 3)),
+                                                _MM_SHUFFLE(3, 3, 3, 3));
+            __m128i t = _mm_add_epi16(_mm_mullo_epi16(color, alpha), bias);
+            return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+        }
+
+        void PremultiplyAlphaSSE2(const std::uint8_t *src, std::uint8_t *dst, size_t pixelCount) {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i bias = _mm_set1_epi16(128);
+            const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+            size_t i = 0;
+            for (; i + 4 <= pixelCount; i += 4) {
+                __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+                __m128i low = PremultiplyHalfSSE2(_mm_unpacklo_epi8(value, zero), bias);
+                __m128i high = PremultiplyHalfSSE2(_mm_unpackhi_epi8(value, zero), bias);
+                __m128i result = _mm_packus_epi16(low, high);
+                // alpha * alpha is wrong for the alpha channel itself, take the original
+                result = _mm_or_si128(_mm_andnot_si128(alphaMask, result), _mm_and_si128(value, alphaMask));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), result);
+            }
+            PremultiplyAlphaScalar(src + i * 4, dst + i * 4, pixelCount - i);
+        }
+
+        __m128i Unorm16ToUnorm8SSE2(__m128i value, __m128i bias) {
+            __m128i t = _mm_adds_epu16(value, bias);
+            return _mm_srli_epi16(_mm_sub_epi16(t, _mm_srli_epi16(t, 8)), 8);
+        }
+
+        void Rgba16ToRgba8SSE2(const std::uint8_t *src, std::uint8_t *dst, size_t pixelCount) {
+            const __m128i bias = _mm_set1_epi16(128);
+            size_t i = 0;
+            // four pixels, 32 bytes in and 16 out
+            for (; i + 4 <= pixelCount; i += 4) {
+                const auto *in = reinterpret_cast<const __m128i *>(src + i * 8);
+                __m128i low = Unorm16ToUnorm8SSE2(_mm_loadu_si128(in), bias);
+                __m128i high = Unorm16ToUnorm8SSE2(_mm_loadu_si128(in + 1), bias);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), _mm_packus_epi16(low, high));
+            }
+            Rgba16ToRgba8Scalar(src + i * 8, dst + i * 4, pixelCount - i);
+        }
+
+        __m128i FloatToInt32SSE2(const std::uint8_t *src, __m128 zero, __m128 one, __m128 scale, __m128 half) {
+            // max returns its second operand for NaN, so NaN becomes 0
+            __m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(reinterpret_cast<const float *>(src)), zero), one);
+            return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), half));
+        }
+
+        void RgbaFloatToRgba8SSE2(const std::uint8_t *src, std::uint8_t *dst, size_t pixelCount) {
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 one = _mm_set1_ps(1.0f);
+            const __m128 scale = _mm_set1_ps(255.0f);
+            const __m128 half = _mm_set1_ps(0.5f);
+            size_t i = 0;
+            // four pixels, 64 bytes in and 16 out
+            for (; i + 4 <= pixelCount; i += 4) {
+                const std::uint8_t *in = src + i * 16;
+                __m128i a = FloatToInt32SSE2(in, zero, one, scale, half);
+                __m128i b = FloatToInt32SSE2(in + 16, zero, one, scale, half);
+                __m128i c = FloatToInt32SSE2(in + 32, zero, one, scale, half);
+                __m128i d = FloatToInt32SSE2(in + 48, zero, one, scale, half);
+                __m128i result = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), result);
+            }
+            RgbaFloatToRgba8Scalar(src + i * 16, dst + i * 4, pixelCount - i);
+        }
+
+        // AVX2, the 256 bit pack and shuffle instructions work per 128 bit lane
+
+        EASYGUI_TARGET_AVX2
+        void RgbToRgbaAVX2(const std::uint8_t *src, std::uint8_t *dst, size_t pixelCount, std::uint8_t alpha) {
+            // 4 pixels of 3 bytes per lane, zero the alpha bytes and or the constant in
+            const __m256i shuffle = _mm256_setr_epi8(
+                0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+            const __m256i alphaBits = _mm256_set1_epi32(static_cast<int>(static_cast<std::uint32_t>(alpha) << 24));
+            size_t i = 0;
+            // each lane loads 16 bytes for 12, stay 4 bytes clear of the end
+            for (; i + 10 <= pixelCount; i += 8) {
+                const std::uint8_t *in = src + i * 3;
+                __m256i value = _mm256_set_m128i(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 12)),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(in)));
+                __m256i result = _mm256_or_si256(_mm256_shuffle_epi8(value, shuffle), alphaBits);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), result);
+            }
+            RgbToRgbaScalar(src + i * 3, dst + i * 4, pixelCount - i, alpha);
+        }
+
+        EASYGUI_TARGET_AVX2
+        void SwizzleRgbaBgraAVX2(const std::uint8_t *src, std::uint8_t *dst, size_t pixelCount) {
+            const __m256i shuffle = _mm256_setr_epi8(
+                2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+            size_t i = 0;
+            for (; i + 8 <= pixelCount; i += 8) {
+                __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), _mm256_shuffle_epi8(value, shuffle));
+            }
+            SwizzleRgbaBgraSSE2(src + i * 4, dst + i * 4, pixelCount - i);
+        }
+
+        EASYGUI_TARGET_AVX2
+        __m256i PremultiplyHalfAVX2(__m256i color, __m256i alphaShuffle, __m256i bias) {
+            __m256i alpha = _mm256_shuffle_epi8(color, alphaShuffle);
+            __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(color, alpha), bias);
+            return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+        }
+
+        EASYGUI_TARGET_AVX2
+        void PremultiplyAlphaAVX2(const std::uint8_t *src, std::uint8_t *dst, size_t pixelCount) {
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i bias = _mm256_set1_epi16(128);
+            const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+            // copies the 16 bit alpha of each pixel over its four lanes
+            const __m256i alphaShuffle = _mm256_setr_epi8(
+                6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15,
+                6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15);
+            size_t i = 0;
+            for (; i + 8 <= pixelCount; i += 8) {
+                __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * 4));
+                __m256i low = PremultiplyHalfAVX2(_mm256_unpacklo_epi8(value, zero), alphaShuffle, bias);
+                __m256i high = PremultiplyHalfAVX2(_mm256_unpackhi_epi8(value, zero), alphaShuffle, bias);
+                // unpack and pack both work per lane, the pixel order is preserved
+                __m256i result = _mm256_packus_epi16(low, high);
+                result = _mm256_or_si256(_mm256_andnot_si256(alphaMask, result), _mm256_and_si256(value, alphaMask));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), result);
+            }
+            PremultiplyAlphaSSE2(src + i * 4, dst + i * 4, pixelCount - i);
+        }
+
+        EASYGUI_TARGET_AVX2
+        __m256i Unorm16ToUnorm8AVX2(__m256i value, __m256i bias) {
+            __m256i t = _mm256_adds_epu16(value, bias);
+            return _mm256_srli_epi16(_mm256_sub_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+        }
+
+        EASYGUI_TARGET_AVX2
+        void Rgba16ToRgba8AVX2(const std::uint8_t *src, std::uint8_t *dst, size_t pixelCount) {
+            const __m256i bias = _mm256_set1_epi16(128);
+            size_t i = 0;
+            // eight pixels, 64 bytes in and 32 out
+            for (; i + 8 <= pixelCount; i += 8) {
+                const auto *in = reinterpret_cast<const __m256i *>(src + i * 8);
+                __m256i low = Unorm16ToUnorm8AVX2(_mm256_loadu_si256(in), bias);
+                __m256i high = Unorm16ToUnorm8AVX2(_mm256_loadu_si256(in + 1), bias);
+                // the pack interleaves the lanes as low0 high0 low1 high1, restore low0 low1 high0 high1
+                __m256i result = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), _MM_SHUFFLE(3, 1, 2, 0));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), result);
+            }
+            Rgba16ToRgba8SSE2(src + i * 8, dst + i * 4, pixelCount - i);
+        }
+
+        EASYGUI_TARGET_AVX2
+        __m256i FloatToInt32AVX2(const std::uint8_t *src, __m256 zero, __m256 one, __m256 scale, __m256 half) {
+            __m256 value = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(reinterpret_cast<const float *>(src)), zero),
+                                         one);
+            return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(value, scale), half));
+        }
+
+        EASYGUI_TARGET_AVX2
+        void RgbaFloatToRgba8AVX2(const std::uint8_t *src, std::uint8_t *dst, size_t pixelCount) {
+            const __m256 zero = _mm256_setzero_ps();
+            const __m256 one = _mm256_set1_ps(1.0f);
+            const __m256 scale = _mm256_set1_ps(255.0f);
+            const __m256 half = _mm256_set1_ps(0.5f);
+            // the two per lane packs leave the pixels in dword order a0 b0 c0 d0 a1 b1 c1 d1
+            const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+            size_t i = 0;
+            // eight pixels, 128 bytes in and 32 out
+            for (; i + 8 <= pixelCount; i += 8) {
+                const std::uint8_t *in = src + i * 16;
+                __m256i a = FloatToInt32AVX2(in, zero, one, scale, half);
+                __m256i b = FloatToInt32AVX2(in + 32, zero, one, scale, half);
+                __m256i c = FloatToInt32AVX2(in + 64, zero, one, scale, half);
+                __m256i d = FloatToInt32AVX2(in + 96, zero, one, scale, half);
+                __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4),
+                                    _mm256_permutevar8x32_epi32(packed, order));
+            }
+            RgbaFloatToRgba8SSE2(src + i * 16, dst + i * 4, pixelCount - i);
+        }
+#endif
+
+        const std::uint8_t *AsBytes(const void *pointer) {
+            return static_cast<const std::uint8_t *>(pointer);
+        }
+
+        std::uint8_t *AsBytes(void *pointer) {
+            return static_cast<std::uint8_t *>(pointer);
+        }
+    }
+
+    SimdLevel GetSupportedSimdLevel() {
+        return s_SupportedLevel;
+    }
+
+    SimdLevel GetSimdLevel() {
+        return s_Level.load(std::memory_order_relaxed);
+    }
+
+    void SetSimdLevel(SimdLevel level) {
+        s_Level.store(std::min(level, s_SupportedLevel), std::memory_order_relaxed);
+    }
+
+    // SSE2 has no byte shuffle, its level keeps the word based scalar loop
+    void ConvertRgbToRgba(const void *src, void *dst, size_t pixelCount, std::uint8_t alpha) {
+#if EASYGUI_ARCH_X86
+        if (GetSimdLevel() == SimdLevel::AVX2) {
+            return RgbToRgbaAVX2(AsBytes(src), AsBytes(dst), pixelCount, alpha);
+        }
+#endif
+        RgbToRgbaScalar(AsBytes(src), AsBytes(dst), pixelCount, alpha);
+    }
+
+    void SwizzleRgbaBgra(const void *src, void *dst, size_t pixelCount) {
+        switch (GetSimdLevel()) {
+#if EASYGUI_ARCH_X86
+            case SimdLevel::AVX2: return SwizzleRgbaBgraAVX2(AsBytes(src), AsBytes(dst), pixelCount);
+            case SimdLevel::SSE2: return SwizzleRgbaBgraSSE2(AsBytes(src), AsBytes(dst), pixelCount);
+#endif
+            default: return SwizzleRgbaBgraScalar(AsBytes(src), AsBytes(dst), pixelCount);
+        }
+    }
+
+    void PremultiplyAlpha(const void *src, void *dst, size_t pixelCount) {
+        switch (GetSimdLevel()) {
+#if EASYGUI_ARCH_X86
+            case SimdLevel::AVX2: return PremultiplyAlphaAVX2(AsBytes(src), AsBytes(dst), pixelCount);
+            case SimdLevel::SSE2: return PremultiplyAlphaSSE2(AsBytes(src), AsBytes(dst), pixelCount);
+#endif
+            default: return PremultiplyAlphaScalar(AsBytes(src), AsBytes(dst), pixelCount);
+        }
+    }
+
+    void ConvertSrgbToLinear(const void *src, void *dst, size_t pixelCount) {
+        ApplyTransferTable(GetSrgbToLinearTable(), AsBytes(src), AsBytes(dst), pixelCount);
+    }
+
+    void ConvertLinearToSrgb(const void *src, void *dst, size_t pixelCount) {
+        ApplyTransferTable(GetLinearToSrgbTable(), AsBytes(src), AsBytes(dst), pixelCount);
+    }
+
+    void ConvertRgba16ToRgba8(const void *src, void *dst, size_t pixelCount) {
+        switch (GetSimdLevel()) {
+#if EASYGUI_ARCH_X86
+            case SimdLevel::AVX2: return Rgba16ToRgba8AVX2(AsBytes(src), AsBytes(dst), pixelCount);
+            case SimdLevel::SSE2: return Rgba16ToRgba8SSE2(AsBytes(src), AsBytes(dst), pixelCount);
+#endif
+            default: return Rgba16ToRgba8Scalar(AsBytes(src), AsBytes(dst), pixelCount);
+        }
+    }
+
+    void ConvertRgbaFloatToRgba8(const void *src, void *dst, size_t pixelCount) {
+        switch (GetSimdLevel()) {
+#if EASYGUI_ARCH_X86
+            case SimdLevel::AVX2: return RgbaFloatToRgba8AVX2(AsBytes(src), AsBytes(dst), pixelCount);
+            case SimdLevel::SSE2: return RgbaFloatToRgba8SSE2(AsBytes(src), AsBytes(dst), pixelCount);
+#endif
+            default: return RgbaFloatToRgba8Scalar(AsBytes(src), AsBytes(dst), pixelCount);
+        }
+    }
+}
@@ -0,0 +1,46 @@
+export module EasyGui.Utils.PixelConversion;
+
+import std;
+
+// Pixel format conversion kernels for the upload path.
+//
+// Every kernel converts pixelCount pixels from src to dst and may write straight into mapped staging memory, neither
+// pointer needs any alignment. Kernels that keep the pixel size may run in place. The implementation is chosen once
+// at runtime from the instruction sets of the CPU, AVX2, SSE2 or a scalar fallback. Builds for other architectures
+// than x86 only contain the scalar kernels.
+namespace EasyGui {
+    export enum class SimdLevel {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    // the best level the CPU and the operating system support
+    export SimdLevel GetSupportedSimdLevel();
+
+    // the level the kernels currently dispatch to
+    export SimdLevel GetSimdLevel();
+
+    // caps the dispatch level, e.g. to compare implementations, levels above the supported one are ignored
+    export void SetSimdLevel(SimdLevel level);
+
+    // RGB8 to RGBA8 with a constant alpha
+    export void ConvertRgbToRgba(const void *src, void *dst, size_t pixelCount, std::uint8_t alpha = 255);
+
+    // RGBA8 to BGRA8 and back, in place allowed
+    export void SwizzleRgbaBgra(const void *src, void *dst, size_t pixelCount);
+
+    // RGBA8 straight alpha to premultiplied alpha, in place allowed
+    export void PremultiplyAlpha(const void *src, void *dst, size_t pixelCount);
+
+    // RGBA8 sRGB encoded to linear 8 bit and back, alpha is copied, in place allowed
+    export void ConvertSrgbToLinear(const void *src, void *dst, size_t pixelCount);
+
+    export void ConvertLinearToSrgb(const void *src, void *dst, size_t pixelCount);
+
+    // RGBA16 unorm to RGBA8 unorm, rounded to nearest
+    export void ConvertRgba16ToRgba8(const void *src, void *dst, size_t pixelCount);
+
+    // RGBA32 float to RGBA8 unorm, clamped to [0, 1] and rounded to nearest
+    export void ConvertRgbaFloatToRgba8(const void *src, void *dst, size_t pixelCount);
+}
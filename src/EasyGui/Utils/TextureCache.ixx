@@ -0,0 +1,225 @@
+export module EasyGui.Utils.TextureCache;
+
+import EasyGui.Lib;
+import EasyGui.Graphics.GraphicsContext;
+import EasyGui.Graphics.BindlessTextureTable;
+import EasyGui.Utils.Image;
+import EasyGui.Tools.Profiler;
+import std;
+
+import "EasyGui/Tools/ProfilerDefines.hpp";
+
+namespace EasyGui {
+    export struct TextureCacheSpec {
+        // evicts once a device local heap uses more than this fraction of the budget VMA reports for it
+        float budgetThreshold = 0.85f;
+        // optional hard cap on the memory of resident textures, 0 leaves it to the heap budget only
+        vk::DeviceSize maxResidentBytes = 0;
+        bool generateMips = true;
+        // frames a failed load is remembered before Get() tries the loader again, 0 waits for Remove()
+        uint64_t failedLoadRetryFrames = 300;
+    };
+
+    // Textures addressed by a path or a user key, loaded on first use and kept resident while memory allows.
+    //
+    // Every Get() marks the texture as used in the current frame. When the device local heaps approach the budget
+    // reported through VK_EXT_memory_budget the least recently used textures are dropped, textures used in the current
+    // frame are never evicted. An evicted texture keeps its key and loader and is reloaded by the next Get(), so the
+    // returned image is only valid until the end of the frame. A failed load is remembered too, Get() returns nullptr
+    // without calling the loader until the retry interval of the spec passed. Main thread only.
+    export class TextureCache {
+    public:
+        using Loader = std::function<Vulkan::PixelImage(Vulkan::ImageHelper &)>;
+
+        TextureCache(GraphicsContext &context, vk::Sampler sampler,
+                     BindlessTextureTable *textureTable = nullptr, const TextureCacheSpec &spec = {})
+            : m_Context(context), m_Allocator(*context.GetAllocator()), m_Sampler(sampler),
+              m_TextureTable(textureTable), m_Spec(spec),
+              m_ImageHelper(&context.GetPhysicalDevice(), &context.GetLogicalDevice(), &context.GetCommandPool(),
+                            &context.GetGraphicsQueue(), &context.GetVulkanInstance(), &context.GetAllocator(),
+                            &context.GetDeletionQueue(), &context.GetStagingRing()) {
+            auto memoryProperties = context.GetPhysicalDevice().getMemoryProperties();
+            for (uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; heap++) {
+                if (memoryProperties.memoryHeaps[heap].flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+                    m_DeviceLocalHeaps.push_back(heap);
+                }
+            }
+        }
+
+        TextureCache(const TextureCache &) = delete;
+
+        TextureCache &operator=(const TextureCache &) = delete;
+
+        // loads the file as RGBA, nullptr when it can not be read
+        const Vulkan::ImGuiImage *Get(const std::filesystem::path &path) {
+            return Get(path.string(), [path, generateMips = m_Spec.generateMips](Vulkan::ImageHelper &helper) {
+                auto imageData = CPUImageData::LoadFromFile(path);
+                if (!imageData) {
+                    return Vulkan::PixelImage();
+                }
+
+                return helper.CreatePixelImage(
+                    static_cast<uint32_t>(imageData->GetWidth()), static_cast<uint32_t>(imageData->GetHeight()),
+                    vk::Format::eR8G8B8A8Unorm, imageData->GetData(), generateMips);
+            });
+        }
+
+        // the loader is kept for reloads after eviction, an empty PixelImage reports a failed load
+        const Vulkan::ImGuiImage *Get(const std::string &key, Loader loader) {
+            EASYGUI_PROFILE_ZONE("TextureCache::Get");
+            uint64_t frame = m_Context.GetFrameNumber();
+            if (frame != m_LastTrimFrame) {
+                Trim();
+            }
+
+            auto [it, inserted] = m_Entries.try_emplace(key);
+            Entry &entry = it->second;
+            if (inserted) {
+                entry.Load = std::move(loader);
+            }
+
+            entry.LastUsedFrame = frame;
+            if (entry.Resident) {
+                m_ResidentOrder.splice(m_ResidentOrder.begin(), m_ResidentOrder, entry.Position);
+                return &entry.Handle;
+            }
+
+            if (entry.FailedFrame && !ShouldRetry(*entry.FailedFrame, frame)) {
+                return nullptr;
+            }
+            if (!Load(it->first, entry)) {
+                entry.FailedFrame = frame;
+                return nullptr;
+            }
+            entry.FailedFrame.reset();
+            return &entry.Handle;
+        }
+
+        [[nodiscard]] bool Contains(const std::string &key) const {
+            return m_Entries.contains(key);
+        }
+
+        // forgets the texture and its loader
+        void Remove(const std::string &key) {
+            auto it = m_Entries.find(key);
+            if (it == m_Entries.end()) return;
+
+            Evict(it->second);
+            m_Entries.erase(it);
+        }
+
+        void Clear() {
+            m_Entries.clear();
+            m_ResidentOrder.clear();
+            m_ResidentBytes = 0;
+        }
+
+        // evicts least recently used textures until the heaps are back under the threshold,
+        // runs on the first Get() of every frame
+        void Trim() {
+            EASYGUI_PROFILE_ZONE("TextureCache::Trim");
+            uint64_t frame = m_Context.GetFrameNumber();
+            m_LastTrimFrame = frame;
+
+            vk::DeviceSize excess = GetExcessBytes();
+            while (excess > 0 && !m_ResidentOrder.empty()) {
+                Entry &entry = m_Entries.at(m_ResidentOrder.back());
+                if (entry.LastUsedFrame == frame) break;
+
+                // the memory is only returned once the frames in flight completed, count it as freed right away
+                vk::DeviceSize size = entry.Size;
+                Evict(entry);
+                m_EvictionCount++;
+                excess -= std::min(excess, size);
+            }
+        }
+
+        [[nodiscard]] size_t GetTextureCount() const { return m_Entries.size(); }
+
+        [[nodiscard]] size_t GetResidentCount() const { return m_ResidentOrder.size(); }
+
+        [[nodiscard]] vk::DeviceSize GetResidentBytes() const { return m_ResidentBytes; }
+
+        [[nodiscard]] uint64_t GetEvictionCount() const { return m_EvictionCount; }
+
+    private:
+        struct Entry {
+            Loader Load;
+            Vulkan::PixelImage Image;
+            Vulkan::ImGuiImage Handle;
+            vk::DeviceSize Size = 0;
+            uint64_t LastUsedFrame = 0;
+            bool Resident = false;
+            // set while the last load failed
+            std::optional<uint64_t> FailedFrame;
+            // into m_ResidentOrder, valid while resident
+            std::list<std::string>::iterator Position;
+        };
+
+        bool Load(const std::string &key, Entry &entry) {
+            EASYGUI_PROFILE_ZONE("TextureCache::Load");
+            Vulkan::PixelImage image = entry.Load(m_ImageHelper);
+            if (!image) {
+                return false;
+            }
+
+            entry.Handle = m_TextureTable
+                               ? image.CreateImGuiImage(*m_TextureTable, m_Sampler)
+                               : image.CreateImGuiImage(m_Sampler);
+            entry.Size = m_Allocator.getAllocationInfo(image.GetMemory()).size;
+            entry.Image = std::move(image);
+            entry.Resident = true;
+            entry.Position = m_ResidentOrder.insert(m_ResidentOrder.begin(), key);
+            m_ResidentBytes += entry.Size;
+            return true;
+        }
+
+        [[nodiscard]] bool ShouldRetry(uint64_t failedFrame, uint64_t frame) const {
+            return m_Spec.failedLoadRetryFrames > 0 && frame - failedFrame >= m_Spec.failedLoadRetryFrames;
+        }
+
+        // handle and image go through the deletion queue, so frames in flight can still sample them
+        void Evict(Entry &entry) {
+            if (!entry.Resident) return;
+
+            entry.Handle = {};
+            entry.Image = {};
+            m_ResidentOrder.erase(entry.Position);
+            m_ResidentBytes -= entry.Size;
+            entry.Size = 0;
+            entry.Resident = false;
+        }
+
+        [[nodiscard]] vk::DeviceSize GetExcessBytes() const {
+            vk::DeviceSize excess = 0;
+            if (m_Spec.maxResidentBytes > 0 && m_ResidentBytes > m_Spec.maxResidentBytes) {
+                excess = m_ResidentBytes - m_Spec.maxResidentBytes;
+            }
+
+            auto budgets = m_Allocator.getHeapBudgets();
+            for (uint32_t heap: m_DeviceLocalHeaps) {
+                const vma::Budget &budget = budgets[heap];
+                auto limit = static_cast<vk::DeviceSize>(static_cast<double>(budget.budget) * m_Spec.budgetThreshold);
+                if (budget.usage > limit) {
+                    excess = std::max(excess, budget.usage - limit);
+                }
+            }
+            return excess;
+        }
+
+        GraphicsContext &m_Context;
+        vma::Allocator m_Allocator;
+        vk::Sampler m_Sampler;
+        BindlessTextureTable *m_TextureTable;
+        TextureCacheSpec m_Spec;
+        Vulkan::ImageHelper m_ImageHelper;
+        std::vector<uint32_t> m_DeviceLocalHeaps;
+
+        std::unordered_map<std::string, Entry> m_Entries;
+        // resident keys, most recently used first
+        std::list<std::string> m_ResidentOrder;
+        vk::DeviceSize m_ResidentBytes = 0;
+        uint64_t m_LastTrimFrame = std::numeric_limits<uint64_t>::max();
+        uint64_t m_EvictionCount = 0;
+    };
+}
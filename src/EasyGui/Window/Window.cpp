@@ -1,6 +1,11 @@
 module EasyGui.Window;
 
+import EasyGui.Tools.Profiler;
+import EasyGui.Tools.ThreadPool;
+import EasyGui.Utils.FontAtlasCache;
+
 import "EasyGui/Lib/Lib.hpp";
+import "EasyGui/Tools/ProfilerDefines.hpp";
 
 namespace EasyGui {
     inline void ImGuiUseStyleColorHazel() {
@@ -65,7 +70,8 @@ namespace EasyGui {
                                vk::Instance instance, vk::PhysicalDevice physicalDevice,
                                vk::Device device, uint32_t queueFamily, vk::Queue queue,
                                vk::DescriptorPool descriptorPool,
-                               vk::RenderPass renderPass, uint32_t minImageCount, uint32_t imageCount) {
+                               vk::RenderPass renderPass, uint32_t minImageCount, uint32_t imageCount,
+                               vk::PipelineCache pipelineCache) {
         ImGui_ImplVulkan_InitInfo info{};
         info.ApiVersion = apiVersion;
         info.Instance = instance;
@@ -77,23 +83,65 @@ namespace EasyGui {
         info.RenderPass = renderPass;
         info.MinImageCount = minImageCount;
         info.ImageCount = imageCount;
+        info.PipelineCache = pipelineCache;
 
         ImGui_ImplVulkan_Init(&info);
     }
 
-    AppGraphicsContext::AppGraphicsContext(SDL_Window *window) : GraphicsContext(window) {
+    AppGraphicsContext::AppGraphicsContext(SDL_Window *window, PresentMode presentMode, bool bindlessTextures)
+        : GraphicsContext(window, presentMode), m_WantsBindless(bindlessTextures) {
         InitImGui(window);
     }
 
-    void AppGraphicsContext::InitImGui(SDL_Window *window) {
-        ImGui::CreateContext();
+    AppGraphicsContext::AppGraphicsContext(const std::function<SDL_Window *()> &createWindow,
+                                           PresentMode presentMode, bool bindlessTextures,
+                                           Profiling::StartupTimeline *startupTimeline,
+                                           const std::function<void()> &waitForImGui)
+        : GraphicsContext(createWindow, presentMode, startupTimeline), m_WantsBindless(bindlessTextures) {
+        if (waitForImGui) {
+            waitForImGui();
+        }
+        InitImGui(m_Window, startupTimeline);
+    }
+
+    AppGraphicsContext::AppGraphicsContext(const HeadlessSpec &headlessSpec, bool bindlessTextures,
+                                           Profiling::StartupTimeline *startupTimeline,
+                                           const std::function<void()> &waitForImGui)
+        : GraphicsContext(headlessSpec, startupTimeline), m_WantsBindless(bindlessTextures) {
+        if (waitForImGui) {
+            waitForImGui();
+        }
+        InitImGui(nullptr, startupTimeline);
+    }
+
+    void AppGraphicsContext::InitImGui(SDL_Window *window, Profiling::StartupTimeline *startupTimeline) {
+        Profiling::StartupTimeline::Scope step(startupTimeline, "InitImGui");
+        if (!ImGui::GetCurrentContext()) {
+            ImGui::CreateContext();
+        }
 
         ImGuiIO &io = ImGui::GetIO();
         (void) io;
         io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard; // Enable Keyboard Controls
         io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad; // Enable Gamepad Controls
         io.ConfigFlags |= ImGuiConfigFlags_DockingEnable; // Enable Docking
-        io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable; // Enable Multi-Viewport / Platform Windows
+
+        bool bindless = m_WantsBindless && SupportsBindlessTextures();
+        if (m_WantsBindless && !bindless) {
+            std::cerr << "Bindless textures are not supported by this device, using descriptor sets." << std::endl;
+        }
+
+        if (window && !bindless) {
+            // platform windows are rendered by ImGui_ImplVulkan which only understands descriptor set ids
+            io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable; // Enable Multi-Viewport / Platform Windows
+        } else if (!window) {
+            // headless, the display size is driven by Window::DrawFrame
+            io.IniFilename = nullptr;
+            io.DisplaySize = ImVec2{
+                static_cast<float>(m_SwapChainExtent.width),
+                static_cast<float>(m_SwapChainExtent.height)
+            };
+        }
 
         ImGuiUseStyleColorHazel();
 
@@ -104,7 +152,16 @@ namespace EasyGui {
             style.Colors[ImGuiCol_WindowBg].w = 1.0f;
         }
 
-        ImGui_ImplSDL3_InitForVulkan(window);
+        if (window) {
+            ImGui_ImplSDL3_InitForVulkan(window);
+            m_HasPlatformBackend = true;
+        }
+
+        if (bindless) {
+            m_TextureTable = std::make_unique<BindlessTextureTable>(*this);
+            m_ImGuiRenderer = std::make_unique<BindlessImGuiRenderer>(*this, *m_TextureTable);
+            return;
+        }
 
         InitImGuiForMyProgram(
             vk::ApiVersion13,
@@ -115,16 +172,51 @@ namespace EasyGui {
             *m_GraphicsQueue,
             *m_DescriptorPool,
             *m_RenderPass,
-            m_MinImageCount, m_ImageCount
+            m_MinImageCount, m_ImageCount,
+            *m_PipelineCache
         );
     }
 
     AppGraphicsContext::~AppGraphicsContext() {
-        ImGui_ImplVulkan_Shutdown();
-        ImGui_ImplSDL3_Shutdown();
+        // retired ImGui textures still need the backend to free their descriptor sets
+        if (*m_Device) m_Device.waitIdle();
+
+        if (m_ImGuiRenderer) {
+            // the renderer retires its textures into the table, which has to outlive the flush
+            m_ImGuiRenderer.reset();
+            m_DeletionQueue.Flush();
+            m_TextureTable.reset();
+        } else {
+            m_DeletionQueue.Flush();
+            ImGui_ImplVulkan_Shutdown();
+        }
+        if (m_HasPlatformBackend) {
+            ImGui_ImplSDL3_Shutdown();
+        }
         ImGui::DestroyContext();
     }
 
+    void AppGraphicsContext::NewImGuiFrame() {
+        if (!m_ImGuiRenderer) {
+            ImGui_ImplVulkan_NewFrame();
+        }
+    }
+
+    void AppGraphicsContext::UpdateImGuiTextures(vk::CommandBuffer commandBuffer, ImDrawData *drawData) {
+        // ImGui_ImplVulkan uploads its textures itself while rendering
+        if (m_ImGuiRenderer) {
+            m_ImGuiRenderer->UpdateTextures(commandBuffer, drawData);
+        }
+    }
+
+    void AppGraphicsContext::RenderImGui(ImDrawData *drawData, vk::CommandBuffer commandBuffer, size_t currentFrame) {
+        if (m_ImGuiRenderer) {
+            m_ImGuiRenderer->RenderDrawData(drawData, commandBuffer, currentFrame);
+        } else {
+            ImGui_ImplVulkan_RenderDrawData(drawData, commandBuffer);
+        }
+    }
+
     void Window::DispatchNormalEvent(SDL_Event sdlEvent) {
         switch (sdlEvent.type) {
             case SDL_EVENT_KEY_DOWN: {
@@ -194,6 +286,8 @@ namespace EasyGui {
         if (!m_Window) {
             throw std::runtime_error("Failed to create SDL window: " + std::string(SDL_GetError()));
         }
+
+        m_WakeEventType = SDL_RegisterEvents(1);
     }
 
     void Window::PushLayer(std::shared_ptr<IUpdatableLayer> layer) {
@@ -232,29 +326,236 @@ namespace EasyGui {
     }
 
     Window::Window(const WindowSpec &windowSpec) {
-        InitializeWindow(windowSpec);
-        m_GraphicsContext = std::make_unique<AppGraphicsContext>(m_Window);
+        Profiling::StartupTimeline *startupTimeline = &m_StartupTimeline;
+
+        // nothing touches ImGui before the context waits for this, so fonts load alongside the device setup
+        auto imguiReady = GlobalThreadPool()->Enqueue([startupTimeline, loadFonts = windowSpec.loadFonts,
+                                                       cacheFontAtlas = windowSpec.cacheFontAtlas] {
+            Profiling::StartupTimeline::Scope step(startupTimeline, "LoadFonts");
+            ImGui::CreateContext();
+            if (cacheFontAtlas) {
+                InstallFontAtlasCache(*ImGui::GetIO().Fonts);
+            }
+            if (loadFonts) {
+                loadFonts(*ImGui::GetIO().Fonts);
+            }
+        });
+        auto waitForImGui = [&imguiReady] { imguiReady.get(); };
+
+        std::future<void> preloadReady;
+        if (windowSpec.preload) {
+            preloadReady = GlobalThreadPool()->Enqueue([startupTimeline, preload = windowSpec.preload] {
+                Profiling::StartupTimeline::Scope step(startupTimeline, "Preload");
+                preload();
+            });
+        }
+        // both tasks write to the startup timeline of this window, join them if the setup below throws
+        WaitGuard startupGuard(imguiReady, preloadReady);
+
+        if (windowSpec.headless) {
+            m_HeadlessDisplaySize = ImVec2{static_cast<float>(windowSpec.width), static_cast<float>(windowSpec.height)};
+            m_GraphicsContext = std::make_unique<AppGraphicsContext>(HeadlessSpec{
+                .width = static_cast<uint32_t>(windowSpec.width),
+                .height = static_cast<uint32_t>(windowSpec.height),
+                .enableReadback = windowSpec.headlessReadback
+            }, windowSpec.bindlessTextures, startupTimeline, waitForImGui);
+        } else {
+            m_LowLatency = windowSpec.lowLatency;
+            m_IdleRendering = windowSpec.idleRendering;
+
+            // called by the context on this thread while it creates the instance on a worker
+            m_GraphicsContext = std::make_unique<AppGraphicsContext>(
+                [this, &windowSpec] {
+                    InitializeWindow(windowSpec);
+                    return m_Window;
+                },
+                windowSpec.presentMode, windowSpec.bindlessTextures, startupTimeline, waitForImGui);
+        }
+
+        {
+            Profiling::StartupTimeline::Scope step(startupTimeline, "CreateTextureUploader");
+            m_TextureUploader = std::make_unique<Vulkan::TextureUploader>(*m_GraphicsContext);
+            m_TextureUploader->SetWakeCallback([this] { Wake(); });
+        }
+
+        if (preloadReady.valid()) {
+            Profiling::StartupTimeline::Scope step(startupTimeline, "WaitForPreload");
+            preloadReady.get();
+        }
+    }
+
+    void Window::SetPresentMode(PresentMode presentMode) {
+        m_GraphicsContext->SetPresentMode(presentMode, m_Window);
+    }
+
+    void Window::WaitForPreviousFrame() {
+        EASYGUI_PROFILE_ZONE("WaitForPreviousFrame");
+        // the most recently submitted frame, once it is done the GPU is idle and input is sampled as late as possible
+        size_t previousFrame = (m_CurrentFrame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT;
+        auto &inFlightFences = m_GraphicsContext->GetInFlightFences();
+        std::ignore = m_GraphicsContext->GetLogicalDevice().waitForFences(
+            *inFlightFences[previousFrame], vk::True, std::numeric_limits<uint64_t>::max());
+    }
+
+    void Window::RequestRedraw() {
+        m_RedrawRequested.store(true, std::memory_order_relaxed);
+        Wake();
+    }
+
+    void Window::Wake() {
+        if (!m_WakeEventType) return;
+
+        SDL_Event event{};
+        event.type = m_WakeEventType;
+        SDL_PushEvent(&event);
+    }
+
+    float Window::GetAnimationFrameRate() const {
+        float frameRate = m_AnimationFrameRate;
+        for (const auto &layer: m_Layers) {
+            frameRate = std::max(frameRate, layer->GetAnimationFrameRate());
+        }
+
+        // keeps the text cursor blinking
+        if (ImGui::GetIO().WantTextInput) {
+            frameRate = std::max(frameRate, 5.0f);
+        }
+
+        return frameRate;
+    }
+
+    bool Window::HasPendingWork() const {
+        if (m_PendingFrames > 0 || m_RedrawRequested.load(std::memory_order_relaxed)) {
+            return true;
+        }
+
+        {
+            std::lock_guard lock(m_MainThreadTasksMutex);
+            if (!m_MainThreadTasks.empty()) return true;
+        }
+
+        if (m_TextureUploader->HasQueuedUploads()) return true;
+
+        return std::ranges::any_of(m_Layers, [](const auto &layer) { return layer->WantsRedraw(); });
+    }
+
+    void Window::WaitForWork() {
+        // headless windows have no events to wait for
+        if (!m_Window) return;
+
+        // texture uploads on the GPU have no event to wake us, poll them at a short interval instead
+        constexpr Sint32 uploadPollMs = 1;
+        bool uploadsInFlight = m_TextureUploader->HasUploadsInFlight();
+
+        if (!m_ShouldUpdate) {
+            EASYGUI_PROFILE_ZONE("WaitForWork");
+            if (uploadsInFlight) {
+                SDL_WaitEventTimeout(nullptr, uploadPollMs);
+            } else {
+                SDL_WaitEvent(nullptr);
+            }
+            return;
+        }
+
+        if (!m_IdleRendering || HasPendingWork()) return;
+
+        EASYGUI_PROFILE_ZONE("WaitForWork");
+        float frameRate = GetAnimationFrameRate();
+        if (frameRate <= 0.0f) {
+            if (uploadsInFlight) {
+                SDL_WaitEventTimeout(nullptr, uploadPollMs);
+            } else {
+                SDL_WaitEvent(nullptr);
+            }
+            return;
+        }
+
+        auto nextFrame = m_LastDrawTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                             std::chrono::duration<double>(1.0 / frameRate));
+        auto timeout = std::chrono::ceil<std::chrono::milliseconds>(nextFrame - std::chrono::steady_clock::now());
+        if (uploadsInFlight) {
+            timeout = std::min(timeout, std::chrono::milliseconds{uploadPollMs});
+        }
+        if (timeout.count() > 0) {
+            SDL_WaitEventTimeout(nullptr, static_cast<Sint32>(timeout.count()));
+        }
+    }
+
+    bool Window::ConsumeRedraw() {
+        if (m_RedrawRequested.exchange(false, std::memory_order_relaxed) ||
+            std::ranges::any_of(m_Layers, [](const auto &layer) { return layer->WantsRedraw(); })) {
+            m_PendingFrames = std::max(m_PendingFrames, s_FramesPerInput);
+        }
+
+        if (m_PendingFrames > 0) {
+            --m_PendingFrames;
+            return true;
+        }
+
+        float frameRate = GetAnimationFrameRate();
+        return frameRate > 0.0f &&
+               std::chrono::steady_clock::now() - m_LastDrawTime >= std::chrono::duration<double>(1.0 / frameRate);
+    }
+
+    void Window::RunMainThreadTasks() {
+        std::vector<std::function<void()>> tasks;
+        {
+            std::lock_guard lock(m_MainThreadTasksMutex);
+            tasks.swap(m_MainThreadTasks);
+        }
+
+        if (tasks.empty()) return;
+
+        EASYGUI_PROFILE_ZONE("MainThreadTasks");
+        for (auto &task: tasks) {
+            task();
+        }
+    }
+
+    void Window::ProcessTextureUploads() {
+        m_TextureUploader->Submit();
+
+        // freshly uploaded images should show up without waiting for input
+        if (m_TextureUploader->Poll() > 0) {
+            m_PendingFrames = std::max(m_PendingFrames, s_FramesPerInput);
+        }
     }
 
     void Window::MainLoop() {
-        SDL_SetWindowPosition(m_Window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
-        SDL_ShowWindow(m_Window);
-        bool done = false;
+        if (m_Window) {
+            SDL_SetWindowPosition(m_Window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
+            SDL_ShowWindow(m_Window);
+        }
+
+        Profiling::SetThreadName("Main Thread");
+
+        while (!m_ShouldClose) {
+            EASYGUI_PROFILE_ZONE("MainLoop");
 
-        while (!done) {
             // Poll and handle events (inputs, window resize, etc.)
             // You can read the io.WantCaptureMouse, io.WantCaptureKeyboard flags to tell if dear imgui wants to use your inputs.
             // - When io.WantCaptureMouse is true, do not dispatch mouse input data to your main application, or clear/overwrite your copy of the mouse data.
             // - When io.WantCaptureKeyboard is true, do not dispatch keyboard input data to your main application, or clear/overwrite your copy of the keyboard data.
             // Generally you may always pass all inputs to dear imgui, and hide them from your application based on those two flags.
             // [If using SDL_MAIN_USE_CALLBACKS: call ImGui_ImplSDL3_ProcessEvent() from your SDL_AppEvent() function]
+            if (m_LowLatency && m_ShouldUpdate) {
+                WaitForPreviousFrame();
+            }
+
+            WaitForWork();
+
             SDL_Event event;
             while (SDL_PollEvent(&event)) {
+                EASYGUI_PROFILE_ZONE("DispatchEvent");
+                if (event.type != m_WakeEventType) {
+                    // ImGui needs a few frames to settle hover, focus and layout changes after input
+                    m_PendingFrames = s_FramesPerInput;
+                }
                 ImGui_ImplSDL3_ProcessEvent(&event);
                 // rewrite this using switch case
                 switch (event.type) {
                     case SDL_EVENT_QUIT: {
-                        done = true;
+                        m_ShouldClose = true;
                         WindowCloseEvent event{};
                         for (auto reverseIt = m_Layers.rbegin(); reverseIt != m_Layers.rend(); ++reverseIt) {
                             if ((*reverseIt)->OnEvent(event)) {
@@ -265,7 +566,7 @@ namespace EasyGui {
                     }
                     case SDL_EVENT_WINDOW_CLOSE_REQUESTED: {
                         if (event.window.windowID == SDL_GetWindowID(m_Window)) {
-                            done = true;
+                            m_ShouldClose = true;
                             WindowCloseEvent event{};
                             for (auto reverseIt = m_Layers.rbegin(); reverseIt != m_Layers.rend(); ++reverseIt) {
                                 if ((*reverseIt)->OnEvent(event)) {
@@ -286,7 +587,8 @@ namespace EasyGui {
                             m_ShouldUpdate = true;
                             auto [swapChainWidth, swapChainHeight] = m_GraphicsContext->GetSwapChainExtent();
                             if (width != swapChainWidth || height != swapChainHeight) {
-                                m_GraphicsContext->RecreateSwapChain(m_Window);
+                                // a drag produces bursts of resize events, recreate once before the next frame
+                                m_SwapChainOutdated = true;
                             }
                         } else {
                             m_ShouldUpdate = false;
@@ -300,30 +602,45 @@ namespace EasyGui {
                         }
                         break;
                     }
-                    case SDL_EVENT_WINDOW_RESTORED: {
+                    case SDL_EVENT_WINDOW_RESTORED:
+                    case SDL_EVENT_WINDOW_EXPOSED:
+                    case SDL_EVENT_WINDOW_SHOWN: {
                         m_ShouldUpdate = true;
                         break;
                     }
+                    case SDL_EVENT_WINDOW_OCCLUDED:
+                    case SDL_EVENT_WINDOW_HIDDEN: {
+                        m_ShouldUpdate = false;
+                        break;
+                    }
                     default:
                         DispatchNormalEvent(event);
                 }
             }
 
-            if (!m_ShouldUpdate) {
-                continue;
-                std::this_thread::sleep_for(std::chrono::milliseconds(16));
+            if (m_SwapChainOutdated && m_ShouldUpdate) {
+                EASYGUI_PROFILE_ZONE("RecreateSwapChain");
+                m_GraphicsContext->RecreateSwapChain(m_Window);
+                m_SwapChainOutdated = false;
             }
-            DrawFrame();
 
-            for (auto &task: m_MainThreadTasks) {
-                task();
+            ProcessTextureUploads();
+
+            // minimized or occluded windows render nothing, WaitForWork blocks until they come back
+            if (m_ShouldUpdate && (!m_IdleRendering || ConsumeRedraw())) {
+                DrawFrame();
+                m_LastDrawTime = std::chrono::steady_clock::now();
             }
-            m_MainThreadTasks.clear();
+
+            RunMainThreadTasks();
         }
 
         // m_Device.waitIdle();
         m_GraphicsContext->GetLogicalDevice().waitIdle();
+        m_GraphicsContext->FlushReadbacks();
+        m_TextureUploader->Poll();
         m_Layers.clear();
+        m_GraphicsContext->GetDeletionQueue().Flush();
     }
 
     void Window::OnUpdate() {
@@ -332,33 +649,218 @@ namespace EasyGui {
         }
     }
 
+    void Window::RenderGpuTimingOverlay() {
+        ImGuiWindowFlags windowFlags = ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoFocusOnAppearing |
+                                       ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoSavedSettings;
+
+        if (!ImGui::Begin("GPU Timings", &m_ShowGpuTimingOverlay, windowFlags)) {
+            ImGui::End();
+            return;
+        }
+
+        if (!m_GraphicsContext->SupportsGpuTimestamps()) {
+            ImGui::TextUnformatted("Timestamp queries are not supported on this device.");
+            ImGui::End();
+            return;
+        }
+
+        const auto &timings = m_GraphicsContext->GetGpuTimings();
+        double frameMs = m_GraphicsContext->GetGpuFrameMilliseconds();
+        bool overBudget = frameMs > m_FrameBudgetMs;
+
+        // the most expensive direct child of the frame is the one to blame
+        const GpuZoneTiming *mostExpensive = nullptr;
+        for (const auto &zone: timings) {
+            if (zone.Depth == 1 && (!mostExpensive || zone.Milliseconds > mostExpensive->Milliseconds)) {
+                mostExpensive = &zone;
+            }
+        }
+
+        ImGui::TextFmt("GPU frame: {:.3f} ms / budget {:.3f} ms", frameMs, m_FrameBudgetMs);
+
+        if (ImGui::BeginTable("GpuZones", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+            ImGui::TableSetupColumn("Zone");
+            ImGui::TableSetupColumn("ms");
+            ImGui::TableSetupColumn("%");
+            ImGui::TableHeadersRow();
+
+            for (const auto &zone: timings) {
+                bool highlight = overBudget && &zone == mostExpensive;
+                if (highlight) {
+                    ImGui::PushStyleColor(ImGuiCol_Text, ImVec4{1.0f, 0.35f, 0.3f, 1.0f});
+                }
+
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextFmt("{:{}}{}", "", zone.Depth * 2, zone.Name);
+                ImGui::TableSetColumnIndex(1);
+                ImGui::TextFmt("{:.3f}", zone.Milliseconds);
+                ImGui::TableSetColumnIndex(2);
+                ImGui::TextFmt("{:.1f}", frameMs > 0.0 ? zone.Milliseconds / frameMs * 100.0 : 0.0);
+
+                if (highlight) {
+                    ImGui::PopStyleColor();
+                }
+            }
+
+            ImGui::EndTable();
+        }
+
+        ImGui::End();
+    }
+
+    namespace {
+        using FrameClock = std::chrono::steady_clock;
+
+        double ElapsedMilliseconds(FrameClock::time_point from, FrameClock::time_point to) {
+            return std::chrono::duration<double, std::milli>(to - from).count();
+        }
+    }
+
+    void Window::RecordLayersInParallel(vk::CommandBuffer commandBuffer, vk::Framebuffer framebuffer,
+                                        ImDrawData *drawData) {
+        EASYGUI_PROFILE_ZONE("RecordLayersInParallel");
+        size_t currentFrame = m_CurrentFrame;
+        auto &secondaryPool = m_GraphicsContext->GetSecondaryCommandPool();
+        vk::CommandBufferInheritanceInfo inheritance{
+            .renderPass = *m_GraphicsContext->GetRenderPass(),
+            .subpass = 0,
+            .framebuffer = framebuffer
+        };
+
+        // layers draw from the back of the stack to the front, slots are in drawing order with ImGui last
+        auto layerAt = [this](size_t slot) { return m_Layers[m_Layers.size() - 1 - slot].get(); };
+        std::vector<vk::CommandBuffer> secondaryBuffers(m_Layers.size() + 1);
+        std::vector<uint32_t> zones(m_Layers.size());
+
+        auto recordLayer = [&, currentFrame](IUpdatableLayer &layer, size_t slot) {
+            vk::CommandBuffer secondary = secondaryPool.Begin(currentFrame, inheritance);
+            m_GraphicsContext->WriteGpuZoneBegin(secondary, currentFrame, zones[slot]);
+            layer.OnSubmitCommandBuffer(secondary);
+            m_GraphicsContext->WriteGpuZoneEnd(secondary, currentFrame, zones[slot]);
+            secondary.end();
+            secondaryBuffers[slot] = secondary;
+        };
+
+        // zones are reserved up front so the timings keep the layer order
+        for (size_t slot = 0; slot < m_Layers.size(); slot++) {
+            zones[slot] = m_GraphicsContext->ReserveGpuZone(currentFrame, layerAt(slot)->GetName());
+        }
+        uint32_t imguiZone = m_GraphicsContext->ReserveGpuZone(currentFrame, "ImGui");
+
+        std::vector<std::future<void>> recordings;
+        for (size_t slot = 0; slot < m_Layers.size(); slot++) {
+            IUpdatableLayer *layer = layerAt(slot);
+            if (!layer->RecordsInParallel()) continue;
+
+            // the main thread waits for these, so they go ahead of queued background and normal work
+            TaskOptions options{.priority = TaskPriority::UiCritical};
+            recordings.push_back(GlobalThreadPool()->Enqueue(options, [&recordLayer, layer, slot] {
+                EASYGUI_PROFILE_ZONE("RecordLayer");
+                recordLayer(*layer, slot);
+            }));
+        }
+
+        try {
+            // the remaining layers and ImGui are recorded here while the workers run
+            for (size_t slot = 0; slot < m_Layers.size(); slot++) {
+                IUpdatableLayer *layer = layerAt(slot);
+                if (layer->RecordsInParallel()) continue;
+
+                recordLayer(*layer, slot);
+            }
+
+            vk::CommandBuffer imguiBuffer = secondaryPool.Begin(currentFrame, inheritance);
+            m_GraphicsContext->WriteGpuZoneBegin(imguiBuffer, currentFrame, imguiZone);
+            m_GraphicsContext->RenderImGui(drawData, imguiBuffer, currentFrame);
+            m_GraphicsContext->WriteGpuZoneEnd(imguiBuffer, currentFrame, imguiZone);
+            imguiBuffer.end();
+            secondaryBuffers.back() = imguiBuffer;
+        } catch (...) {
+            // the workers still reference this frame
+            for (auto &recording: recordings) {
+                recording.wait();
+            }
+            throw;
+        }
+
+        {
+            EASYGUI_PROFILE_ZONE("WaitForRecording");
+            // every worker is done with this frame before a failed one rethrows
+            for (auto &recording: recordings) {
+                recording.wait();
+            }
+            for (auto &recording: recordings) {
+                recording.get();
+            }
+        }
+
+        commandBuffer.executeCommands(secondaryBuffers);
+    }
+
     void Window::DrawFrame() {
-        ImGui_ImplVulkan_NewFrame();
-        ImGui_ImplSDL3_NewFrame();
+        EASYGUI_PROFILE_ZONE("DrawFrame");
+        // the first frame closes the startup timeline
+        std::optional<Profiling::StartupTimeline::Scope> firstFrameStep;
+        if (!m_FirstFrameDrawn) {
+            firstFrameStep.emplace(&m_StartupTimeline, "FirstFrame");
+            m_FirstFrameDrawn = true;
+        }
+
+        FrameTimings timings{};
+        auto frameBegin = FrameClock::now();
+
+        m_GraphicsContext->NewImGuiFrame();
+        if (m_Window) {
+            ImGui_ImplSDL3_NewFrame();
+        } else {
+            // fixed time step keeps headless runs deterministic
+            auto &io = ImGui::GetIO();
+            io.DisplaySize = m_HeadlessDisplaySize;
+            io.DeltaTime = 1.0f / 60.0f;
+        }
         ImGui::NewFrame();
-        OnUpdate();
-        ImGui::Render();
+        {
+            EASYGUI_PROFILE_ZONE("UpdateLayers");
+            OnUpdate();
+            if (m_ShowGpuTimingOverlay) {
+                RenderGpuTimingOverlay();
+            }
+        }
+        {
+            EASYGUI_PROFILE_ZONE("ImGui::Render");
+            ImGui::Render();
+        }
+
+        auto imGuiEnd = FrameClock::now();
+        timings.ImGuiBuildMs = ElapsedMilliseconds(frameBegin, imGuiEnd);
 
         auto &device = m_GraphicsContext->GetLogicalDevice();
         auto &inFlightFences = m_GraphicsContext->GetInFlightFences();
 
-        auto waitForFenceResult = device.waitForFences(*inFlightFences[m_CurrentFrame], vk::True,
-                                                       std::numeric_limits<uint64_t>::max()
-        );
+        vk::Result waitForFenceResult;
+        {
+            EASYGUI_PROFILE_ZONE("WaitForFence");
+            waitForFenceResult = device.waitForFences(*inFlightFences[m_CurrentFrame], vk::True,
+                                                      std::numeric_limits<uint64_t>::max()
+            );
+        }
 
         if (waitForFenceResult != vk::Result::eSuccess) {
             std::cerr << "Failed to wait for fence: " << vk::to_string(waitForFenceResult) << std::endl;
             return;
         }
 
-        auto &swapChain = m_GraphicsContext->GetSwapChain();
-        auto &imageAvailableSemaphores = m_GraphicsContext->GetImageAvailableSemaphores();
+        m_GraphicsContext->RetireCompletedFrame(m_CurrentFrame);
+        m_GraphicsContext->CollectGpuTimestamps(m_CurrentFrame);
 
-        auto [resultAcquireImage, imageIndex] = swapChain.acquireNextImage(
-            std::numeric_limits<uint64_t>::max(), imageAvailableSemaphores[m_CurrentFrame],
+        auto fenceEnd = FrameClock::now();
+        timings.FenceWaitMs = ElapsedMilliseconds(imGuiEnd, fenceEnd);
 
-            nullptr
-        );
+        auto [resultAcquireImage, imageIndex] = m_GraphicsContext->AcquireNextImage(m_CurrentFrame);
+
+        auto acquireEnd = FrameClock::now();
+        timings.AcquireMs = ElapsedMilliseconds(fenceEnd, acquireEnd);
 
         if (resultAcquireImage != vk::Result::eSuccess &&
             resultAcquireImage != vk::Result::eSuboptimalKHR) {
@@ -387,6 +889,11 @@ namespace EasyGui {
 
         commandBuffers[m_CurrentFrame].begin(beginInfo);
 
+        m_GraphicsContext->BeginGpuFrame(*commandBuffers[m_CurrentFrame], m_CurrentFrame);
+
+        ImDrawData *draw_data = ImGui::GetDrawData();
+        m_GraphicsContext->UpdateImGuiTextures(*commandBuffers[m_CurrentFrame], draw_data);
+
         vk::ClearValue clearColor{
             m_GraphicsContext->GetClearColor()
         };
@@ -405,53 +912,52 @@ namespace EasyGui {
             .pClearValues = &clearColor
         };
 
-        commandBuffers[m_CurrentFrame].beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+        // a subpass either records inline or only executes secondary command buffers
+        bool parallelRecording = std::ranges::any_of(m_Layers, [](const auto &layer) {
+            return layer->RecordsInParallel();
+        });
+
+        if (parallelRecording) {
+            commandBuffers[m_CurrentFrame].beginRenderPass(renderPassInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+            RecordLayersInParallel(*commandBuffers[m_CurrentFrame], *frameBuffers[imageIndex], draw_data);
+        } else {
+            commandBuffers[m_CurrentFrame].beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+
+            for (auto reverseIt = m_Layers.rbegin(); reverseIt != m_Layers.rend(); ++reverseIt) {
+                auto &layer = *reverseIt;
+                m_GraphicsContext->BeginGpuZone(*commandBuffers[m_CurrentFrame], m_CurrentFrame, layer->GetName());
+                layer->OnSubmitCommandBuffer(commandBuffers[m_CurrentFrame]);
+                m_GraphicsContext->EndGpuZone(*commandBuffers[m_CurrentFrame], m_CurrentFrame);
+            }
 
-        for (auto reverseIt = m_Layers.rbegin(); reverseIt != m_Layers.rend(); ++reverseIt) {
-            auto &layer = *reverseIt;
-            layer->OnSubmitCommandBuffer(commandBuffers[m_CurrentFrame]);
+            m_GraphicsContext->BeginGpuZone(*commandBuffers[m_CurrentFrame], m_CurrentFrame, "ImGui");
+            m_GraphicsContext->RenderImGui(draw_data, *commandBuffers[m_CurrentFrame], m_CurrentFrame);
+            m_GraphicsContext->EndGpuZone(*commandBuffers[m_CurrentFrame], m_CurrentFrame);
         }
 
-        ImDrawData *draw_data = ImGui::GetDrawData();
-        ImGui_ImplVulkan_RenderDrawData(draw_data, *commandBuffers[m_CurrentFrame]);
-
         commandBuffers[m_CurrentFrame].endRenderPass();
 
-        commandBuffers[m_CurrentFrame].end();
+        m_GraphicsContext->RecordFrameEnd(commandBuffers[m_CurrentFrame], m_CurrentFrame, imageIndex);
 
-        auto &renderFinishedSemaphores = m_GraphicsContext->GetRenderFinishedSemaphores();
-
-        vk::PipelineStageFlags waitStages[] = {vk::PipelineStageFlagBits::eColorAttachmentOutput};
-        vk::Semaphore waitSemaphores[] = {*imageAvailableSemaphores[m_CurrentFrame]};
-        vk::Semaphore signalSemaphores[] = {*renderFinishedSemaphores[imageIndex]};
-        vk::CommandBuffer commandBuffers_[] = {*commandBuffers[m_CurrentFrame]};
-
-        vk::SubmitInfo submitInfo{
-            .waitSemaphoreCount = 1,
-            .pWaitSemaphores = waitSemaphores,
-            .pWaitDstStageMask = waitStages,
-            .commandBufferCount = 1,
-            .pCommandBuffers = commandBuffers_,
-            .signalSemaphoreCount = 1,
-            .pSignalSemaphores = signalSemaphores
-        };
+        m_GraphicsContext->EndGpuFrame(*commandBuffers[m_CurrentFrame], m_CurrentFrame);
 
-        auto &graphicsQueue = m_GraphicsContext->GetGraphicsQueue();
+        commandBuffers[m_CurrentFrame].end();
 
-        graphicsQueue.submit(submitInfo, inFlightFences[m_CurrentFrame]);
+        auto recordEnd = FrameClock::now();
+        timings.RecordMs = ElapsedMilliseconds(acquireEnd, recordEnd);
 
-        vk::SwapchainKHR swapChains[] = {*swapChain};
-        vk::PresentInfoKHR presentInfo{
-            .waitSemaphoreCount = 1,
-            .pWaitSemaphores = signalSemaphores,
-            .swapchainCount = 1,
-            .pSwapchains = swapChains,
-            .pImageIndices = &imageIndex
-        };
+        vk::Result presentResult;
+        {
+            EASYGUI_PROFILE_ZONE("SubmitAndPresent");
+            presentResult = m_GraphicsContext->SubmitAndPresent(m_CurrentFrame, imageIndex);
+        }
 
-        auto &presentQueue = m_GraphicsContext->GetPresentQueue();
+        if (presentResult == vk::Result::eErrorOutOfDateKHR) {
+            m_SwapChainOutdated = true;
+        }
 
-        vk::Result presentResult = presentQueue.presentKHR(presentInfo);
+        auto presentEnd = FrameClock::now();
+        timings.SubmitPresentMs = ElapsedMilliseconds(recordEnd, presentEnd);
 
         m_CurrentFrame = (m_CurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 
@@ -460,5 +966,8 @@ namespace EasyGui {
             ImGui::UpdatePlatformWindows();
             ImGui::RenderPlatformWindowsDefault();
         }
+
+        timings.TotalMs = ElapsedMilliseconds(frameBegin, FrameClock::now());
+        m_LastFrameTimings = timings;
     }
 }
@@ -6,6 +6,10 @@ export import EasyGui.Core.KeyCodes;
 export import EasyGui.Core.MouseCodes;
 export import EasyGui.Event.AllEvents;
 import EasyGui.Graphics.GraphicsContext;
+import EasyGui.Graphics.TextureUploader;
+import EasyGui.Graphics.BindlessTextureTable;
+import EasyGui.Graphics.BindlessImGuiRenderer;
+import EasyGui.Tools.Profiler;
 
 import "EasyGui/Lib/Lib_SDL3.hpp";
 import "EasyGui/Lib/Lib_Vulkan.hpp";
@@ -13,15 +17,43 @@ import "EasyGui/Lib/Lib_Vulkan.hpp";
 namespace EasyGui {
     export class IUpdatableLayer {
     public:
+        // the name labels the layer in GPU timings and the profiler
+        explicit IUpdatableLayer(std::string name = "Layer") : m_Name(std::move(name)) {}
+
         virtual ~IUpdatableLayer() = default;
 
         virtual void OnUpdate() {}
 
         virtual void OnSubmitCommandBuffer(vk::CommandBuffer commandBuffer) {}
 
+        // Opts in to OnSubmitCommandBuffer running on a worker thread, recording into a secondary command buffer
+        // that continues the main render pass. The buffer starts without any bound state, and the layer must not
+        // touch anything other layers or ImGui use while recording. Once one layer opts in, every layer and ImGui
+        // record into secondary buffers, executed in the usual order.
+        [[nodiscard]] virtual bool RecordsInParallel() const {
+            return false;
+        }
+
         virtual bool OnEvent(const Event &event) {
             return false;
         }
+
+        // Polled once per main loop iteration when idle rendering is on, true schedules a redraw.
+        [[nodiscard]] virtual bool WantsRedraw() const {
+            return false;
+        }
+
+        // Frames per second this layer needs to animate while idle, 0 if it only changes in response to events.
+        [[nodiscard]] virtual float GetAnimationFrameRate() const {
+            return 0.0f;
+        }
+
+        [[nodiscard]] virtual std::string_view GetName() const {
+            return m_Name;
+        }
+
+    private:
+        std::string m_Name;
     };
 
     export class GlobalContext {
@@ -72,15 +104,72 @@ namespace EasyGui {
         std::string title{"Default Title"};
         int width = 1920;
         int height = 1080;
+        // render into offscreen images instead of an SDL window, no surface or display is required
+        bool headless = false;
+        bool headlessReadback = false;
+        PresentMode presentMode = PresentMode::Fifo;
+        // wait for the previous frame to finish on the GPU before polling input, trades throughput for latency
+        bool lowLatency = false;
+        // only redraw after input, redraw requests, main thread tasks or when a layer animates
+        bool idleRendering = false;
+        // ImGui draws through one bindless texture table and ImTextureID is an index into it, needs descriptor
+        // indexing support and turns multi-viewports off; falls back to the regular renderer otherwise
+        bool bindlessTextures = false;
+        // runs on a worker thread while the window and the Vulkan device are created, right after
+        // ImGui::CreateContext, e.g. to add fonts to the atlas
+        std::function<void(ImFontAtlas &)> loadFonts;
+        // rasterized glyphs are kept on disk and reused by later launches, see FontAtlasCache
+        bool cacheFontAtlas = true;
+        // runs on the global thread pool alongside the rest of startup, the Window constructor waits for it
+        std::function<void()> preload;
+    };
+
+    // CPU wall time of each phase of the last Window::DrawFrame, in milliseconds
+    export struct FrameTimings {
+        double ImGuiBuildMs = 0.0;
+        double FenceWaitMs = 0.0;
+        double AcquireMs = 0.0;
+        double RecordMs = 0.0;
+        double SubmitPresentMs = 0.0;
+        double TotalMs = 0.0;
     };
 
     export class AppGraphicsContext : public GraphicsContext {
     public:
-        AppGraphicsContext(SDL_Window *window);
+        AppGraphicsContext(SDL_Window *window, PresentMode presentMode = PresentMode::Fifo,
+                           bool bindlessTextures = false);
+
+        // waitForImGui runs right before ImGui is set up, e.g. to join a worker that creates the ImGui context
+        AppGraphicsContext(const std::function<SDL_Window *()> &createWindow, PresentMode presentMode,
+                           bool bindlessTextures, Profiling::StartupTimeline *startupTimeline,
+                           const std::function<void()> &waitForImGui = {});
 
-        void InitImGui(SDL_Window *window);
+        explicit AppGraphicsContext(const HeadlessSpec &headlessSpec, bool bindlessTextures = false,
+                                    Profiling::StartupTimeline *startupTimeline = nullptr,
+                                    const std::function<void()> &waitForImGui = {});
+
+        // creates the ImGui context unless there already is one
+        void InitImGui(SDL_Window *window, Profiling::StartupTimeline *startupTimeline = nullptr);
 
         virtual ~AppGraphicsContext() override;
+
+        [[nodiscard]] bool IsBindless() const { return m_TextureTable != nullptr; }
+
+        // nullptr unless bindless textures are in use
+        [[nodiscard]] BindlessTextureTable *GetTextureTable() const { return m_TextureTable.get(); }
+
+        void NewImGuiFrame();
+
+        // outside of a render pass, uploads the textures ImGui created or changed this frame
+        void UpdateImGuiTextures(vk::CommandBuffer commandBuffer, ImDrawData *drawData);
+
+        void RenderImGui(ImDrawData *drawData, vk::CommandBuffer commandBuffer, size_t currentFrame);
+
+    private:
+        bool m_HasPlatformBackend = false;
+        bool m_WantsBindless = false;
+        std::unique_ptr<BindlessTextureTable> m_TextureTable;
+        std::unique_ptr<BindlessImGuiRenderer> m_ImGuiRenderer;
     };
 
     export class Window {
@@ -97,17 +186,81 @@ namespace EasyGui {
 
         void DrawFrame();
 
+        void RequestClose() { m_ShouldClose = true; }
+
+        [[nodiscard]] bool IsHeadless() const { return m_Window == nullptr; }
+
+        void SetPresentMode(PresentMode presentMode);
+
+        void SetLowLatency(bool lowLatency) { m_LowLatency = lowLatency; }
+
+        void SetIdleRendering(bool idleRendering) { m_IdleRendering = idleRendering; }
+
+        // thread safe, wakes the main loop if it is idle
+        void RequestRedraw();
+
+        // minimum frame rate while idle, layers can raise it through IUpdatableLayer::GetAnimationFrameRate
+        void SetAnimationFrameRate(float framesPerSecond) { m_AnimationFrameRate = framesPerSecond; }
+
+        void SetGpuTimingOverlayVisible(bool visible) { m_ShowGpuTimingOverlay = visible; }
+
+        // frames whose GPU time exceeds the budget highlight the most expensive layer in the overlay
+        void SetFrameBudget(double milliseconds) { m_FrameBudgetMs = milliseconds; }
+
+        // each step of the constructor, ending with the first DrawFrame
+        [[nodiscard]] const Profiling::StartupTimeline &GetStartupTimeline() const { return m_StartupTimeline; }
+
     private:
         void InitializeWindow(const WindowSpec &windowSpec);
 
+        void RenderGpuTimingOverlay();
+
+        // records every layer and ImGui into secondary command buffers inside the render pass begun on commandBuffer
+        void RecordLayersInParallel(vk::CommandBuffer commandBuffer, vk::Framebuffer framebuffer, ImDrawData *drawData);
+
+        void WaitForPreviousFrame();
+
+        void Wake();
+
+        void WaitForWork();
+
+        [[nodiscard]] bool HasPendingWork() const;
+
+        bool ConsumeRedraw();
+
+        [[nodiscard]] float GetAnimationFrameRate() const;
+
+        void RunMainThreadTasks();
+
+        void ProcessTextureUploads();
+
+        Profiling::StartupTimeline m_StartupTimeline;
+        bool m_FirstFrameDrawn = false;
+
         SDL_Window *m_Window{nullptr};
         std::unique_ptr<AppGraphicsContext> m_GraphicsContext;
+        std::unique_ptr<Vulkan::TextureUploader> m_TextureUploader;
         size_t m_CurrentFrame = 0;
         bool m_ShouldUpdate = true;
+        bool m_ShouldClose = false;
+        bool m_LowLatency = false;
+        bool m_IdleRendering = false;
+        bool m_SwapChainOutdated = false;
+        size_t m_PendingFrames = s_FramesPerInput;
+        float m_AnimationFrameRate = 0.0f;
+        std::atomic_bool m_RedrawRequested{false};
+        uint32_t m_WakeEventType = 0;
+        std::chrono::steady_clock::time_point m_LastDrawTime{};
+        constexpr static size_t s_FramesPerInput = 3;
+        ImVec2 m_HeadlessDisplaySize{};
+        FrameTimings m_LastFrameTimings{};
+        bool m_ShowGpuTimingOverlay = false;
+        double m_FrameBudgetMs = 1000.0 / 60.0;
 
         std::vector<std::shared_ptr<IUpdatableLayer>> m_Layers;
 
         std::vector<std::function<void()>> m_MainThreadTasks;
+        mutable std::mutex m_MainThreadTasksMutex;
 
     public:
         template<std::derived_from<IUpdatableLayer> T>
@@ -117,11 +270,17 @@ namespace EasyGui {
             return layer;
         }
 
+        // thread safe, wakes the main loop if it is idle
         void SubmitToMainThread(auto &&task) {
-            m_MainThreadTasks.emplace_back(std::forward<decltype(task)>(task));
+            {
+                std::lock_guard lock(m_MainThreadTasksMutex);
+                m_MainThreadTasks.emplace_back(std::forward<decltype(task)>(task));
+            }
+            Wake();
         }
 
         // override all IBasicContext methods
+        // nullptr for headless windows
         [[nodiscard]] SDL_Window *GetWindow() const { return m_Window; }
 
         void PushLayer(std::shared_ptr<IUpdatableLayer> layer);
@@ -143,6 +302,14 @@ namespace EasyGui {
         [[nodiscard]] AppGraphicsContext& GetGraphicsContext() const {
             return *m_GraphicsContext;
         }
+
+        [[nodiscard]] Vulkan::TextureUploader &GetTextureUploader() const {
+            return *m_TextureUploader;
+        }
+
+        [[nodiscard]] const FrameTimings &GetLastFrameTimings() const {
+            return m_LastFrameTimings;
+        }
     };
 
 